@@ -519,8 +519,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	delete ui->processPriorityLabel;
 	delete ui->processPriority;
 	delete ui->advancedGeneralGroupBox;
+#ifndef __linux__
 	delete ui->enableNewSocketLoop;
 	delete ui->enableLowLatencyMode;
+#endif
 	delete ui->browserHWAccel;
 	delete ui->sourcesGroup;
 #if defined(__APPLE__) || HAVE_PULSEAUDIO
@@ -533,8 +535,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	ui->processPriorityLabel = nullptr;
 	ui->processPriority = nullptr;
 	ui->advancedGeneralGroupBox = nullptr;
+#ifndef __linux__
 	ui->enableNewSocketLoop = nullptr;
 	ui->enableLowLatencyMode = nullptr;
+#endif
 	ui->browserHWAccel = nullptr;
 	ui->sourcesGroup = nullptr;
 #if defined(__APPLE__) || HAVE_PULSEAUDIO
@@ -2304,24 +2308,27 @@ void OBSBasicSettings::LoadAdvancedSettings()
 
 	const char *processPriority = config_get_string(App()->GlobalConfig(),
 			"General", "ProcessPriority");
-	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
-			"NewSocketLoopEnable");
-	bool enableLowLatencyMode = config_get_bool(main->Config(), "Output",
-			"LowLatencyEnable");
 
 	int idx = ui->processPriority->findData(processPriority);
 	if (idx == -1)
 		idx = ui->processPriority->findData("Normal");
 	ui->processPriority->setCurrentIndex(idx);
 
-	ui->enableNewSocketLoop->setChecked(enableNewSocketLoop);
-	ui->enableLowLatencyMode->setChecked(enableLowLatencyMode);
-
 	bool browserHWAccel = config_get_bool(App()->GlobalConfig(),
 			"General", "BrowserHWAccel");
 	ui->browserHWAccel->setChecked(browserHWAccel);
 #endif
 
+#if defined(_WIN32) || defined(__linux__)
+	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
+			"NewSocketLoopEnable");
+	bool enableLowLatencyMode = config_get_bool(main->Config(), "Output",
+			"LowLatencyEnable");
+
+	ui->enableNewSocketLoop->setChecked(enableNewSocketLoop);
+	ui->enableLowLatencyMode->setChecked(enableLowLatencyMode);
+#endif
+
 	bool disableFocusHotkeys = config_get_bool(App()->GlobalConfig(),
 			"General", "DisableHotkeysInFocus");
 	ui->disableFocusHotkeys->setChecked(disableFocusHotkeys);
@@ -2924,14 +2931,16 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	if (main->Active())
 		SetProcessPriority(priority.c_str());
 
-	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
-	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
-
 	bool browserHWAccel = ui->browserHWAccel->isChecked();
 	config_set_bool(App()->GlobalConfig(), "General",
 			"BrowserHWAccel", browserHWAccel);
 #endif
 
+#if defined(_WIN32) || defined(__linux__)
+	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
+	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
+#endif
+
 	bool disableFocusHotkeys = ui->disableFocusHotkeys->isChecked();
 	config_set_bool(App()->GlobalConfig(), "General",
 			"DisableHotkeysInFocus", disableFocusHotkeys);
@@ -0,0 +1,174 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/base.h>
+#include <graphics/vec3.h>
+#include "null-subsystem.h"
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device,
+		struct gs_vb_data *data, uint32_t flags)
+{
+	struct gs_vertex_buffer *vb = bzalloc(sizeof(struct gs_vertex_buffer));
+	vb->device  = device;
+	vb->data    = data;
+	vb->num     = data->num;
+	vb->dynamic = flags & GS_DYNAMIC;
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
+{
+	if (vb) {
+		if (vb->device->cur_vertex_buffer == vb)
+			vb->device->cur_vertex_buffer = NULL;
+
+		gs_vbdata_destroy(vb->data);
+		bfree(vb);
+	}
+}
+
+static inline void copy_vb_array(void *dst, const void *src, size_t size)
+{
+	if (dst && src && dst != src)
+		memcpy(dst, src, size);
+}
+
+static inline void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
+		const struct gs_vb_data *data)
+{
+	struct gs_vb_data *cur = vb->data;
+	size_t num = vb->num;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		goto fail;
+	}
+
+	if (data->num != num) {
+		blog(LOG_ERROR, "vertex buffer size mismatch");
+		goto fail;
+	}
+
+	/* draws read straight from vb->data, so only foreign data (passed
+	 * to gs_vertexbuffer_flush_direct) needs to be copied */
+	copy_vb_array(cur->points,   data->points,   num * sizeof(struct vec3));
+	copy_vb_array(cur->normals,  data->normals,  num * sizeof(struct vec3));
+	copy_vb_array(cur->tangents, data->tangents, num * sizeof(struct vec3));
+	copy_vb_array(cur->colors,   data->colors,   num * sizeof(uint32_t));
+
+	for (size_t i = 0; i < cur->num_tex && i < data->num_tex; i++) {
+		struct gs_tvertarray *tv = cur->tvarray + i;
+
+		if (tv->width != data->tvarray[i].width)
+			continue;
+
+		copy_vb_array(tv->array, data->tvarray[i].array,
+				num * tv->width * sizeof(float));
+	}
+
+	return;
+
+fail:
+	blog(LOG_ERROR, "gs_vertexbuffer_flush (null) failed");
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vb)
+{
+	gs_vertexbuffer_flush_internal(vb, vb->data);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vb,
+		const struct gs_vb_data *data)
+{
+	gs_vertexbuffer_flush_internal(vb, data);
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
+{
+	return vb->data;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
+		enum gs_index_type type, void *indices, size_t num,
+		uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(struct gs_index_buffer));
+	size_t width = type == GS_UNSIGNED_LONG ? 4 : 2;
+
+	ib->device  = device;
+	ib->data    = indices;
+	ib->dynamic = flags & GS_DYNAMIC;
+	ib->num     = num;
+	ib->width   = width;
+	ib->size    = width * num;
+	ib->type    = type;
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *ib)
+{
+	if (ib) {
+		if (ib->device->cur_index_buffer == ib)
+			ib->device->cur_index_buffer = NULL;
+
+		bfree(ib->data);
+		bfree(ib);
+	}
+}
+
+static inline void gs_indexbuffer_flush_internal(gs_indexbuffer_t *ib,
+		const void *data)
+{
+	if (!ib->dynamic) {
+		blog(LOG_ERROR, "Index buffer is not dynamic");
+		goto fail;
+	}
+
+	if (data != ib->data)
+		memcpy(ib->data, data, ib->size);
+	return;
+
+fail:
+	blog(LOG_ERROR, "gs_indexbuffer_flush (null) failed");
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *ib)
+{
+	gs_indexbuffer_flush_internal(ib, ib->data);
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *ib, const void *data)
+{
+	gs_indexbuffer_flush_internal(ib, data);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *ib)
+{
+	return ib->data;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *ib)
+{
+	return ib->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *ib)
+{
+	return ib->type;
+}
@@ -0,0 +1,590 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <util/base.h>
+#include <graphics/math-defs.h>
+#include <graphics/vec4.h>
+#include "null-subsystem.h"
+
+static inline int int_max(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+static inline int int_min(int a, int b)
+{
+	return a < b ? a : b;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel formats */
+
+static inline float unorm8(uint8_t val)
+{
+	return (float)val / 255.0f;
+}
+
+static inline uint8_t to_unorm8(float val)
+{
+	if (val <= 0.0f) return 0;
+	if (val >= 1.0f) return 255;
+	return (uint8_t)(val * 255.0f + 0.5f);
+}
+
+static inline bool format_supported(enum gs_color_format format)
+{
+	switch (format) {
+	case GS_A8:
+	case GS_R8:
+	case GS_R8G8:
+	case GS_RGBA:
+	case GS_BGRA:
+	case GS_BGRX:
+	case GS_R32F:
+	case GS_RG32F:
+	case GS_RGBA32F:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void read_pixel(enum gs_color_format format, const uint8_t *ptr,
+		struct vec4 *out)
+{
+	const float *f = (const float*)ptr;
+
+	switch (format) {
+	case GS_A8:
+		vec4_set(out, 0.0f, 0.0f, 0.0f, unorm8(ptr[0]));
+		break;
+	case GS_R8:
+		vec4_set(out, unorm8(ptr[0]), 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_R8G8:
+		vec4_set(out, unorm8(ptr[0]), unorm8(ptr[1]), 0.0f, 1.0f);
+		break;
+	case GS_RGBA:
+		vec4_set(out, unorm8(ptr[0]), unorm8(ptr[1]), unorm8(ptr[2]),
+				unorm8(ptr[3]));
+		break;
+	case GS_BGRA:
+		vec4_set(out, unorm8(ptr[2]), unorm8(ptr[1]), unorm8(ptr[0]),
+				unorm8(ptr[3]));
+		break;
+	case GS_BGRX:
+		vec4_set(out, unorm8(ptr[2]), unorm8(ptr[1]), unorm8(ptr[0]),
+				1.0f);
+		break;
+	case GS_R32F:
+		vec4_set(out, f[0], 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_RG32F:
+		vec4_set(out, f[0], f[1], 0.0f, 1.0f);
+		break;
+	case GS_RGBA32F:
+		vec4_set(out, f[0], f[1], f[2], f[3]);
+		break;
+	default:
+		vec4_zero(out);
+	}
+}
+
+static void write_pixel(enum gs_color_format format, uint8_t *ptr,
+		const struct vec4 *color)
+{
+	float *f = (float*)ptr;
+
+	switch (format) {
+	case GS_A8:
+		ptr[0] = to_unorm8(color->w);
+		break;
+	case GS_R8:
+		ptr[0] = to_unorm8(color->x);
+		break;
+	case GS_R8G8:
+		ptr[0] = to_unorm8(color->x);
+		ptr[1] = to_unorm8(color->y);
+		break;
+	case GS_RGBA:
+		ptr[0] = to_unorm8(color->x);
+		ptr[1] = to_unorm8(color->y);
+		ptr[2] = to_unorm8(color->z);
+		ptr[3] = to_unorm8(color->w);
+		break;
+	case GS_BGRA:
+	case GS_BGRX:
+		ptr[0] = to_unorm8(color->z);
+		ptr[1] = to_unorm8(color->y);
+		ptr[2] = to_unorm8(color->x);
+		ptr[3] = to_unorm8(color->w);
+		break;
+	case GS_R32F:
+		f[0] = color->x;
+		break;
+	case GS_RG32F:
+		f[0] = color->x;
+		f[1] = color->y;
+		break;
+	case GS_RGBA32F:
+		f[0] = color->x;
+		f[1] = color->y;
+		f[2] = color->z;
+		f[3] = color->w;
+		break;
+	default:;
+	}
+}
+
+void null_texture_clear(struct gs_texture *tex, uint32_t face,
+		const struct gs_rect *rect, const struct vec4 *color)
+{
+	uint32_t bpp = gs_get_format_bpp(tex->format) / 8;
+	uint8_t pixel[16];
+	uint8_t *data = null_texture_face(tex, face);
+	int x0 = 0, y0 = 0;
+	int x1 = (int)tex->width, y1 = (int)tex->height;
+
+	if (!format_supported(tex->format))
+		return;
+
+	if (rect) {
+		x0 = int_max(rect->x, 0);
+		y0 = int_max(rect->y, 0);
+		x1 = int_min(rect->x + rect->cx, x1);
+		y1 = int_min(rect->y + rect->cy, y1);
+	}
+
+	write_pixel(tex->format, pixel, color);
+
+	for (int y = y0; y < y1; y++) {
+		uint8_t *row = data + (size_t)y * tex->linesize;
+		for (int x = x0; x < x1; x++)
+			memcpy(row + (size_t)x * bpp, pixel, bpp);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* sampling */
+
+static inline int address_coord(enum gs_address_mode mode, int coord,
+		int size, bool *border)
+{
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		coord %= size;
+		return coord < 0 ? coord + size : coord;
+
+	case GS_ADDRESS_MIRROR: {
+		int period = size * 2;
+		coord %= period;
+		if (coord < 0)
+			coord += period;
+		return coord < size ? coord : period - coord - 1;
+	}
+
+	case GS_ADDRESS_MIRRORONCE:
+		if (coord < 0)
+			coord = -coord - 1;
+		return coord < size ? coord : size - 1;
+
+	case GS_ADDRESS_BORDER:
+		if (coord < 0 || coord >= size) {
+			*border = true;
+			return 0;
+		}
+		return coord;
+
+	case GS_ADDRESS_CLAMP:
+	default:
+		return coord < 0 ? 0 : (coord >= size ? size - 1 : coord);
+	}
+}
+
+static void fetch_texel(const struct gs_texture *tex,
+		const struct gs_sampler_info *info, const uint8_t *data,
+		int x, int y, struct vec4 *out)
+{
+	uint32_t bpp = gs_get_format_bpp(tex->format) / 8;
+	bool border = false;
+
+	x = address_coord(info->address_u, x, (int)tex->width, &border);
+	y = address_coord(info->address_v, y, (int)tex->height, &border);
+
+	if (border)
+		vec4_from_rgba(out, info->border_color);
+	else
+		read_pixel(tex->format, data + (size_t)y * tex->linesize +
+				(size_t)x * bpp, out);
+}
+
+static void sample_texture(const struct gs_texture *tex,
+		const struct gs_sampler_info *info, float u, float v,
+		struct vec4 *out)
+{
+	const uint8_t *data = tex->data;
+	float fx = u * (float)tex->width;
+	float fy = v * (float)tex->height;
+
+	if (info->filter == GS_FILTER_POINT) {
+		fetch_texel(tex, info, data, (int)floorf(fx), (int)floorf(fy),
+				out);
+
+	} else {
+		struct vec4 t00, t10, t01, t11;
+		float x0f = floorf(fx - 0.5f);
+		float y0f = floorf(fy - 0.5f);
+		float ax = fx - 0.5f - x0f;
+		float ay = fy - 0.5f - y0f;
+		int x0 = (int)x0f;
+		int y0 = (int)y0f;
+
+		fetch_texel(tex, info, data, x0,     y0,     &t00);
+		fetch_texel(tex, info, data, x0 + 1, y0,     &t10);
+		fetch_texel(tex, info, data, x0,     y0 + 1, &t01);
+		fetch_texel(tex, info, data, x0 + 1, y0 + 1, &t11);
+
+		vec4_mulf(&t00, &t00, (1.0f - ax) * (1.0f - ay));
+		vec4_mulf(&t10, &t10, ax * (1.0f - ay));
+		vec4_mulf(&t01, &t01, (1.0f - ax) * ay);
+		vec4_mulf(&t11, &t11, ax * ay);
+
+		vec4_add(out, &t00, &t10);
+		vec4_add(out, out, &t01);
+		vec4_add(out, out, &t11);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel "shading" */
+
+struct pixel_source {
+	const struct gs_texture *tex;
+	struct gs_sampler_info  sampler;
+	struct vec4             color;
+	bool                    raw_copy;
+};
+
+static const struct gs_sampler_info default_sampler = {
+	.filter    = GS_FILTER_LINEAR,
+	.address_u = GS_ADDRESS_CLAMP,
+	.address_v = GS_ADDRESS_CLAMP,
+	.address_w = GS_ADDRESS_CLAMP,
+	.max_anisotropy = 1,
+};
+
+/*
+ * Picks what a pixel shader "outputs": the first texture parameter that has
+ * a texture bound to it, otherwise a constant "color" parameter (as used by
+ * solid.effect), otherwise white.
+ */
+static void get_pixel_source(const struct gs_device *device,
+		const struct gs_texture *target, struct pixel_source *src)
+{
+	struct gs_shader *ps = device->cur_pixel_shader;
+
+	memset(src, 0, sizeof(*src));
+	vec4_set(&src->color, 1.0f, 1.0f, 1.0f, 1.0f);
+	src->sampler = default_sampler;
+
+	for (size_t i = 0; i < ps->params.num; i++) {
+		struct gs_shader_param *param = ps->params.array + i;
+		struct gs_texture *tex = param->texture;
+		struct gs_sampler_state *ss;
+
+		if (param->type != GS_SHADER_PARAM_TEXTURE || !tex)
+			continue;
+		if (tex->type != GS_TEXTURE_2D ||
+		    !format_supported(tex->format))
+			continue;
+
+		ss = param->next_sampler;
+		if (!ss && ps->samplers.num)
+			ss = ps->samplers.array[0];
+		if (ss)
+			src->sampler = ss->info;
+
+		src->tex = tex;
+		src->raw_copy = tex->format == target->format &&
+			src->sampler.filter == GS_FILTER_POINT &&
+			!device->blend.enabled;
+		return;
+	}
+
+	struct gs_shader_param *color = NULL;
+	for (size_t i = 0; i < ps->params.num; i++) {
+		struct gs_shader_param *param = ps->params.array + i;
+		if (param->type == GS_SHADER_PARAM_VEC4 &&
+		    strcmp(param->name, "color") == 0) {
+			color = param;
+			break;
+		}
+	}
+
+	if (color && color->cur_value.num == sizeof(float) * 4)
+		memcpy(src->color.ptr, color->cur_value.array,
+				sizeof(float) * 4);
+}
+
+/* ------------------------------------------------------------------------- */
+/* blending */
+
+static inline float blend_factor(enum gs_blend_type type, float channel_src,
+		float channel_dst, const struct vec4 *src,
+		const struct vec4 *dst)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:        return 0.0f;
+	case GS_BLEND_ONE:         return 1.0f;
+	case GS_BLEND_SRCCOLOR:    return channel_src;
+	case GS_BLEND_INVSRCCOLOR: return 1.0f - channel_src;
+	case GS_BLEND_SRCALPHA:    return src->w;
+	case GS_BLEND_INVSRCALPHA: return 1.0f - src->w;
+	case GS_BLEND_DSTCOLOR:    return channel_dst;
+	case GS_BLEND_INVDSTCOLOR: return 1.0f - channel_dst;
+	case GS_BLEND_DSTALPHA:    return dst->w;
+	case GS_BLEND_INVDSTALPHA: return 1.0f - dst->w;
+	case GS_BLEND_SRCALPHASAT: return fminf(src->w, 1.0f - dst->w);
+	}
+
+	return 1.0f;
+}
+
+static void blend_pixel(const struct null_blend_state *blend,
+		const struct vec4 *src, struct vec4 *dst)
+{
+	struct vec4 out;
+
+	for (int i = 0; i < 3; i++) {
+		float s = src->ptr[i];
+		float d = dst->ptr[i];
+
+		out.ptr[i] = s * blend_factor(blend->src_c, s, d, src, dst) +
+		             d * blend_factor(blend->dest_c, s, d, src, dst);
+	}
+
+	out.w = src->w * blend_factor(blend->src_a, src->w, dst->w, src, dst) +
+	        dst->w * blend_factor(blend->dest_a, src->w, dst->w, src, dst);
+
+	*dst = out;
+}
+
+static void output_pixel(const struct gs_device *device,
+		const struct gs_texture *target, uint8_t *ptr,
+		const struct vec4 *color)
+{
+	const struct null_blend_state *blend = &device->blend;
+	struct vec4 dst;
+	struct vec4 out;
+
+	read_pixel(target->format, ptr, &dst);
+
+	if (blend->enabled) {
+		out = dst;
+		blend_pixel(blend, color, &out);
+	} else {
+		out = *color;
+	}
+
+	if (!blend->write_r) out.x = dst.x;
+	if (!blend->write_g) out.y = dst.y;
+	if (!blend->write_b) out.z = dst.z;
+	if (!blend->write_a) out.w = dst.w;
+
+	write_pixel(target->format, ptr, &out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* triangle setup and rasterization */
+
+struct raster_vert {
+	float x, y;
+	float inv_w;
+	float u_w, v_w;
+};
+
+static inline float edge(const struct raster_vert *a,
+		const struct raster_vert *b, float x, float y)
+{
+	return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+/* top-left fill rule, so that pixels on edges shared by two triangles of a
+ * quad are only drawn once */
+static inline bool is_top_left(const struct raster_vert *a,
+		const struct raster_vert *b)
+{
+	float dx = b->x - a->x;
+	float dy = b->y - a->y;
+	return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+}
+
+static inline bool inside_edge(float w, bool top_left)
+{
+	return w > 0.0f || (w == 0.0f && top_left);
+}
+
+static inline void get_clip_rect(const struct gs_device *device,
+		const struct gs_texture *target, struct gs_rect *rect)
+{
+	const struct gs_rect *vp = &device->cur_viewport;
+	int x0 = int_max(vp->x, 0);
+	int y0 = int_max(vp->y, 0);
+	int x1 = int_min(vp->x + vp->cx, (int)target->width);
+	int y1 = int_min(vp->y + vp->cy, (int)target->height);
+
+	if (device->scissor_enabled) {
+		const struct gs_rect *sc = &device->cur_scissor;
+		x0 = int_max(x0, sc->x);
+		y0 = int_max(y0, sc->y);
+		x1 = int_min(x1, sc->x + sc->cx);
+		y1 = int_min(y1, sc->y + sc->cy);
+	}
+
+	rect->x  = x0;
+	rect->y  = y0;
+	rect->cx = x1 - x0;
+	rect->cy = y1 - y0;
+}
+
+void null_draw_triangle(struct gs_device *device,
+		const struct vec4 clip[3], const struct vec2 uv[3])
+{
+	struct gs_texture *target = device->cur_render_target;
+	const struct gs_rect *vp = &device->cur_viewport;
+	struct raster_vert v[3];
+	struct pixel_source src;
+	struct gs_rect bounds;
+	uint8_t *data;
+	uint32_t bpp;
+	float area, min_x, min_y, max_x, max_y;
+	bool tl0, tl1, tl2;
+	int x0, y0, x1, y1;
+
+	if (!format_supported(target->format))
+		return;
+
+	/* no near plane clipping, triangles crossing w = 0 are dropped */
+	for (int i = 0; i < 3; i++) {
+		if (clip[i].w <= LARGE_EPSILON)
+			return;
+
+		v[i].inv_w = 1.0f / clip[i].w;
+		v[i].x = (float)vp->x + (clip[i].x * v[i].inv_w + 1.0f) *
+			0.5f * (float)vp->cx;
+		v[i].y = (float)vp->y + (1.0f - clip[i].y * v[i].inv_w) *
+			0.5f * (float)vp->cy;
+		v[i].u_w = uv[i].x * v[i].inv_w;
+		v[i].v_w = uv[i].y * v[i].inv_w;
+	}
+
+	area = edge(&v[0], &v[1], v[2].x, v[2].y);
+	if (fabsf(area) < EPSILON)
+		return;
+
+	/* culling is not emulated, so both windings are rasterized */
+	if (area < 0.0f) {
+		struct raster_vert temp = v[1];
+		v[1] = v[2];
+		v[2] = temp;
+		area = -area;
+	}
+
+	tl0 = is_top_left(&v[1], &v[2]);
+	tl1 = is_top_left(&v[2], &v[0]);
+	tl2 = is_top_left(&v[0], &v[1]);
+
+	get_clip_rect(device, target, &bounds);
+
+	min_x = fminf(fminf(v[0].x, v[1].x), v[2].x);
+	min_y = fminf(fminf(v[0].y, v[1].y), v[2].y);
+	max_x = fmaxf(fmaxf(v[0].x, v[1].x), v[2].x);
+	max_y = fmaxf(fmaxf(v[0].y, v[1].y), v[2].y);
+
+	x0 = int_max((int)floorf(min_x), bounds.x);
+	y0 = int_max((int)floorf(min_y), bounds.y);
+	x1 = int_min((int)ceilf(max_x), bounds.x + bounds.cx);
+	y1 = int_min((int)ceilf(max_y), bounds.y + bounds.cy);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	get_pixel_source(device, target, &src);
+
+	data = null_texture_face(target, (uint32_t)device->cur_render_side);
+	bpp  = gs_get_format_bpp(target->format) / 8;
+
+	for (int y = y0; y < y1; y++) {
+		uint8_t *row = data + (size_t)y * target->linesize;
+		float py = (float)y + 0.5f;
+
+		for (int x = x0; x < x1; x++) {
+			float px = (float)x + 0.5f;
+			float w0 = edge(&v[1], &v[2], px, py);
+			float w1 = edge(&v[2], &v[0], px, py);
+			float w2 = edge(&v[0], &v[1], px, py);
+			struct vec4 color;
+
+			if (!inside_edge(w0, tl0) || !inside_edge(w1, tl1) ||
+			    !inside_edge(w2, tl2))
+				continue;
+
+			w0 /= area;
+			w1 /= area;
+			w2 /= area;
+
+			if (src.tex) {
+				float inv_w = w0 * v[0].inv_w +
+				              w1 * v[1].inv_w +
+				              w2 * v[2].inv_w;
+				float u = (w0 * v[0].u_w + w1 * v[1].u_w +
+				           w2 * v[2].u_w) / inv_w;
+				float t = (w0 * v[0].v_w + w1 * v[1].v_w +
+				           w2 * v[2].v_w) / inv_w;
+
+				if (src.raw_copy) {
+					bool border = false;
+					int tx = address_coord(
+						src.sampler.address_u,
+						(int)floorf(u * src.tex->width),
+						(int)src.tex->width, &border);
+					int ty = address_coord(
+						src.sampler.address_v,
+						(int)floorf(t * src.tex->height),
+						(int)src.tex->height, &border);
+
+					if (!border) {
+						memcpy(row + (size_t)x * bpp,
+							src.tex->data +
+							(size_t)ty *
+							src.tex->linesize +
+							(size_t)tx * bpp, bpp);
+						continue;
+					}
+				}
+
+				sample_texture(src.tex, &src.sampler, u, t,
+						&color);
+			} else {
+				color = src.color;
+			}
+
+			output_pixel(device, target, row + (size_t)x * bpp,
+					&color);
+		}
+	}
+}
@@ -0,0 +1,175 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Null graphics subsystem
+ *
+ *   A graphics module that keeps every resource in system memory and does
+ * not talk to any GPU or windowing system.  It exists so that libobs can run
+ * its complete video pipeline (scenes, texture rendering, format conversion,
+ * staging, encoders and outputs) on machines without a display, for example
+ * on CI runners.
+ *
+ *   Draw calls are executed by a small software rasterizer that handles
+ * triangle lists/strips with an ortho or perspective projection, samples the
+ * first texture bound to the pixel shader (point or bilinear), and applies
+ * the current blend state.  Shader code itself is not executed, so effects
+ * that do math in their pixel shaders (color space conversion, scaling
+ * kernels, filters) produce geometrically correct but not color accurate
+ * output.
+ */
+
+#include <util/darray.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/vec2.h>
+#include <graphics/matrix4.h>
+
+struct gs_sampler_state {
+	gs_device_t          *device;
+	struct gs_sampler_info info;
+};
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char                 *name;
+	gs_shader_t          *shader;
+	gs_samplerstate_t    *next_sampler;
+	int                  array_count;
+
+	struct gs_texture    *texture;
+
+	DARRAY(uint8_t)      cur_value;
+	DARRAY(uint8_t)      def_value;
+};
+
+struct gs_shader {
+	gs_device_t          *device;
+	enum gs_shader_type  type;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t*)      samplers;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t          *device;
+	size_t               num;
+	bool                 dynamic;
+	struct gs_vb_data    *data;
+};
+
+struct gs_index_buffer {
+	gs_device_t          *device;
+	enum gs_index_type   type;
+	void                 *data;
+	size_t               num;
+	size_t               width;
+	size_t               size;
+	bool                 dynamic;
+};
+
+struct gs_texture {
+	gs_device_t          *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             levels;
+	uint32_t             faces;
+	uint32_t             linesize;
+	bool                 is_dynamic;
+	bool                 is_render_target;
+
+	/* only the top mip level is stored, faces are stored back to back */
+	uint8_t              *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t          *device;
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             linesize;
+	uint8_t              *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t          *device;
+	enum gs_zstencil_format format;
+	uint32_t             width;
+	uint32_t             height;
+};
+
+struct gs_swap_chain {
+	gs_device_t          *device;
+	struct gs_init_data  info;
+};
+
+struct null_blend_state {
+	bool                 enabled;
+	enum gs_blend_type   src_c;
+	enum gs_blend_type   dest_c;
+	enum gs_blend_type   src_a;
+	enum gs_blend_type   dest_a;
+	bool                 write_r;
+	bool                 write_g;
+	bool                 write_b;
+	bool                 write_a;
+};
+
+struct gs_device {
+	struct gs_vertex_buffer *cur_vertex_buffer;
+	struct gs_index_buffer  *cur_index_buffer;
+	struct gs_shader        *cur_vertex_shader;
+	struct gs_shader        *cur_pixel_shader;
+	struct gs_texture       *cur_render_target;
+	struct gs_zstencil_buffer *cur_zstencil_buffer;
+	struct gs_swap_chain    *cur_swap;
+	int                     cur_render_side;
+
+	struct gs_texture       *cur_textures[GS_MAX_TEXTURES];
+	struct gs_sampler_state *cur_samplers[GS_MAX_TEXTURES];
+
+	enum gs_cull_mode       cur_cull_mode;
+	struct null_blend_state blend;
+	struct gs_rect          cur_viewport;
+	struct gs_rect          cur_scissor;
+	bool                    scissor_enabled;
+
+	struct matrix4          cur_proj;
+	struct matrix4          cur_view;
+	struct matrix4          cur_viewproj;
+
+	DARRAY(struct matrix4)  proj_stack;
+};
+
+static inline uint8_t *null_texture_face(struct gs_texture *tex, uint32_t face)
+{
+	return tex->data + (size_t)tex->linesize * tex->height * face;
+}
+
+extern void null_texture_clear(struct gs_texture *tex, uint32_t face,
+		const struct gs_rect *rect, const struct vec4 *color);
+
+extern void null_draw_triangle(struct gs_device *device,
+		const struct vec4 clip[3], const struct vec2 uv[3]);
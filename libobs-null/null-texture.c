@@ -0,0 +1,400 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/base.h>
+#include "null-subsystem.h"
+
+static inline uint32_t get_linesize(enum gs_color_format format,
+		uint32_t width)
+{
+	uint32_t bpp = gs_get_format_bpp(format);
+
+	if (gs_is_compressed_format(format))
+		return ((width + 3) / 4) * bpp * 2;
+	return width * bpp / 8;
+}
+
+static inline uint32_t get_rows(enum gs_color_format format, uint32_t height)
+{
+	return gs_is_compressed_format(format) ? (height + 3) / 4 : height;
+}
+
+static struct gs_texture *create_texture(gs_device_t *device,
+		enum gs_texture_type type, uint32_t width, uint32_t height,
+		uint32_t faces, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture *tex;
+	uint32_t rows;
+	size_t face_size;
+
+	if (!gs_get_format_bpp(color_format)) {
+		blog(LOG_ERROR, "Invalid texture format");
+		return NULL;
+	}
+
+	tex = bzalloc(sizeof(struct gs_texture));
+	tex->device           = device;
+	tex->type             = type;
+	tex->format           = color_format;
+	tex->width            = width;
+	tex->height           = height;
+	tex->faces            = faces;
+	tex->levels           = levels;
+	tex->linesize         = get_linesize(color_format, width);
+	tex->is_dynamic       = (flags & GS_DYNAMIC) != 0;
+	tex->is_render_target = (flags & GS_RENDER_TARGET) != 0;
+
+	rows      = get_rows(color_format, height);
+	face_size = (size_t)tex->linesize * rows;
+	tex->data = bzalloc(face_size * faces);
+
+	if (data) {
+		/* only the top level of each face is kept */
+		uint32_t stride = levels ? levels : 1;
+
+		for (uint32_t i = 0; i < faces; i++) {
+			const uint8_t *face_data = data[i * stride];
+			if (face_data)
+				memcpy(tex->data + face_size * i, face_data,
+						face_size);
+		}
+	}
+
+	return tex;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture *tex = create_texture(device, GS_TEXTURE_2D,
+			width, height, 1, color_format, levels, data, flags);
+	if (!tex)
+		blog(LOG_ERROR, "device_texture_create (null) failed");
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture *tex = create_texture(device, GS_TEXTURE_CUBE,
+			size, size, 6, color_format, levels, data, flags);
+	if (!tex)
+		blog(LOG_ERROR, "device_cubetexture_create (null) failed");
+	return tex;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, uint32_t depth,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	/* volume textures are not implemented by the GL module either */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return NULL;
+}
+
+static inline bool is_texture_2d(const gs_texture_t *tex, const char *func)
+{
+	bool is_tex2d = tex->type == GS_TEXTURE_2D;
+	if (!is_tex2d)
+		blog(LOG_ERROR, "%s (null): Texture is not a 2D texture", func);
+	return is_tex2d;
+}
+
+static inline bool is_texture_cube(const gs_texture_t *tex, const char *func)
+{
+	bool is_texcube = tex->type == GS_TEXTURE_CUBE;
+	if (!is_texcube)
+		blog(LOG_ERROR, "%s (null): Texture is not a cube texture",
+				func);
+	return is_texcube;
+}
+
+static void texture_destroy(gs_texture_t *tex)
+{
+	struct gs_device *device = tex->device;
+
+	if (device->cur_render_target == tex)
+		device->cur_render_target = NULL;
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_textures[i] == tex)
+			device->cur_textures[i] = NULL;
+	}
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (tex)
+		texture_destroy(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_width"))
+		return 0;
+
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_height"))
+		return 0;
+
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (!is_texture_2d(tex, "gs_texture_map"))
+		goto fail;
+
+	if (!tex->is_dynamic) {
+		blog(LOG_ERROR, "Texture is not dynamic");
+		goto fail;
+	}
+
+	*ptr      = tex->data;
+	*linesize = tex->linesize;
+	return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_map (null) failed");
+	return false;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_set_image_region(gs_texture_t *tex, const uint8_t *data,
+		uint32_t linesize, uint32_t x, uint32_t y,
+		uint32_t cx, uint32_t cy)
+{
+	uint32_t bpp;
+
+	if (!is_texture_2d(tex, "gs_texture_set_image_region"))
+		return false;
+
+	if (gs_is_compressed_format(tex->format))
+		return false;
+
+	if (x + cx > tex->width || y + cy > tex->height) {
+		blog(LOG_ERROR, "gs_texture_set_image_region (null): region "
+		                "is out of bounds");
+		return false;
+	}
+
+	bpp = gs_get_format_bpp(tex->format) / 8;
+
+	for (uint32_t row = 0; row < cy; row++)
+		memcpy(tex->data + (size_t)(y + row) * tex->linesize + x * bpp,
+		       data + (size_t)row * linesize, (size_t)cx * bpp);
+
+	return true;
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	if (cubetex)
+		texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	if (!is_texture_cube(cubetex, "gs_cubetexture_get_size"))
+		return 0;
+
+	return cubetex->width;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(
+		const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return GS_UNKNOWN;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	if (!gs_get_format_bpp(color_format) ||
+	    gs_is_compressed_format(color_format)) {
+		blog(LOG_ERROR, "device_stagesurface_create (null): Invalid "
+		                "format");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device   = device;
+	surf->format   = color_format;
+	surf->width    = width;
+	surf->height   = height;
+	surf->linesize = get_linesize(color_format, width);
+	surf->data     = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(
+		const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+		uint32_t *linesize)
+{
+	*data     = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs;
+
+	zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width  = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zs)
+{
+	if (zs) {
+		if (zs->device->cur_zstencil_buffer == zs)
+			zs->device->cur_zstencil_buffer = NULL;
+		bfree(zs);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_samplerstate_t *device_samplerstate_create(gs_device_t *device,
+		const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler;
+
+	sampler = bzalloc(sizeof(struct gs_sampler_state));
+	sampler->device = device;
+	sampler->info   = *info;
+	return sampler;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (samplerstate->device->cur_samplers[i] == samplerstate)
+			samplerstate->device->cur_samplers[i] = NULL;
+	}
+
+	bfree(samplerstate);
+}
@@ -229,6 +229,49 @@ failed:
 	blog(LOG_ERROR, "gs_texture_unmap (GL) failed");
 }
 
+bool gs_texture_set_image_region(gs_texture_t *tex, const uint8_t *data,
+		uint32_t linesize, uint32_t x, uint32_t y,
+		uint32_t cx, uint32_t cy)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	uint32_t bpp;
+
+	if (!is_texture_2d(tex, "gs_texture_set_image_region"))
+		goto fail;
+
+	if (gs_is_compressed_format(tex->format)) {
+		blog(LOG_ERROR, "Cannot partially update compressed textures");
+		goto fail;
+	}
+
+	if (x + cx > tex2d->width || y + cy > tex2d->height) {
+		blog(LOG_ERROR, "Region is outside of the texture");
+		goto fail;
+	}
+
+	bpp = gs_get_format_bpp(tex->format) / 8;
+
+	if (!gl_bind_texture(tex->gl_target, tex->texture))
+		goto fail;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bpp);
+	glTexSubImage2D(tex->gl_target, 0, x, y, cx, cy,
+			tex->gl_format, tex->gl_type, data);
+	if (!gl_success("glTexSubImage2D")) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		gl_bind_texture(tex->gl_target, 0);
+		goto fail;
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	gl_bind_texture(tex->gl_target, 0);
+	return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_set_image_region (GL) failed");
+	return false;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	const struct gs_texture_2d *tex2d = (const struct gs_texture_2d*)tex;
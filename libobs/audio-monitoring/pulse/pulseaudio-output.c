@@ -4,6 +4,16 @@
 #define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
+/* in low latency mode, the latency error is smoothed and then corrected by
+ * playing up to MAX_RATE_ADJUST faster or slower, RATE_ADJUST_GAIN times the
+ * error in seconds */
+#define LATENCY_SMOOTHING 0.05
+#define RATE_ADJUST_GAIN  0.05
+#define MAX_RATE_ADJUST   0.001
+
+/* latency error past which queued audio is flushed instead */
+#define LATENCY_RESYNC_NS 200000000LL
+
 struct audio_monitor {
 	obs_source_t 		*source;
 	pa_stream    		*stream;
@@ -26,6 +36,20 @@ struct audio_monitor {
 
 	bool 			ignore;
 	pthread_mutex_t 	playback_mutex;
+
+	/* low latency mode, target_latency is 0 when not used.  the stream
+	 * is played slightly faster or slower than the libobs audio clock to
+	 * stay at the target latency */
+	uint64_t		target_latency;
+	double			latency_error;
+	double			rate_adjust;
+	double			rate_pos;
+	float			prev_frame[MAX_AUDIO_CHANNELS];
+	DARRAY(float)		rate_buf;
+
+	volatile long		latency_us;
+	volatile long		underruns;
+	volatile long		rate_adjust_ppm;
 };
 
 static enum speaker_layout pulseaudio_channels_to_obs_speakers(
@@ -162,10 +186,32 @@ void process_volume(const struct audio_monitor *monitor, float vol,
 	}
 }
 
+/* gets the audio waiting to be played, call with the mainloop locked */
+static bool get_stream_latency(struct audio_monitor *monitor,
+		uint64_t *latency)
+{
+	pa_usec_t usec = 0;
+	int negative = 0;
+	size_t queued_frames;
+
+	if (pa_stream_get_latency(monitor->stream, &usec, &negative) != 0)
+		return false;
+
+	queued_frames = monitor->new_data.size / monitor->bytes_per_frame;
+
+	*latency = negative ? 0 : (uint64_t)usec * 1000;
+	*latency += (uint64_t)queued_frames * 1000000000ULL /
+		monitor->samples_per_sec;
+
+	os_atomic_set_long(&monitor->latency_us, (long)(*latency / 1000));
+	return true;
+}
+
 static void do_stream_write(void *param)
 {
 	PULSE_DATA(param);
 	uint8_t *buffer = NULL;
+	uint64_t latency;
 
 	while (data->new_data.size >= data->buffer_size &&
 			data->bytesRemaining > 0) {
@@ -174,18 +220,138 @@ static void do_stream_write(void *param)
 		if (bytesToFill > data->bytesRemaining)
 			bytesToFill = data->bytesRemaining;
 
+		pulseaudio_lock();
 		pa_stream_begin_write(data->stream, (void **) &buffer,
 				&bytesToFill);
 
 		circlebuf_pop_front(&data->new_data, buffer, bytesToFill);
 
-		pulseaudio_lock();
 		pa_stream_write(data->stream, buffer, bytesToFill, NULL,
 				0LL, PA_SEEK_RELATIVE);
 		pulseaudio_unlock();
 
 		data->bytesRemaining -= bytesToFill;
 	}
+
+	pulseaudio_lock();
+	get_stream_latency(data, &latency);
+	pulseaudio_unlock();
+}
+
+/* plays audio 1 + rate_adjust times as fast by interpolating between
+ * frames.  prev_frame is the last frame of the previous call, rate_pos is
+ * the position of the next output frame, starting from prev_frame at -1 */
+static size_t apply_rate_adjust(struct audio_monitor *monitor,
+		const float *in, size_t frames, const float **out)
+{
+	const size_t channels = monitor->channels;
+	const double step = 1.0 / (1.0 + monitor->rate_adjust);
+	double pos = monitor->rate_pos;
+	size_t count = 0;
+
+	if (!frames)
+		return 0;
+
+	da_resize(monitor->rate_buf, (frames + frames / 64 + 2) * channels);
+
+	while (pos < (double)(frames - 1)) {
+		/* pos is never below -1 */
+		ptrdiff_t idx = (ptrdiff_t)(pos + 1.0) - 1;
+		float frac = (float)(pos - (double)idx);
+		const float *a = idx < 0 ? monitor->prev_frame :
+			in + idx * channels;
+		const float *b = in + (idx + 1) * channels;
+		float *dst = monitor->rate_buf.array + count * channels;
+
+		for (size_t ch = 0; ch < channels; ch++)
+			dst[ch] = a[ch] + (b[ch] - a[ch]) * frac;
+
+		count++;
+		pos += step;
+	}
+
+	monitor->rate_pos = pos - (double)frames;
+	memcpy(monitor->prev_frame, in + (frames - 1) * channels,
+			channels * sizeof(float));
+
+	*out = monitor->rate_buf.array;
+	return count;
+}
+
+/* call with the mainloop locked */
+static void update_rate_adjust(struct audio_monitor *monitor,
+		uint64_t latency)
+{
+	int64_t error = (int64_t)latency - (int64_t)monitor->target_latency;
+	double rate;
+
+	/* too far off to correct smoothly, e.g. after a stall */
+	if (error > LATENCY_RESYNC_NS) {
+		pa_operation *op = pa_stream_flush(monitor->stream, NULL, NULL);
+		if (op)
+			pa_operation_unref(op);
+
+		circlebuf_free(&monitor->new_data);
+		monitor->latency_error = 0.0;
+		monitor->rate_adjust = 0.0;
+
+		blog(LOG_DEBUG, "Latency of '%s' was %"PRIu64" ms, flushed",
+				obs_source_get_name(monitor->source),
+				latency / 1000000);
+		return;
+	}
+
+	monitor->latency_error += ((double)error / 1000000000.0 -
+			monitor->latency_error) * LATENCY_SMOOTHING;
+
+	rate = -monitor->latency_error * RATE_ADJUST_GAIN;
+	if (rate > MAX_RATE_ADJUST)
+		rate = MAX_RATE_ADJUST;
+	if (rate < -MAX_RATE_ADJUST)
+		rate = -MAX_RATE_ADJUST;
+
+	monitor->rate_adjust = rate;
+	os_atomic_set_long(&monitor->rate_adjust_ppm, (long)(rate * 1e6));
+}
+
+/* writes as much as the stream wants right away, and keeps the rest */
+static void do_stream_write_low_latency(struct audio_monitor *monitor)
+{
+	size_t bytes;
+	uint64_t latency;
+
+	pulseaudio_lock();
+
+	bytes = pa_stream_writable_size(monitor->stream);
+	if (bytes == (size_t)-1)
+		bytes = 0;
+	if (bytes > monitor->new_data.size)
+		bytes = monitor->new_data.size;
+
+	while (bytes) {
+		size_t chunk = bytes;
+		void *buffer = NULL;
+
+		if (pa_stream_begin_write(monitor->stream, &buffer,
+					&chunk) != 0 || !buffer)
+			break;
+
+		chunk -= chunk % monitor->bytes_per_frame;
+		if (!chunk) {
+			pa_stream_cancel_write(monitor->stream);
+			break;
+		}
+
+		circlebuf_pop_front(&monitor->new_data, buffer, chunk);
+		pa_stream_write(monitor->stream, buffer, chunk, NULL, 0LL,
+				PA_SEEK_RELATIVE);
+		bytes -= chunk;
+	}
+
+	if (get_stream_latency(monitor, &latency))
+		update_rate_adjust(monitor, latency);
+
+	pulseaudio_unlock();
 }
 
 static void on_audio_playback(void *param, obs_source_t *source,
@@ -225,6 +391,24 @@ static void on_audio_playback(void *param, obs_source_t *source,
 		}
 	}
 
+	if (monitor->target_latency) {
+		const float *adjusted;
+		size_t frames = apply_rate_adjust(monitor,
+				(const float*)resample_data[0],
+				resample_frames, &adjusted);
+
+		circlebuf_push_back(&monitor->new_data, adjusted,
+				frames * monitor->bytes_per_frame);
+		monitor->packets++;
+		monitor->frames += resample_frames;
+
+		/* nothing on the mainloop thread locks playback_mutex in
+		 * low latency mode, so it can stay locked */
+		do_stream_write_low_latency(monitor);
+		pthread_mutex_unlock(&monitor->playback_mutex);
+		return;
+	}
+
 	circlebuf_push_back(&monitor->new_data, resample_data[0], bytes);
 	monitor->packets++;
 	monitor->frames += resample_frames;
@@ -251,6 +435,8 @@ static void pulseaudio_underflow(pa_stream *p, void *userdata)
 	UNUSED_PARAMETER(p);
 	PULSE_DATA(userdata);
 
+	os_atomic_inc_long(&data->underruns);
+
 	pthread_mutex_lock(&data->playback_mutex);
 	if (obs_source_active(data->source))
 		data->attr.tlength = (data->attr.tlength * 3) / 2;
@@ -261,6 +447,17 @@ static void pulseaudio_underflow(pa_stream *p, void *userdata)
 	pulseaudio_signal(0);
 }
 
+static void pulseaudio_underflow_low_latency(pa_stream *p, void *userdata)
+{
+	UNUSED_PARAMETER(p);
+	PULSE_DATA(userdata);
+
+	/* the latency is kept at the target, underruns are only counted */
+	os_atomic_inc_long(&data->underruns);
+
+	pulseaudio_signal(0);
+}
+
 static void pulseaudio_server_info(pa_context *c, const pa_server_info *i,
 		void *userdata)
 {
@@ -328,8 +525,10 @@ static void pulseaudio_stop_playback(struct audio_monitor *monitor)
 	}
 
 	blog(LOG_INFO, "Stopped Monitoring in '%s'", monitor->device);
-	blog(LOG_INFO, "Got %"PRIuFAST32" packets with %"PRIuFAST64" frames",
-			monitor->packets, monitor->frames);
+	blog(LOG_INFO, "Got %"PRIuFAST32" packets with %"PRIuFAST64" frames, "
+			"%ld underruns",
+			monitor->packets, monitor->frames,
+			os_atomic_load_long(&monitor->underruns));
 
 	monitor->packets = 0;
 	monitor->frames = 0;
@@ -387,6 +586,14 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 		return false;
 	}
 
+	monitor->target_latency =
+		(uint64_t)obs->audio.monitoring_latency_ms * 1000000ULL;
+
+	/* rate adjustment works on float samples, pulse converts them to the
+	 * device's format */
+	if (monitor->target_latency)
+		monitor->format = PA_SAMPLE_FLOAT32LE;
+
 	pa_sample_spec spec;
 	spec.format = monitor->format;
 	spec.rate = (uint32_t) monitor->samples_per_sec;
@@ -446,6 +653,24 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
 			PA_STREAM_AUTO_TIMING_UPDATE;
 
+	if (monitor->target_latency) {
+		/* audio arrives once per audio tick, so the server should ask
+		 * for data at least that often */
+		pa_usec_t tick_usec = (pa_usec_t)AUDIO_OUTPUT_FRAMES *
+			1000000ULL / info->samples_per_sec;
+		uint32_t tick_bytes = (uint32_t)pa_usec_to_bytes(tick_usec,
+				&spec);
+
+		monitor->attr.tlength = (uint32_t)pa_usec_to_bytes(
+				monitor->target_latency / 1000, &spec);
+		monitor->attr.minreq = monitor->attr.tlength / 2;
+		if (monitor->attr.minreq > tick_bytes)
+			monitor->attr.minreq = tick_bytes;
+
+		monitor->rate_pos = -1.0;
+		flags |= PA_STREAM_ADJUST_LATENCY;
+	}
+
 	if (pthread_mutex_init(&monitor->playback_mutex, NULL) != 0) {
 		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
 				"Failed to init mutex");
@@ -460,7 +685,12 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 		return false;
 	}
 
-	blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
+	if (monitor->target_latency)
+		blog(LOG_INFO, "Started Monitoring in '%s' with a target "
+				"latency of %"PRIu64" ms", monitor->device,
+				monitor->target_latency / 1000000);
+	else
+		blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
 	return true;
 }
 
@@ -472,6 +702,13 @@ static void audio_monitor_init_final(struct audio_monitor *monitor)
 	obs_source_add_audio_capture_callback(monitor->source,
 			on_audio_playback, monitor);
 
+	if (monitor->target_latency) {
+		pulseaudio_set_underflow_callback(monitor->stream,
+				pulseaudio_underflow_low_latency,
+				(void *) monitor);
+		return;
+	}
+
 	pulseaudio_write_callback(monitor->stream, pulseaudio_stream_write,
 			(void *) monitor);
 
@@ -490,6 +727,7 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 
 	audio_resampler_destroy(monitor->resampler);
 	circlebuf_free(&monitor->new_data);
+	da_free(monitor->rate_buf);
 
 	if (monitor->stream)
 		pulseaudio_stop_playback(monitor);
@@ -550,3 +788,18 @@ void audio_monitor_destroy(struct audio_monitor *monitor)
 		bfree(monitor);
 	}
 }
+
+bool audio_monitor_get_stats(struct audio_monitor *monitor,
+		struct obs_audio_monitoring_stats *stats)
+{
+	if (monitor->ignore || !monitor->stream)
+		return false;
+
+	stats->latency_ns = (uint64_t)os_atomic_load_long(
+			&monitor->latency_us) * 1000;
+	stats->target_latency_ns = monitor->target_latency;
+	stats->underruns = (uint32_t)os_atomic_load_long(&monitor->underruns);
+	stats->rate_adjust_ppm = (int32_t)os_atomic_load_long(
+			&monitor->rate_adjust_ppm);
+	return true;
+}
@@ -479,6 +479,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL      1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_NULL        3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -707,6 +708,14 @@ EXPORT enum gs_color_format gs_texture_get_color_format(
 EXPORT bool     gs_texture_map(gs_texture_t *tex, uint8_t **ptr,
 		uint32_t *linesize);
 EXPORT void     gs_texture_unmap(gs_texture_t *tex);
+/**
+ * Uploads a sub-rectangle of a 2D texture.  data points to the first pixel of
+ * the rectangle and linesize is the row pitch of data.  Returns false if the
+ * graphics subsystem doesn't support partial uploads (currently GL only).
+ */
+EXPORT bool     gs_texture_set_image_region(gs_texture_t *tex,
+		const uint8_t *data, uint32_t linesize,
+		uint32_t x, uint32_t y, uint32_t cx, uint32_t cy);
 /** special-case function (GL only) - specifies whether the texture is a
  * GL_TEXTURE_RECTANGLE type, which doesn't use normalized texture
  * coordinates, doesn't support mipmapping, and requires address clamping */
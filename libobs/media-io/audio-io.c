@@ -26,6 +26,7 @@
 
 #include "audio-io.h"
 #include "audio-resampler.h"
+#include "audio-math.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
@@ -33,21 +34,29 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define nop() do {int invalid = 0;} while(0)
 
-struct audio_input {
-	struct audio_convert_info conversion;
+/* inputs of a mix that want the same format share one conversion, so the mix
+ * is only converted once per format no matter how many inputs want it */
+struct audio_conversion {
+	struct audio_convert_info info;
 	audio_resampler_t         *resampler;
+	size_t                    refs;
+
+	/* result of the current tick */
+	bool                      converted;
+	bool                      success;
+	struct audio_data         data;
+};
+
+struct audio_input {
+	struct audio_conversion *conversion;
 
 	audio_output_callback_t callback;
 	void *param;
 };
 
-static inline void audio_input_free(struct audio_input *input)
-{
-	audio_resampler_destroy(input->resampler);
-}
-
 struct audio_mix {
 	DARRAY(struct audio_input) inputs;
+	DARRAY(struct audio_conversion*) conversions;
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 };
 
@@ -64,6 +73,7 @@ struct audio_output {
 
 	audio_input_callback_t     input_cb;
 	void                       *input_param;
+	size_t                     extra_ticks;
 	pthread_mutex_t            input_mutex;
 	struct audio_mix           mixes[MAX_AUDIO_MIXES];
 };
@@ -115,19 +125,19 @@ static inline size_t min_size(size_t a, size_t b)
 	((val > maxval) ? maxval : ((val < minval) ? minval : val))
 #endif
 
-static bool resample_audio_output(struct audio_input *input,
+static bool resample_audio_output(struct audio_conversion *conversion,
 		struct audio_data *data)
 {
 	bool success = true;
 
-	if (input->resampler) {
+	if (conversion->resampler) {
 		uint8_t  *output[MAX_AV_PLANES];
 		uint32_t frames;
 		uint64_t offset;
 
 		memset(output, 0, sizeof(output));
 
-		success = audio_resampler_resample(input->resampler,
+		success = audio_resampler_resample(conversion->resampler,
 				output, &frames, &offset,
 				(const uint8_t *const *)data->data,
 				data->frames);
@@ -149,15 +159,32 @@ static inline void do_audio_output(struct audio_output *audio,
 
 	pthread_mutex_lock(&audio->input_mutex);
 
+	for (size_t i = 0; i < mix->conversions.num; i++)
+		mix->conversions.array[i]->converted = false;
+
 	for (size_t i = mix->inputs.num; i > 0; i--) {
 		struct audio_input *input = mix->inputs.array+(i-1);
+		struct audio_conversion *conversion = input->conversion;
 
-		for (size_t i = 0; i < audio->planes; i++)
-			data.data[i] = (uint8_t*)mix->buffer[i];
-		data.frames = frames;
-		data.timestamp = timestamp;
+		if (!conversion->converted) {
+			struct audio_data *conv_data = &conversion->data;
+
+			memset(conv_data->data, 0, sizeof(conv_data->data));
+			for (size_t i = 0; i < audio->planes; i++)
+				conv_data->data[i] = (uint8_t*)mix->buffer[i];
+			conv_data->frames = frames;
+			conv_data->timestamp = timestamp;
 
-		if (resample_audio_output(input, &data))
+			conversion->success = resample_audio_output(conversion,
+					conv_data);
+			conversion->converted = true;
+		}
+
+		/* the callback gets its own copy of the data pointers, the
+		 * audio itself is shared by every input of the conversion */
+		data = conversion->data;
+
+		if (conversion->success)
 			input->callback(input->param, mix_idx, &data);
 	}
 
@@ -175,17 +202,8 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		if (!mix->inputs.num)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val >  1.0f) ?  1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			audio_clamp(mix->buffer[plane], float_size);
 	}
 }
 
@@ -271,6 +289,11 @@ static void *audio_thread(void *param)
 
 			input_and_output(audio, audio_time, prev_time);
 			prev_time = audio_time;
+
+			while (audio->extra_ticks) {
+				audio->extra_ticks--;
+				input_and_output(audio, audio_time, audio_time);
+			}
 		}
 
 		profile_end(audio_thread_name);
@@ -298,12 +321,24 @@ static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx,
 	return DARRAY_INVALID;
 }
 
-static inline bool audio_input_init(struct audio_input *input,
-		struct audio_output *audio)
+static inline bool convert_info_equal(const struct audio_convert_info *a,
+		const struct audio_convert_info *b)
+{
+	return a->format          == b->format          &&
+	       a->samples_per_sec == b->samples_per_sec &&
+	       a->speakers        == b->speakers;
+}
+
+static struct audio_conversion *audio_conversion_create(
+		struct audio_output *audio,
+		const struct audio_convert_info *info)
 {
-	if (input->conversion.format          != audio->info.format          ||
-	    input->conversion.samples_per_sec != audio->info.samples_per_sec ||
-	    input->conversion.speakers        != audio->info.speakers) {
+	struct audio_conversion *conversion;
+	audio_resampler_t *resampler = NULL;
+
+	if (info->format          != audio->info.format          ||
+	    info->samples_per_sec != audio->info.samples_per_sec ||
+	    info->speakers        != audio->info.speakers) {
 		struct resample_info from = {
 			.format          = audio->info.format,
 			.samples_per_sec = audio->info.samples_per_sec,
@@ -311,24 +346,64 @@ static inline bool audio_input_init(struct audio_input *input,
 		};
 
 		struct resample_info to = {
-			.format          = input->conversion.format,
-			.samples_per_sec = input->conversion.samples_per_sec,
-			.speakers        = input->conversion.speakers
+			.format          = info->format,
+			.samples_per_sec = info->samples_per_sec,
+			.speakers        = info->speakers
 		};
 
-		input->resampler = audio_resampler_create(&to, &from);
-		if (!input->resampler) {
-			blog(LOG_ERROR, "audio_input_init: Failed to "
+		resampler = audio_resampler_create(&to, &from);
+		if (!resampler) {
+			blog(LOG_ERROR, "audio_conversion_create: Failed to "
 			                "create resampler");
-			return false;
+			return NULL;
 		}
-	} else {
-		input->resampler = NULL;
 	}
 
+	conversion = bzalloc(sizeof(struct audio_conversion));
+	conversion->info      = *info;
+	conversion->resampler = resampler;
+	return conversion;
+}
+
+static inline bool audio_input_init(struct audio_input *input,
+		struct audio_output *audio, struct audio_mix *mix,
+		const struct audio_convert_info *info)
+{
+	struct audio_conversion *conversion = NULL;
+
+	for (size_t i = 0; i < mix->conversions.num; i++) {
+		if (convert_info_equal(&mix->conversions.array[i]->info,
+					info)) {
+			conversion = mix->conversions.array[i];
+			break;
+		}
+	}
+
+	if (!conversion) {
+		conversion = audio_conversion_create(audio, info);
+		if (!conversion)
+			return false;
+
+		da_push_back(mix->conversions, &conversion);
+	}
+
+	conversion->refs++;
+	input->conversion = conversion;
 	return true;
 }
 
+static inline void audio_input_free(struct audio_input *input,
+		struct audio_mix *mix)
+{
+	struct audio_conversion *conversion = input->conversion;
+
+	if (--conversion->refs == 0) {
+		da_erase_item(mix->conversions, &conversion);
+		audio_resampler_destroy(conversion->resampler);
+		bfree(conversion);
+	}
+}
+
 bool audio_output_connect(audio_t *audio, size_t mi,
 		const struct audio_convert_info *conversion,
 		audio_output_callback_t callback, void *param)
@@ -341,28 +416,27 @@ bool audio_output_connect(audio_t *audio, size_t mi,
 
 	if (audio_get_input_idx(audio, mi, callback, param) == DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mi];
+		struct audio_convert_info info;
 		struct audio_input input;
 		input.callback = callback;
 		input.param    = param;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			info = *conversion;
 		} else {
-			input.conversion.format = audio->info.format;
-			input.conversion.speakers = audio->info.speakers;
-			input.conversion.samples_per_sec =
-				audio->info.samples_per_sec;
+			info.format = audio->info.format;
+			info.speakers = audio->info.speakers;
+			info.samples_per_sec = audio->info.samples_per_sec;
 		}
 
-		if (input.conversion.format == AUDIO_FORMAT_UNKNOWN)
-			input.conversion.format = audio->info.format;
-		if (input.conversion.speakers == SPEAKERS_UNKNOWN)
-			input.conversion.speakers = audio->info.speakers;
-		if (input.conversion.samples_per_sec == 0)
-			input.conversion.samples_per_sec =
-				audio->info.samples_per_sec;
+		if (info.format == AUDIO_FORMAT_UNKNOWN)
+			info.format = audio->info.format;
+		if (info.speakers == SPEAKERS_UNKNOWN)
+			info.speakers = audio->info.speakers;
+		if (info.samples_per_sec == 0)
+			info.samples_per_sec = audio->info.samples_per_sec;
 
-		success = audio_input_init(&input, audio);
+		success = audio_input_init(&input, audio, mix, &info);
 		if (success)
 			da_push_back(mix->inputs, &input);
 	}
@@ -382,7 +456,7 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx,
 	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
 	if (idx != DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
-		audio_input_free(mix->inputs.array+idx);
+		audio_input_free(mix->inputs.array+idx, mix);
 		da_erase(mix->inputs, idx);
 	}
 
@@ -452,9 +526,10 @@ void audio_output_close(audio_t *audio)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		for (size_t i = 0; i < mix->inputs.num; i++)
-			audio_input_free(mix->inputs.array+i);
+			audio_input_free(mix->inputs.array+i, mix);
 
 		da_free(mix->inputs);
+		da_free(mix->conversions);
 	}
 
 	os_event_destroy(audio->stop_event);
@@ -499,3 +574,9 @@ uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio ? audio->info.samples_per_sec : 0;
 }
+
+void audio_output_request_extra_tick(audio_t *audio)
+{
+	if (audio)
+		audio->extra_ticks++;
+}
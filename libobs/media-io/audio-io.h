@@ -227,6 +227,15 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(
 		const audio_t *audio);
 
+/**
+ * Makes the audio thread call the input callback once more right after the
+ * current call returns, with an empty time range (start == end).  This lets
+ * the input output audio it already has buffered ahead faster than real
+ * time, which lowers latency without leaving a gap in the output.  Only
+ * valid from within the input callback.
+ */
+EXPORT void audio_output_request_extra_tick(audio_t *audio);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,570 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-math.h"
+#include "../util/threading.h"
+#include "../util/base.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define AUDIO_MATH_SSE
+#define AUDIO_MATH_AVX
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define AUDIO_MATH_NEON
+#endif
+
+#ifdef AUDIO_MATH_SSE
+#include <xmmintrin.h>
+#endif
+#ifdef AUDIO_MATH_AVX
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX_FUNC
+#else
+#define AVX_FUNC __attribute__((target("avx")))
+#endif
+#endif
+#ifdef AUDIO_MATH_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every implementation does exactly the same float operations in the same
+ * order for each sample (no fused multiply-add, no reassociation), which is
+ * what keeps them bit exact with each other.  This file is built with
+ * -ffp-contract=off so the compiler doesn't fuse them in the C version
+ * either.  The vector versions process whole vectors and hand the
+ * remainder to the C version.
+ */
+
+struct audio_math_funcs {
+	void (*mix)(float *dst, const float *src, size_t count);
+	void (*mix_gain)(float *dst, const float *src, float gain,
+			size_t count);
+	void (*mix_buf)(float *dst, const float *src, const float *gains,
+			size_t count);
+	void (*scale)(float *data, float gain, size_t count);
+	void (*scale_buf)(float *data, const float *gains, size_t count);
+	void (*clamp)(float *data, size_t count);
+	void (*downmix)(float *dst, const float *const *src, size_t channels,
+			size_t start_idx, size_t count);
+};
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference implementations */
+
+static void mix_c(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void mix_gain_c(float *dst, const float *src, float gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i] * gain;
+}
+
+static void mix_buf_c(float *dst, const float *src, const float *gains,
+		size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i] * gains[i];
+}
+
+static void scale_c(float *data, float gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= gain;
+}
+
+static void scale_buf_c(float *data, const float *gains, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= gains[i];
+}
+
+static void clamp_c(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float val = data[i];
+		val = (val >  1.0f) ?  1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+static void downmix_c(float *dst, const float *const *src, size_t channels,
+		size_t start_idx, size_t count)
+{
+	const float mul = 1.0f / (float)channels;
+
+	for (size_t i = start_idx; i < count; i++) {
+		float sum = src[0][i];
+		for (size_t ch = 1; ch < channels; ch++)
+			sum += src[ch][i];
+		dst[i] = sum * mul;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE: four samples at a time */
+
+#ifdef AUDIO_MATH_SSE
+
+static void mix_sse(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		__m128 s = _mm_loadu_ps(src + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, s));
+	}
+
+	mix_c(dst + i, src + i, count - i);
+}
+
+static void mix_gain_sse(float *dst, const float *src, float gain,
+		size_t count)
+{
+	__m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		__m128 s = _mm_loadu_ps(src + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(s, g)));
+	}
+
+	mix_gain_c(dst + i, src + i, gain, count - i);
+}
+
+static void mix_buf_sse(float *dst, const float *src, const float *gains,
+		size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(dst + i);
+		__m128 s = _mm_loadu_ps(src + i);
+		__m128 g = _mm_loadu_ps(gains + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(s, g)));
+	}
+
+	mix_buf_c(dst + i, src + i, gains + i, count - i);
+}
+
+static void scale_sse(float *data, float gain, size_t count)
+{
+	__m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+
+	scale_c(data + i, gain, count - i);
+}
+
+static void scale_buf_sse(float *data, const float *gains, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 d = _mm_loadu_ps(data + i);
+		__m128 g = _mm_loadu_ps(gains + i);
+		_mm_storeu_ps(data + i, _mm_mul_ps(d, g));
+	}
+
+	scale_buf_c(data + i, gains + i, count - i);
+}
+
+static void clamp_sse(float *data, size_t count)
+{
+	__m128 one     = _mm_set1_ps(1.0f);
+	__m128 neg_one = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	/* operand order keeps NaNs the same way the C version does */
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		val = _mm_min_ps(one, val);
+		val = _mm_max_ps(neg_one, val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	clamp_c(data + i, count - i);
+}
+
+static void downmix_sse(float *dst, const float *const *src, size_t channels,
+		size_t start_idx, size_t count)
+{
+	__m128 mul = _mm_set1_ps(1.0f / (float)channels);
+	size_t i = start_idx;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 sum = _mm_loadu_ps(src[0] + i);
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm_add_ps(sum, _mm_loadu_ps(src[ch] + i));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(sum, mul));
+	}
+
+	downmix_c(dst, src, channels, i, count);
+}
+
+static const struct audio_math_funcs funcs_sse = {
+	.mix       = mix_sse,
+	.mix_gain  = mix_gain_sse,
+	.mix_buf   = mix_buf_sse,
+	.scale     = scale_sse,
+	.scale_buf = scale_buf_sse,
+	.clamp     = clamp_sse,
+	.downmix   = downmix_sse,
+};
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* AVX: eight samples at a time */
+
+#ifdef AUDIO_MATH_AVX
+
+AVX_FUNC static void mix_avx(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d, s));
+	}
+
+	mix_c(dst + i, src + i, count - i);
+}
+
+AVX_FUNC static void mix_gain_avx(float *dst, const float *src, float gain,
+		size_t count)
+{
+	__m256 g = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(s, g)));
+	}
+
+	mix_gain_c(dst + i, src + i, gain, count - i);
+}
+
+AVX_FUNC static void mix_buf_avx(float *dst, const float *src,
+		const float *gains, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(dst + i);
+		__m256 s = _mm256_loadu_ps(src + i);
+		__m256 g = _mm256_loadu_ps(gains + i);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(s, g)));
+	}
+
+	mix_buf_c(dst + i, src + i, gains + i, count - i);
+}
+
+AVX_FUNC static void scale_avx(float *data, float gain, size_t count)
+{
+	__m256 g = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(data + i);
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(d, g));
+	}
+
+	scale_c(data + i, gain, count - i);
+}
+
+AVX_FUNC static void scale_buf_avx(float *data, const float *gains,
+		size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(data + i);
+		__m256 g = _mm256_loadu_ps(gains + i);
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(d, g));
+	}
+
+	scale_buf_c(data + i, gains + i, count - i);
+}
+
+AVX_FUNC static void clamp_avx(float *data, size_t count)
+{
+	__m256 one     = _mm256_set1_ps(1.0f);
+	__m256 neg_one = _mm256_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_min_ps(one, val);
+		val = _mm256_max_ps(neg_one, val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	clamp_c(data + i, count - i);
+}
+
+AVX_FUNC static void downmix_avx(float *dst, const float *const *src,
+		size_t channels, size_t start_idx, size_t count)
+{
+	__m256 mul = _mm256_set1_ps(1.0f / (float)channels);
+	size_t i = start_idx;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 sum = _mm256_loadu_ps(src[0] + i);
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(src[ch] + i));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(sum, mul));
+	}
+
+	downmix_c(dst, src, channels, i, count);
+}
+
+static const struct audio_math_funcs funcs_avx = {
+	.mix       = mix_avx,
+	.mix_gain  = mix_gain_avx,
+	.mix_buf   = mix_buf_avx,
+	.scale     = scale_avx,
+	.scale_buf = scale_buf_avx,
+	.clamp     = clamp_avx,
+	.downmix   = downmix_avx,
+};
+
+static bool cpu_has_avx(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	/* AVX and OSXSAVE, and the OS must be saving the YMM registers */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28))
+		return false;
+	return (_xgetbv(0) & 6) == 6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* NEON: four samples at a time */
+
+#ifdef AUDIO_MATH_NEON
+
+static void mix_neon(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i),
+					vld1q_f32(src + i)));
+
+	mix_c(dst + i, src + i, count - i);
+}
+
+static void mix_gain_neon(float *dst, const float *src, float gain,
+		size_t count)
+{
+	float32x4_t g = vdupq_n_f32(gain);
+	size_t i = 0;
+
+	/* vmlaq_f32 may fuse, so multiply and add separately */
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t s = vmulq_f32(vld1q_f32(src + i), g);
+		vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), s));
+	}
+
+	mix_gain_c(dst + i, src + i, gain, count - i);
+}
+
+static void mix_buf_neon(float *dst, const float *src, const float *gains,
+		size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t s = vmulq_f32(vld1q_f32(src + i),
+				vld1q_f32(gains + i));
+		vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), s));
+	}
+
+	mix_buf_c(dst + i, src + i, gains + i, count - i);
+}
+
+static void scale_neon(float *data, float gain, size_t count)
+{
+	float32x4_t g = vdupq_n_f32(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), g));
+
+	scale_c(data + i, gain, count - i);
+}
+
+static void scale_buf_neon(float *data, const float *gains, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i),
+					vld1q_f32(gains + i)));
+
+	scale_buf_c(data + i, gains + i, count - i);
+}
+
+static void clamp_neon(float *data, size_t count)
+{
+	float32x4_t one     = vdupq_n_f32(1.0f);
+	float32x4_t neg_one = vdupq_n_f32(-1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t val = vld1q_f32(data + i);
+		val = vmaxq_f32(neg_one, vminq_f32(one, val));
+		vst1q_f32(data + i, val);
+	}
+
+	clamp_c(data + i, count - i);
+}
+
+static void downmix_neon(float *dst, const float *const *src, size_t channels,
+		size_t start_idx, size_t count)
+{
+	float32x4_t mul = vdupq_n_f32(1.0f / (float)channels);
+	size_t i = start_idx;
+
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t sum = vld1q_f32(src[0] + i);
+		for (size_t ch = 1; ch < channels; ch++)
+			sum = vaddq_f32(sum, vld1q_f32(src[ch] + i));
+		vst1q_f32(dst + i, vmulq_f32(sum, mul));
+	}
+
+	downmix_c(dst, src, channels, i, count);
+}
+
+static const struct audio_math_funcs funcs_neon = {
+	.mix       = mix_neon,
+	.mix_gain  = mix_gain_neon,
+	.mix_buf   = mix_buf_neon,
+	.scale     = scale_neon,
+	.scale_buf = scale_buf_neon,
+	.clamp     = clamp_neon,
+	.downmix   = downmix_neon,
+};
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* runtime dispatch */
+
+static const struct audio_math_funcs funcs_c = {
+	.mix       = mix_c,
+	.mix_gain  = mix_gain_c,
+	.mix_buf   = mix_buf_c,
+	.scale     = scale_c,
+	.scale_buf = scale_buf_c,
+	.clamp     = clamp_c,
+	.downmix   = downmix_c,
+};
+
+static pthread_once_t audio_math_once = PTHREAD_ONCE_INIT;
+static const struct audio_math_funcs *funcs = &funcs_c;
+
+static void init_audio_math_funcs(void)
+{
+	const char *impl = "C";
+
+#if defined(AUDIO_MATH_AVX)
+	if (cpu_has_avx()) {
+		funcs = &funcs_avx;
+		impl = "AVX";
+	} else {
+		funcs = &funcs_sse;
+		impl = "SSE";
+	}
+#elif defined(AUDIO_MATH_SSE)
+	funcs = &funcs_sse;
+	impl = "SSE";
+#elif defined(AUDIO_MATH_NEON)
+	funcs = &funcs_neon;
+	impl = "NEON";
+#endif
+
+	blog(LOG_DEBUG, "Using %s audio math functions", impl);
+}
+
+static inline const struct audio_math_funcs *get_funcs(void)
+{
+	pthread_once(&audio_math_once, init_audio_math_funcs);
+	return funcs;
+}
+
+void audio_mix(float *dst, const float *src, size_t count)
+{
+	get_funcs()->mix(dst, src, count);
+}
+
+void audio_mix_gain(float *dst, const float *src, float gain, size_t count)
+{
+	get_funcs()->mix_gain(dst, src, gain, count);
+}
+
+void audio_mix_buf(float *dst, const float *src, const float *gains,
+		size_t count)
+{
+	get_funcs()->mix_buf(dst, src, gains, count);
+}
+
+void audio_scale(float *data, float gain, size_t count)
+{
+	get_funcs()->scale(data, gain, count);
+}
+
+void audio_scale_buf(float *data, const float *gains, size_t count)
+{
+	get_funcs()->scale_buf(data, gains, count);
+}
+
+void audio_clamp(float *data, size_t count)
+{
+	get_funcs()->clamp(data, count);
+}
+
+void audio_downmix(float *dst, const float *const *src, size_t channels,
+		size_t count)
+{
+	if (!channels)
+		return;
+
+	get_funcs()->downmix(dst, src, channels, 0, count);
+}
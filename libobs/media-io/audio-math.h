@@ -41,3 +41,47 @@ static inline float db_to_mul(const float db)
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Audio sample kernels
+ *
+ *   Operations on runs of float samples used by the audio mixer, source
+ * volume and scene mixing.  The first call picks an AVX, SSE, NEON or plain
+ * C implementation depending on the CPU.  All implementations give the same
+ * results bit for bit, and none of them require any particular alignment.
+ */
+
+/** dst[i] += src[i] */
+EXPORT void audio_mix(float *dst, const float *src, size_t count);
+
+/** dst[i] += src[i] * gain */
+EXPORT void audio_mix_gain(float *dst, const float *src, float gain,
+		size_t count);
+
+/** dst[i] += src[i] * gains[i] */
+EXPORT void audio_mix_buf(float *dst, const float *src, const float *gains,
+		size_t count);
+
+/** data[i] *= gain */
+EXPORT void audio_scale(float *data, float gain, size_t count);
+
+/** data[i] *= gains[i] */
+EXPORT void audio_scale_buf(float *data, const float *gains, size_t count);
+
+/** clamps samples to the -1.0 .. 1.0 range */
+EXPORT void audio_clamp(float *data, size_t count);
+
+/**
+ * dst[i] = average of src[0..channels-1][i].  dst may be one of the source
+ * planes.
+ */
+EXPORT void audio_downmix(float *dst, const float *const *src,
+		size_t channels, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,12 +17,16 @@
 
 #include "../util/bmem.h"
 #include "audio-resampler.h"
+#include "audio-resampler-polyphase.h"
 #include "audio-io.h"
 #include <libavutil/avutil.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
 struct audio_resampler {
+	/* used instead of swresample when it supports the conversion */
+	struct polyphase_resampler *polyphase;
+
 	struct SwrContext   *context;
 	bool                opened;
 
@@ -80,6 +84,10 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
 	int errcode;
 
+	rs->polyphase = polyphase_resampler_create(dst, src);
+	if (rs->polyphase)
+		return rs;
+
 	rs->opened        = false;
 	rs->input_freq    = src->samples_per_sec;
 	rs->input_layout  = convert_speaker_layout(src->speakers);
@@ -103,17 +111,13 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 	}
 
 	if (rs->input_layout == AV_CH_LAYOUT_MONO && rs->output_ch > 1) {
-		const double matrix[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS] = {
-		{1},
-		{1, 1},
-		{1, 1, 0},
-		{1, 1, 1, 1},
-		{1, 1, 1, 0, 1},
-		{1, 1, 1, 1, 1, 1},
-		{1, 1, 1, 0, 1, 1, 1},
-		{1, 1, 1, 0, 1, 1, 1, 1},
-		};
-		if (swr_set_matrix(rs->context, matrix[rs->output_ch - 1], 1) < 0)
+		double matrix[MAX_AUDIO_CHANNELS] = {0};
+
+		for (uint32_t ch = 0; ch < rs->output_ch; ch++)
+			matrix[ch] = mono_upmix_channel(rs->output_ch, ch) ?
+				1.0 : 0.0;
+
+		if (swr_set_matrix(rs->context, matrix, 1) < 0)
 			blog(LOG_DEBUG, "swr_set_matrix failed for mono upmix\n");
 	}
 
@@ -131,6 +135,7 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 void audio_resampler_destroy(audio_resampler_t *rs)
 {
 	if (rs) {
+		polyphase_resampler_destroy(rs->polyphase);
 		if (rs->context)
 			swr_free(&rs->context);
 		if (rs->output_buffer[0])
@@ -146,6 +151,10 @@ bool audio_resampler_resample(audio_resampler_t *rs,
 {
 	if (!rs) return false;
 
+	if (rs->polyphase)
+		return polyphase_resampler_resample(rs->polyphase, output,
+				out_frames, ts_offset, input, in_frames);
+
 	struct SwrContext *context = rs->context;
 	int ret;
 
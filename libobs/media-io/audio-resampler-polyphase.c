@@ -0,0 +1,670 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/base.h"
+#include "../util/darray.h"
+#include "../util/threading.h"
+#include "audio-resampler-polyphase.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define POLYPHASE_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define POLYPHASE_NEON
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+/*
+ * Filters are Kaiser windowed sincs with the cutoff at FILTER_ROLLOFF of the
+ * Nyquist frequency of the lower rate, which is what swresample uses by
+ * default too.  FILTER_TAPS is long enough that everything up to 20 kHz
+ * passes when either rate is 44.1 kHz, and the Kaiser beta keeps aliasing
+ * below -90 dB.  When downsampling, the filter is longer by the resampling
+ * ratio to keep the same transition band.  Tap counts are multiples of eight
+ * for the vector dot products.
+ */
+#define FILTER_TAPS    128
+#define FILTER_ROLLOFF 0.97
+#define FILTER_BETA    9.0
+#define MAX_TAPS       512
+
+struct polyphase_bank {
+	uint32_t                     up;
+	uint32_t                     down;
+	long                         refs;
+
+	/* taps coefficients for each of the up phases */
+	size_t                       taps;
+	float                        *coeffs;
+};
+
+struct polyphase_resampler {
+	/* NULL if only the format or channels are converted */
+	struct polyphase_bank *bank;
+
+	uint32_t              in_rate;
+	enum audio_format     in_format;
+	enum audio_format     out_format;
+	uint32_t              in_ch;
+	uint32_t              out_ch;
+	bool                  upmix;
+
+	/* input converted to float, starting with the history the filter
+	 * still needs.  pos is the time of the next output frame relative to
+	 * the first frame, in 1/up input frames */
+	float                 *hist[MAX_AUDIO_CHANNELS];
+	size_t                hist_len;
+	size_t                hist_size;
+	uint64_t              pos;
+
+	float                 *filtered[MAX_AUDIO_CHANNELS];
+	size_t                filtered_size;
+
+	uint8_t               *out[MAX_AV_PLANES];
+	size_t                out_size;
+};
+
+static pthread_mutex_t banks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct polyphase_bank*) banks;
+
+/* ------------------------------------------------------------------------- */
+/* filter banks */
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/* zeroth order modified bessel function of the first kind */
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 64; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+static void build_bank(struct polyphase_bank *bank)
+{
+	const size_t taps = bank->taps;
+	const double half = (double)(taps / 2);
+	const double cutoff = (bank->up < bank->down ?
+			(double)bank->up / (double)bank->down : 1.0) *
+		FILTER_ROLLOFF;
+	const double i0_beta = bessel_i0(FILTER_BETA);
+
+	for (uint32_t p = 0; p < bank->up; p++) {
+		float *coeffs = bank->coeffs + p * taps;
+		double frac = (double)p / (double)bank->up;
+		double sum = 0.0;
+
+		for (size_t k = 0; k < taps; k++) {
+			/* distance of the tap from the output frame */
+			double d = (double)k - (half - 1.0) - frac;
+			double u = d / half;
+			double x = M_PI * cutoff * d;
+			double sinc = fabs(x) < 1e-9 ? 1.0 : sin(x) / x;
+			double window = fabs(u) >= 1.0 ? 0.0 :
+				bessel_i0(FILTER_BETA * sqrt(1.0 - u * u)) /
+				i0_beta;
+
+			coeffs[k] = (float)(cutoff * sinc * window);
+			sum += coeffs[k];
+		}
+
+		/* unity gain at DC for every phase */
+		for (size_t k = 0; k < taps; k++)
+			coeffs[k] = (float)(coeffs[k] / sum);
+	}
+}
+
+static struct polyphase_bank *bank_acquire(uint32_t up, uint32_t down)
+{
+	struct polyphase_bank *bank = NULL;
+
+	pthread_mutex_lock(&banks_mutex);
+
+	for (size_t i = 0; i < banks.num; i++) {
+		struct polyphase_bank *cur = banks.array[i];
+
+		if (cur->up == up && cur->down == down) {
+			bank = cur;
+			bank->refs++;
+			break;
+		}
+	}
+
+	if (!bank) {
+		size_t taps = FILTER_TAPS;
+
+		/* the cutoff is lower when downsampling, so the filter has to
+		 * be longer to keep the same transition band */
+		if (down > up)
+			taps = ((FILTER_TAPS * down + up - 1) / up + 7) & ~7;
+		if (taps > MAX_TAPS)
+			taps = MAX_TAPS;
+
+		bank = bzalloc(sizeof(struct polyphase_bank));
+		bank->up     = up;
+		bank->down   = down;
+		bank->refs   = 1;
+		bank->taps   = taps;
+		bank->coeffs = bmalloc(up * taps * sizeof(float));
+
+		build_bank(bank);
+		da_push_back(banks, &bank);
+	}
+
+	pthread_mutex_unlock(&banks_mutex);
+	return bank;
+}
+
+static void bank_release(struct polyphase_bank *bank)
+{
+	bool destroy;
+
+	if (!bank)
+		return;
+
+	pthread_mutex_lock(&banks_mutex);
+
+	destroy = --bank->refs == 0;
+	if (destroy) {
+		da_erase_item(banks, &bank);
+		if (!banks.num)
+			da_free(banks);
+	}
+
+	pthread_mutex_unlock(&banks_mutex);
+
+	if (destroy) {
+		bfree(bank->coeffs);
+		bfree(bank);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* filtering */
+
+#if defined(POLYPHASE_SSE)
+
+static inline float dot(const float *a, const float *b, size_t count)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+
+	for (size_t i = 0; i < count; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i),
+					_mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+					_mm_loadu_ps(b + i + 4)));
+	}
+
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+}
+
+#elif defined(POLYPHASE_NEON)
+
+static inline float dot(const float *a, const float *b, size_t count)
+{
+	float32x4_t sum0 = vdupq_n_f32(0.0f);
+	float32x4_t sum1 = vdupq_n_f32(0.0f);
+	float32x2_t sum;
+
+	for (size_t i = 0; i < count; i += 8) {
+		sum0 = vaddq_f32(sum0, vmulq_f32(vld1q_f32(a + i),
+					vld1q_f32(b + i)));
+		sum1 = vaddq_f32(sum1, vmulq_f32(vld1q_f32(a + i + 4),
+					vld1q_f32(b + i + 4)));
+	}
+
+	sum0 = vaddq_f32(sum0, sum1);
+	sum = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+	sum = vpadd_f32(sum, sum);
+	return vget_lane_f32(sum, 0);
+}
+
+#else
+
+static inline float dot(const float *a, const float *b, size_t count)
+{
+	float sum = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+#endif
+
+/* number of frames that can be output from the current history */
+static size_t output_frames(const struct polyphase_resampler *rs)
+{
+	const struct polyphase_bank *bank = rs->bank;
+	const size_t half = bank->taps / 2;
+	uint64_t end;
+
+	if (rs->hist_len <= half)
+		return 0;
+
+	end = (uint64_t)(rs->hist_len - half) * bank->up;
+	if (end <= rs->pos)
+		return 0;
+
+	return (size_t)((end - rs->pos + bank->down - 1) / bank->down);
+}
+
+static void filter_channel(const struct polyphase_resampler *rs, float *out,
+		const float *in, size_t frames)
+{
+	const struct polyphase_bank *bank = rs->bank;
+	const size_t taps = bank->taps;
+	const uint32_t up = bank->up;
+	const uint32_t step_int = bank->down / up;
+	const uint32_t step_frac = bank->down % up;
+	size_t idx = (size_t)(rs->pos / up);
+	uint32_t phase = (uint32_t)(rs->pos % up);
+
+	/* the first tap of frame idx is at idx - (taps / 2 - 1) */
+	in -= taps / 2 - 1;
+
+	for (size_t i = 0; i < frames; i++) {
+		out[i] = dot(bank->coeffs + phase * taps, in + idx, taps);
+
+		idx   += step_int;
+		phase += step_frac;
+		if (phase >= up) {
+			phase -= up;
+			idx++;
+		}
+	}
+}
+
+/* drops the history that is no longer needed after outputting frames */
+static void advance(struct polyphase_resampler *rs, size_t frames)
+{
+	const struct polyphase_bank *bank = rs->bank;
+	size_t keep_before = bank->taps / 2 - 1;
+	size_t drop;
+
+	rs->pos += (uint64_t)frames * bank->down;
+
+	drop = (size_t)(rs->pos / bank->up);
+	drop = drop > keep_before ? drop - keep_before : 0;
+	if (drop > rs->hist_len)
+		drop = rs->hist_len;
+	if (!drop)
+		return;
+
+	for (uint32_t ch = 0; ch < rs->in_ch; ch++)
+		memmove(rs->hist[ch], rs->hist[ch] + drop,
+				(rs->hist_len - drop) * sizeof(float));
+
+	rs->hist_len -= drop;
+	rs->pos -= (uint64_t)drop * bank->up;
+}
+
+/* ------------------------------------------------------------------------- */
+/* sample formats */
+
+static inline enum audio_format packed_format(enum audio_format format)
+{
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT_PLANAR: return AUDIO_FORMAT_U8BIT;
+	case AUDIO_FORMAT_16BIT_PLANAR: return AUDIO_FORMAT_16BIT;
+	case AUDIO_FORMAT_32BIT_PLANAR: return AUDIO_FORMAT_32BIT;
+	case AUDIO_FORMAT_FLOAT_PLANAR: return AUDIO_FORMAT_FLOAT;
+	default:                        return format;
+	}
+}
+
+static void to_float(float *dst, const uint8_t *src, enum audio_format format,
+		size_t stride, size_t frames)
+{
+	switch (packed_format(format)) {
+	case AUDIO_FORMAT_U8BIT:
+		for (size_t i = 0; i < frames; i++)
+			dst[i] = ((float)src[i * stride] - 128.0f) *
+				(1.0f / 128.0f);
+		break;
+
+	case AUDIO_FORMAT_16BIT: {
+		const int16_t *s16 = (const int16_t*)src;
+		for (size_t i = 0; i < frames; i++)
+			dst[i] = (float)s16[i * stride] * (1.0f / 32768.0f);
+		break;
+	}
+
+	case AUDIO_FORMAT_32BIT: {
+		const int32_t *s32 = (const int32_t*)src;
+		for (size_t i = 0; i < frames; i++)
+			dst[i] = (float)((double)s32[i * stride] *
+					(1.0 / 2147483648.0));
+		break;
+	}
+
+	case AUDIO_FORMAT_FLOAT: {
+		const float *f = (const float*)src;
+		if (stride == 1) {
+			memcpy(dst, f, frames * sizeof(float));
+		} else {
+			for (size_t i = 0; i < frames; i++)
+				dst[i] = f[i * stride];
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+/* src can be NULL for silence */
+static void from_float(uint8_t *dst, const float *src,
+		enum audio_format format, size_t stride, size_t frames)
+{
+	switch (packed_format(format)) {
+	case AUDIO_FORMAT_U8BIT:
+		for (size_t i = 0; i < frames; i++) {
+			float val = src ? src[i] * 128.0f + 128.0f : 128.0f;
+			if (val < 0.0f)   val = 0.0f;
+			if (val > 255.0f) val = 255.0f;
+			dst[i * stride] = (uint8_t)lrintf(val);
+		}
+		break;
+
+	case AUDIO_FORMAT_16BIT: {
+		int16_t *s16 = (int16_t*)dst;
+		for (size_t i = 0; i < frames; i++) {
+			float val = src ? src[i] * 32768.0f : 0.0f;
+			if (val < -32768.0f) val = -32768.0f;
+			if (val > 32767.0f)  val = 32767.0f;
+			s16[i * stride] = (int16_t)lrintf(val);
+		}
+		break;
+	}
+
+	case AUDIO_FORMAT_32BIT: {
+		int32_t *s32 = (int32_t*)dst;
+		for (size_t i = 0; i < frames; i++) {
+			double val = src ? (double)src[i] * 2147483648.0 : 0.0;
+			if (val < -2147483648.0) val = -2147483648.0;
+			if (val > 2147483647.0)  val = 2147483647.0;
+			s32[i * stride] = (int32_t)lrint(val);
+		}
+		break;
+	}
+
+	case AUDIO_FORMAT_FLOAT: {
+		float *f = (float*)dst;
+		if (stride == 1) {
+			if (src)
+				memcpy(f, src, frames * sizeof(float));
+			else
+				memset(f, 0, frames * sizeof(float));
+		} else {
+			for (size_t i = 0; i < frames; i++)
+				f[i * stride] = src ? src[i] : 0.0f;
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline size_t grow_size(size_t size, size_t needed)
+{
+	size_t new_size = size ? size : 1024;
+	while (new_size < needed)
+		new_size *= 2;
+	return new_size;
+}
+
+static void reserve_history(struct polyphase_resampler *rs, size_t frames)
+{
+	if (rs->hist_size && frames <= rs->hist_size)
+		return;
+
+	rs->hist_size = grow_size(rs->hist_size, frames);
+	for (uint32_t ch = 0; ch < rs->in_ch; ch++)
+		rs->hist[ch] = brealloc(rs->hist[ch],
+				rs->hist_size * sizeof(float));
+}
+
+static void reserve_filtered(struct polyphase_resampler *rs, size_t frames)
+{
+	if (rs->filtered_size && frames <= rs->filtered_size)
+		return;
+
+	rs->filtered_size = grow_size(rs->filtered_size, frames);
+	for (uint32_t ch = 0; ch < rs->in_ch; ch++) {
+		bfree(rs->filtered[ch]);
+		rs->filtered[ch] = bmalloc(rs->filtered_size * sizeof(float));
+	}
+}
+
+static void reserve_output(struct polyphase_resampler *rs, size_t frames)
+{
+	size_t planes, bytes;
+
+	if (rs->out_size && frames <= rs->out_size)
+		return;
+
+	rs->out_size = grow_size(rs->out_size, frames);
+
+	planes = is_audio_planar(rs->out_format) ? rs->out_ch : 1;
+	bytes = rs->out_size * get_audio_bytes_per_channel(rs->out_format) *
+		(is_audio_planar(rs->out_format) ? 1 : rs->out_ch);
+
+	for (size_t i = 0; i < planes; i++) {
+		bfree(rs->out[i]);
+		rs->out[i] = bmalloc(bytes);
+	}
+}
+
+/* converts and appends input to the history */
+static void read_input(struct polyphase_resampler *rs,
+		const uint8_t *const input[], uint32_t in_frames)
+{
+	bool planar = is_audio_planar(rs->in_format);
+	size_t bytes = get_audio_bytes_per_channel(rs->in_format);
+
+	reserve_history(rs, rs->hist_len + in_frames);
+
+	for (uint32_t ch = 0; ch < rs->in_ch; ch++) {
+		const uint8_t *src = planar ? input[ch] : input[0] + ch * bytes;
+
+		to_float(rs->hist[ch] + rs->hist_len, src, rs->in_format,
+				planar ? 1 : rs->in_ch, in_frames);
+	}
+
+	rs->hist_len += in_frames;
+}
+
+static void write_output(struct polyphase_resampler *rs, uint8_t *output[],
+		float *const *src, size_t frames)
+{
+	bool planar = is_audio_planar(rs->out_format);
+	size_t bytes = get_audio_bytes_per_channel(rs->out_format);
+
+	/* float planar with the same channels is already the output */
+	if (rs->out_format == AUDIO_FORMAT_FLOAT_PLANAR && !rs->upmix) {
+		for (uint32_t ch = 0; ch < rs->out_ch; ch++)
+			output[ch] = (uint8_t*)src[ch];
+		return;
+	}
+
+	reserve_output(rs, frames);
+
+	for (uint32_t ch = 0; ch < rs->out_ch; ch++) {
+		const float *plane = src[ch];
+		uint8_t *dst = planar ? rs->out[ch] : rs->out[0] + ch * bytes;
+
+		if (rs->upmix)
+			plane = mono_upmix_channel(rs->out_ch, ch) ?
+				src[0] : NULL;
+
+		from_float(dst, plane, rs->out_format, planar ? 1 : rs->out_ch,
+				frames);
+	}
+
+	for (uint32_t i = 0; i < (planar ? rs->out_ch : 1); i++)
+		output[i] = rs->out[i];
+}
+
+static inline bool format_valid(enum audio_format format)
+{
+	return format != AUDIO_FORMAT_UNKNOWN &&
+		format <= AUDIO_FORMAT_FLOAT_PLANAR;
+}
+
+struct polyphase_resampler *polyphase_resampler_create(
+		const struct resample_info *dst,
+		const struct resample_info *src)
+{
+	struct polyphase_resampler *rs;
+	uint32_t in_ch = get_audio_channels(src->speakers);
+	uint32_t out_ch = get_audio_channels(dst->speakers);
+	uint32_t div, up, down;
+
+	if (!format_valid(src->format) || !format_valid(dst->format))
+		return NULL;
+	if (!src->samples_per_sec || !dst->samples_per_sec)
+		return NULL;
+	if (!in_ch || !out_ch || in_ch > MAX_AUDIO_CHANNELS ||
+	    out_ch > MAX_AUDIO_CHANNELS)
+		return NULL;
+	if (src->speakers != dst->speakers && src->speakers != SPEAKERS_MONO)
+		return NULL;
+
+	div  = gcd(src->samples_per_sec, dst->samples_per_sec);
+	up   = dst->samples_per_sec / div;
+	down = src->samples_per_sec / div;
+
+	if (up > POLYPHASE_MAX_PHASES || down > POLYPHASE_MAX_PHASES)
+		return NULL;
+
+	rs = bzalloc(sizeof(struct polyphase_resampler));
+	rs->in_rate    = src->samples_per_sec;
+	rs->in_format  = src->format;
+	rs->out_format = dst->format;
+	rs->in_ch      = in_ch;
+	rs->out_ch     = out_ch;
+	rs->upmix      = in_ch != out_ch;
+
+	if (up != down) {
+		rs->bank = bank_acquire(up, down);
+
+		/* start with silence before the first frame, so that the first
+		 * output frame is at the time of the first input frame */
+		rs->hist_len = rs->bank->taps / 2 - 1;
+		rs->pos      = (uint64_t)rs->hist_len * up;
+		reserve_history(rs, rs->hist_len);
+		for (uint32_t ch = 0; ch < in_ch; ch++)
+			memset(rs->hist[ch], 0, rs->hist_len * sizeof(float));
+
+		blog(LOG_DEBUG, "polyphase_resampler_create: %u -> %u Hz, "
+		                "%u phases, %d taps",
+		                src->samples_per_sec, dst->samples_per_sec,
+		                up, (int)rs->bank->taps);
+	}
+
+	return rs;
+}
+
+void polyphase_resampler_destroy(struct polyphase_resampler *rs)
+{
+	if (!rs)
+		return;
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+		bfree(rs->hist[i]);
+		bfree(rs->filtered[i]);
+	}
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		bfree(rs->out[i]);
+
+	bank_release(rs->bank);
+	bfree(rs);
+}
+
+bool polyphase_resampler_resample(struct polyphase_resampler *rs,
+		uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
+		const uint8_t *const input[], uint32_t in_frames)
+{
+	struct polyphase_bank *bank = rs->bank;
+	size_t frames;
+
+	if (!bank) {
+		/* no history is kept, the previous output can be overwritten */
+		rs->hist_len = 0;
+		read_input(rs, input, in_frames);
+		write_output(rs, output, rs->hist, in_frames);
+
+		*ts_offset  = 0;
+		*out_frames = in_frames;
+		return true;
+	}
+
+	/* how far the next output frame is behind the new input */
+	if ((uint64_t)rs->hist_len * bank->up > rs->pos)
+		*ts_offset = ((uint64_t)rs->hist_len * bank->up - rs->pos) *
+			1000000000ULL / ((uint64_t)bank->up * rs->in_rate);
+	else
+		*ts_offset = 0;
+
+	read_input(rs, input, in_frames);
+
+	frames = output_frames(rs);
+	reserve_filtered(rs, frames);
+
+	for (uint32_t ch = 0; ch < rs->in_ch; ch++)
+		filter_channel(rs, rs->filtered[ch], rs->hist[ch], frames);
+
+	advance(rs, frames);
+	write_output(rs, output, rs->filtered, frames);
+
+	*out_frames = (uint32_t)frames;
+	return true;
+}
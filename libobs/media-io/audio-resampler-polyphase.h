@@ -0,0 +1,63 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "audio-resampler.h"
+
+/*
+ * Built-in polyphase resampler (internal to audio-resampler)
+ *
+ *   Converts between sample rates with a reduced ratio of up to
+ * POLYPHASE_MAX_PHASES (44.1 kHz <-> 48 kHz is 160/147), keeps the channel
+ * layout or upmixes mono, and converts any sample format in and out of float
+ * in the same pass.  Filter banks are shared by every resampler with the same
+ * ratio.
+ */
+
+#define POLYPHASE_MAX_PHASES 1024
+
+/** Whether mono goes to channel ch when upmixing mono to channels */
+static inline bool mono_upmix_channel(uint32_t channels, uint32_t ch)
+{
+	static const bool matrix[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS] = {
+	{1},
+	{1, 1},
+	{1, 1, 0},
+	{1, 1, 1, 1},
+	{1, 1, 1, 0, 1},
+	{1, 1, 1, 1, 1, 1},
+	{1, 1, 1, 0, 1, 1, 1},
+	{1, 1, 1, 0, 1, 1, 1, 1},
+	};
+
+	if (!channels || channels > MAX_AUDIO_CHANNELS || ch >= channels)
+		return false;
+	return matrix[channels - 1][ch];
+}
+
+struct polyphase_resampler;
+
+/** Returns NULL if the conversion is not supported */
+extern struct polyphase_resampler *polyphase_resampler_create(
+		const struct resample_info *dst,
+		const struct resample_info *src);
+extern void polyphase_resampler_destroy(struct polyphase_resampler *rs);
+
+extern bool polyphase_resampler_resample(struct polyphase_resampler *rs,
+		uint8_t *output[], uint32_t *out_frames, uint64_t *ts_offset,
+		const uint8_t *const input[], uint32_t in_frames);
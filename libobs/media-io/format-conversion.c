@@ -16,8 +16,154 @@
 ******************************************************************************/
 
 #include "format-conversion.h"
+#include "../util/threading.h"
+#include "../util/base.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define CONVERT_SSE2
+#define CONVERT_AVX2
+#elif defined(NO_WARN_X86_INTRINSICS)
+#define CONVERT_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define CONVERT_NEON
+#endif
+
+#ifdef CONVERT_SSE2
 #include <xmmintrin.h>
 #include <emmintrin.h>
+#endif
+#ifdef CONVERT_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#endif
+#ifdef CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*uyvx_convert_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference implementations, also used for the remaining pixels of a
+ * row that don't fill a full vector in the SIMD versions */
+
+static FORCE_INLINE void pack_420_c(const uint8_t *img1, const uint8_t *img2,
+		uint8_t *lum0, uint8_t *lum1, uint8_t *u, uint8_t *v)
+{
+	lum0[0] = img1[1];
+	lum0[1] = img1[5];
+	lum1[0] = img2[1];
+	lum1[1] = img2[5];
+	*u = (uint8_t)((img1[0] + img1[4] + img2[0] + img2[4]) >> 2);
+	*v = (uint8_t)((img1[2] + img1[6] + img2[2] + img2[6]) >> 2);
+}
+
+static FORCE_INLINE void i420_row_c(const uint8_t *input, uint32_t in_linesize,
+		uint32_t y, uint32_t start_x, uint32_t width,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	const uint8_t *img1 = input + y * in_linesize;
+	const uint8_t *img2 = img1 + in_linesize;
+	uint8_t *lum0 = output[0] + y * out_linesize[0];
+	uint8_t *lum1 = lum0 + out_linesize[0];
+	uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+	uint8_t *v    = output[2] + (y>>1) * out_linesize[2];
+	uint32_t x;
+
+	for (x = start_x; x < width; x += 2)
+		pack_420_c(img1 + x*4, img2 + x*4, lum0 + x, lum1 + x,
+				u + (x>>1), v + (x>>1));
+}
+
+static FORCE_INLINE void nv12_row_c(const uint8_t *input, uint32_t in_linesize,
+		uint32_t y, uint32_t start_x, uint32_t width,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	const uint8_t *img1 = input + y * in_linesize;
+	const uint8_t *img2 = img1 + in_linesize;
+	uint8_t *lum0 = output[0] + y * out_linesize[0];
+	uint8_t *lum1 = lum0 + out_linesize[0];
+	uint8_t *uv   = output[1] + (y>>1) * out_linesize[1];
+	uint32_t x;
+
+	for (x = start_x; x < width; x += 2)
+		pack_420_c(img1 + x*4, img2 + x*4, lum0 + x, lum1 + x,
+				uv + x, uv + x + 1);
+}
+
+static FORCE_INLINE void i444_row_c(const uint8_t *input, uint32_t in_linesize,
+		uint32_t y, uint32_t start_x, uint32_t width,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	const uint8_t *img = input + y * in_linesize;
+	uint8_t *lum = output[0] + y * out_linesize[0];
+	uint8_t *u   = output[1] + y * out_linesize[0];
+	uint8_t *v   = output[2] + y * out_linesize[0];
+	uint32_t x;
+
+	for (x = start_x; x < width; x++) {
+		lum[x] = img[x*4 + 1];
+		u[x]   = img[x*4];
+		v[x]   = img[x*4 + 2];
+	}
+}
+
+static void compress_uyvx_to_i420_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2)
+		i420_row_c(input, in_linesize, y, 0, width,
+				output, out_linesize);
+}
+
+static void compress_uyvx_to_nv12_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2)
+		nv12_row_c(input, in_linesize, y, 0, width,
+				output, out_linesize);
+}
+
+static void convert_uyvx_to_i444_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++)
+		i444_row_c(input, in_linesize, y, 0, width,
+				output, out_linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 */
+
+#ifdef CONVERT_SSE2
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
  * CPU usage to boost by a tremendous amount in debug builds. */
@@ -84,12 +230,7 @@ do {                                                                          \
 } while (false)
 
 
-static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
-{
-	return a < b ? a : b;
-}
-
-void compress_uyvx_to_i420(
+static void compress_uyvx_to_i420_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -109,7 +250,7 @@ void compress_uyvx_to_i420(
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -124,10 +265,13 @@ void compress_uyvx_to_i420(
 					chroma_y_pos + (x>>1),
 					line1, line2, uv_mask);
 		}
+
+		i420_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
 	}
 }
 
-void compress_uyvx_to_nv12(
+static void compress_uyvx_to_nv12_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -146,7 +290,7 @@ void compress_uyvx_to_nv12(
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -160,10 +304,13 @@ void compress_uyvx_to_nv12(
 			pack_ch_1plane(chroma_plane, chroma_y_pos + x,
 					line1, line2, uv_mask);
 		}
+
+		nv12_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
 	}
 }
 
-void convert_uyvx_to_i444(
+static void convert_uyvx_to_i444_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -178,12 +325,12 @@ void convert_uyvx_to_i444(
 	__m128i u_mask   = _mm_set1_epi32(0x000000FF);
 	__m128i v_mask   = _mm_set1_epi32(0x00FF0000);
 
-	for (y = start_y; y < end_y; y += 2) {
+	for (y = start_y; y + 2 <= end_y; y += 2) {
 		uint32_t y_pos        = y      * in_linesize;
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -199,7 +346,370 @@ void convert_uyvx_to_i444(
 			pack_shift(v_plane, lum_pos0, lum_pos1,
 					line1, line2, v_mask, 2);
 		}
+
+		i444_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+		i444_row_c(input, in_linesize, y + 1, x, width,
+				output, out_linesize);
+	}
+
+	/* two rows at a time, the last one of an odd number on its own */
+	if (y < end_y)
+		i444_row_c(input, in_linesize, y, 0, width,
+				output, out_linesize);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* AVX2: eight pixels per row at a time.  Each 128-bit lane is shuffled to
+ * YYYY UUUU VVVV, then the dwords are permuted so that the low lane holds the
+ * eight luma values and the high lane holds the eight U and eight V values. */
+
+#ifdef CONVERT_AVX2
+
+#define AVX2_UYVX_SHUFFLE \
+	_mm256_setr_epi8(1, 5, 9, 13, 0, 4, 8, 12, 2, 6, 10, 14, \
+			-1, -1, -1, -1, 1, 5, 9, 13, 0, 4, 8, 12, \
+			2, 6, 10, 14, -1, -1, -1, -1)
+#define AVX2_UYVX_PERMUTE \
+	_mm256_setr_epi32(0, 4, 3, 7, 1, 5, 2, 6)
+
+AVX2_FUNC static FORCE_INLINE __m256i unpack_uyvx_avx2(const uint8_t *img,
+		__m256i shuffle, __m256i permute)
+{
+	__m256i line = _mm256_loadu_si256((const __m256i*)img);
+	line = _mm256_shuffle_epi8(line, shuffle);
+	return _mm256_permutevar8x32_epi32(line, permute);
+}
+
+/* returns the four averaged U values in the low dword of the low lane and the
+ * four averaged V values in the low dword of the high lane */
+AVX2_FUNC static FORCE_INLINE __m256i average_uv_avx2(__m256i line1,
+		__m256i line2)
+{
+	__m256i sum = _mm256_add_epi16(
+			_mm256_cvtepu8_epi16(_mm256_extracti128_si256(line1, 1)),
+			_mm256_cvtepu8_epi16(_mm256_extracti128_si256(line2, 1)));
+	sum = _mm256_srli_epi16(_mm256_hadd_epi16(sum, sum), 2);
+	return _mm256_packus_epi16(sum, sum);
+}
+
+AVX2_FUNC static void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width   = min_uint32(in_linesize, out_linesize[0]);
+	__m256i shuffle  = AVX2_UYVX_SHUFFLE;
+	__m256i permute  = AVX2_UYVX_PERMUTE;
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img1 = input + y * in_linesize;
+		const uint8_t *img2 = img1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i line1 = unpack_uyvx_avx2(img1 + x*4,
+					shuffle, permute);
+			__m256i line2 = unpack_uyvx_avx2(img2 + x*4,
+					shuffle, permute);
+			__m256i uv    = average_uv_avx2(line1, line2);
+
+			_mm_storel_epi64((__m128i*)(lum0 + x),
+					_mm256_castsi256_si128(line1));
+			_mm_storel_epi64((__m128i*)(lum1 + x),
+					_mm256_castsi256_si128(line2));
+
+			*(uint32_t*)(u + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(
+					_mm256_castsi256_si128(uv));
+			*(uint32_t*)(v + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(
+					_mm256_extracti128_si256(uv, 1));
+		}
+
+		i420_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+AVX2_FUNC static void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width   = min_uint32(in_linesize, out_linesize[0]);
+	__m256i shuffle  = AVX2_UYVX_SHUFFLE;
+	__m256i permute  = AVX2_UYVX_PERMUTE;
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img1 = input + y * in_linesize;
+		const uint8_t *img2 = img1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *uv   = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i line1 = unpack_uyvx_avx2(img1 + x*4,
+					shuffle, permute);
+			__m256i line2 = unpack_uyvx_avx2(img2 + x*4,
+					shuffle, permute);
+			__m256i avg   = average_uv_avx2(line1, line2);
+
+			_mm_storel_epi64((__m128i*)(lum0 + x),
+					_mm256_castsi256_si128(line1));
+			_mm_storel_epi64((__m128i*)(lum1 + x),
+					_mm256_castsi256_si128(line2));
+
+			_mm_storel_epi64((__m128i*)(uv + x), _mm_unpacklo_epi8(
+					_mm256_castsi256_si128(avg),
+					_mm256_extracti128_si256(avg, 1)));
+		}
+
+		nv12_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+AVX2_FUNC static void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width   = min_uint32(in_linesize, out_linesize[0]);
+	__m256i shuffle  = AVX2_UYVX_SHUFFLE;
+	__m256i permute  = AVX2_UYVX_PERMUTE;
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *img = input + y * in_linesize;
+		uint8_t *lum = output[0] + y * out_linesize[0];
+		uint8_t *u   = output[1] + y * out_linesize[0];
+		uint8_t *v   = output[2] + y * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i line = unpack_uyvx_avx2(img + x*4,
+					shuffle, permute);
+			__m128i uv   = _mm256_extracti128_si256(line, 1);
+
+			_mm_storel_epi64((__m128i*)(lum + x),
+					_mm256_castsi256_si128(line));
+			_mm_storel_epi64((__m128i*)(u + x), uv);
+			_mm_storel_epi64((__m128i*)(v + x),
+					_mm_srli_si128(uv, 8));
+		}
+
+		i444_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+static bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	/* AVX and OSXSAVE, and the OS must be saving the YMM registers */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28))
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* NEON: sixteen pixels per row at a time, vld4 deinterleaves the channels */
+
+#ifdef CONVERT_NEON
+
+static void compress_uyvx_to_i420_neon(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img1 = input + y * in_linesize;
+		const uint8_t *img2 = img1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x + 16 <= width; x += 16) {
+			uint8x16x4_t line1 = vld4q_u8(img1 + x*4);
+			uint8x16x4_t line2 = vld4q_u8(img2 + x*4);
+			uint16x8_t u_sum = vaddq_u16(vpaddlq_u8(line1.val[0]),
+					vpaddlq_u8(line2.val[0]));
+			uint16x8_t v_sum = vaddq_u16(vpaddlq_u8(line1.val[2]),
+					vpaddlq_u8(line2.val[2]));
+
+			vst1q_u8(lum0 + x, line1.val[1]);
+			vst1q_u8(lum1 + x, line2.val[1]);
+			vst1_u8(u + (x>>1), vshrn_n_u16(u_sum, 2));
+			vst1_u8(v + (x>>1), vshrn_n_u16(v_sum, 2));
+		}
+
+		i420_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+static void compress_uyvx_to_nv12_neon(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *img1 = input + y * in_linesize;
+		const uint8_t *img2 = img1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *uv   = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x + 16 <= width; x += 16) {
+			uint8x16x4_t line1 = vld4q_u8(img1 + x*4);
+			uint8x16x4_t line2 = vld4q_u8(img2 + x*4);
+			uint16x8_t u_sum = vaddq_u16(vpaddlq_u8(line1.val[0]),
+					vpaddlq_u8(line2.val[0]));
+			uint16x8_t v_sum = vaddq_u16(vpaddlq_u8(line1.val[2]),
+					vpaddlq_u8(line2.val[2]));
+			uint8x8x2_t chroma;
+
+			chroma.val[0] = vshrn_n_u16(u_sum, 2);
+			chroma.val[1] = vshrn_n_u16(v_sum, 2);
+
+			vst1q_u8(lum0 + x, line1.val[1]);
+			vst1q_u8(lum1 + x, line2.val[1]);
+			vst2_u8(uv + x, chroma);
+		}
+
+		nv12_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+static void convert_uyvx_to_i444_neon(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *img = input + y * in_linesize;
+		uint8_t *lum = output[0] + y * out_linesize[0];
+		uint8_t *u   = output[1] + y * out_linesize[0];
+		uint8_t *v   = output[2] + y * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x + 16 <= width; x += 16) {
+			uint8x16x4_t line = vld4q_u8(img + x*4);
+
+			vst1q_u8(lum + x, line.val[1]);
+			vst1q_u8(u + x, line.val[0]);
+			vst1q_u8(v + x, line.val[2]);
+		}
+
+		i444_row_c(input, in_linesize, y, x, width,
+				output, out_linesize);
+	}
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* runtime dispatch */
+
+static pthread_once_t conversion_once = PTHREAD_ONCE_INIT;
+static uyvx_convert_t uyvx_to_i420 = compress_uyvx_to_i420_c;
+static uyvx_convert_t uyvx_to_nv12 = compress_uyvx_to_nv12_c;
+static uyvx_convert_t uyvx_to_i444 = convert_uyvx_to_i444_c;
+
+static void init_conversion_funcs(void)
+{
+	const char *impl = "C";
+
+#if defined(CONVERT_AVX2)
+	if (cpu_has_avx2()) {
+		uyvx_to_i420 = compress_uyvx_to_i420_avx2;
+		uyvx_to_nv12 = compress_uyvx_to_nv12_avx2;
+		uyvx_to_i444 = convert_uyvx_to_i444_avx2;
+		impl = "AVX2";
+	} else {
+		uyvx_to_i420 = compress_uyvx_to_i420_sse2;
+		uyvx_to_nv12 = compress_uyvx_to_nv12_sse2;
+		uyvx_to_i444 = convert_uyvx_to_i444_sse2;
+		impl = "SSE2";
 	}
+#elif defined(CONVERT_SSE2)
+	uyvx_to_i420 = compress_uyvx_to_i420_sse2;
+	uyvx_to_nv12 = compress_uyvx_to_nv12_sse2;
+	uyvx_to_i444 = convert_uyvx_to_i444_sse2;
+	impl = "SSE2";
+#elif defined(CONVERT_NEON)
+	uyvx_to_i420 = compress_uyvx_to_i420_neon;
+	uyvx_to_nv12 = compress_uyvx_to_nv12_neon;
+	uyvx_to_i444 = convert_uyvx_to_i444_neon;
+	impl = "NEON";
+#endif
+
+	blog(LOG_DEBUG, "Using %s format conversion functions", impl);
+}
+
+void compress_uyvx_to_i420(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	pthread_once(&conversion_once, init_conversion_funcs);
+	uyvx_to_i420(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	pthread_once(&conversion_once, init_conversion_funcs);
+	uyvx_to_nv12(input, in_linesize, start_y, end_y, output, out_linesize);
+}
+
+void convert_uyvx_to_i444(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	pthread_once(&conversion_once, init_conversion_funcs);
+	uyvx_to_i444(input, in_linesize, start_y, end_y, output, out_linesize);
 }
 
 void decompress_420(
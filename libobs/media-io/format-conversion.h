@@ -25,6 +25,9 @@ extern "C" {
 
 /*
  * Functions for converting to and from packed 444 YUV
+ *
+ * The packed 444 compression functions pick an AVX2, SSE2, NEON or plain C
+ * implementation the first time they are called, depending on the CPU.
  */
 
 EXPORT void compress_uyvx_to_i420(
@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/circlebuf.h"
 
 #include "format-conversion.h"
 #include "video-io.h"
@@ -30,32 +31,72 @@
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
-#define MAX_CONVERT_BUFFERS 3
+#define MAX_CONVERT_BUFFERS 4
 #define MAX_CACHE_SIZE 16
+#define MAX_INPUT_QUEUE 2
 
 struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+	long refs;
 };
 
-struct video_input {
+struct converted_frame {
+	struct video_frame        frame;
+	volatile long             refs;
+};
+
+/* a frame queued for an input or a conversion.  holds a reference to either
+ * the cached frame or the converted frame it points to until it's done with */
+struct input_frame {
+	struct video_data         frame;
+	struct cached_frame_info  *cfi;
+	struct converted_frame    *cvf;
+};
+
+/* a queue of frames serviced by its own thread */
+struct video_queue {
+	pthread_t                 thread;
+	pthread_mutex_t           mutex;
+	os_sem_t                  *semaphore;
+	struct circlebuf          frames;
+	volatile bool             stop;
+	bool                      thread_initialized;
+};
+
+/* inputs that request the same conversion share a single scaler, which
+ * converts each frame once for all of them */
+struct video_convert {
+	struct video_output       *video;
 	struct video_scale_info   conversion;
 	video_scaler_t            *scaler;
-	struct video_frame        frame[MAX_CONVERT_BUFFERS];
-	int                       cur_frame;
+	struct converted_frame    frames[MAX_CONVERT_BUFFERS];
+	struct video_queue        queue;
+
+	DARRAY(struct video_input*) inputs;
+};
+
+struct video_input {
+	struct video_output       *video;
+	struct video_scale_info   conversion;
+	struct video_convert      *convert;
+	struct video_queue        queue;
+
+	/* set when the input was disconnected from its own callback.  the
+	 * thread then finishes on its own and destroys the conversion the
+	 * input was the last user of, and is joined later */
+	bool                      detached;
+	struct video_convert      *detached_convert;
+	volatile bool             finished;
+
+	volatile long             skipped_frames;
+	volatile long             total_frames;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
 };
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
-
 struct video_output {
 	struct video_output_info   info;
 
@@ -71,7 +112,9 @@ struct video_output {
 	bool                       initialized;
 
 	pthread_mutex_t            input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input*) inputs;
+	DARRAY(struct video_convert*) converts;
+	DARRAY(struct video_input*) detached_inputs;
 
 	size_t                     available_frames;
 	size_t                     first_added;
@@ -84,40 +127,422 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input,
-		struct video_data *data)
+static inline void release_frame(struct video_output *video,
+		struct input_frame *frame)
 {
-	bool success = true;
+	if (frame->cvf) {
+		os_atomic_dec_long(&frame->cvf->refs);
+	} else {
+		pthread_mutex_lock(&video->data_mutex);
+		frame->cfi->refs--;
+		pthread_mutex_unlock(&video->data_mutex);
+	}
+}
 
-	if (input->scaler) {
-		struct video_frame *frame;
+static inline bool video_queue_init(struct video_queue *queue,
+		void *(*thread_func)(void *), void *param)
+{
+	if (pthread_mutex_init(&queue->mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&queue->semaphore, 0) != 0)
+		return false;
+	if (pthread_create(&queue->thread, NULL, thread_func, param) != 0)
+		return false;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	queue->thread_initialized = true;
+	return true;
+}
 
-		frame = &input->frame[input->cur_frame];
+static inline void video_queue_stop(struct video_queue *queue)
+{
+	if (queue->thread_initialized) {
+		queue->stop = true;
+		os_sem_post(queue->semaphore);
+		pthread_join(queue->thread, NULL);
+		queue->thread_initialized = false;
+	}
+}
 
-		success = video_scaler_scale(input->scaler,
-				frame->data, frame->linesize,
-				(const uint8_t * const*)data->data,
-				data->linesize);
+static void video_queue_clear(struct video_output *video,
+		struct video_queue *queue)
+{
+	pthread_mutex_lock(&queue->mutex);
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i]     = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
+	while (queue->frames.size) {
+		struct input_frame frame;
+		circlebuf_pop_front(&queue->frames, &frame, sizeof(frame));
+		release_frame(video, &frame);
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+static inline void video_queue_free(struct video_queue *queue)
+{
+	circlebuf_free(&queue->frames);
+	os_sem_destroy(queue->semaphore);
+	pthread_mutex_destroy(&queue->mutex);
+}
+
+/* waits for the next queued frame.  returns false when the queue has been
+ * stopped */
+static bool video_queue_pop(struct video_queue *queue,
+		struct input_frame *frame)
+{
+	for (;;) {
+		bool has_frame = false;
+
+		if (os_sem_wait(queue->semaphore) != 0 || queue->stop)
+			return false;
+
+		pthread_mutex_lock(&queue->mutex);
+		if (queue->frames.size) {
+			circlebuf_pop_front(&queue->frames, frame,
+					sizeof(*frame));
+			has_frame = true;
+		}
+		pthread_mutex_unlock(&queue->mutex);
+
+		if (has_frame)
+			return true;
+	}
+}
+
+/* queues a frame and takes a reference to it.  returns false if the
+ * consumer has not yet finished processing previous frames, in which case
+ * it skips this one */
+static bool video_queue_push(struct video_output *video,
+		struct video_queue *queue, const struct input_frame *frame)
+{
+	bool full;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	full = queue->frames.size >= MAX_INPUT_QUEUE * sizeof(*frame);
+	if (!full) {
+		if (frame->cvf) {
+			os_atomic_inc_long(&frame->cvf->refs);
+		} else {
+			pthread_mutex_lock(&video->data_mutex);
+			frame->cfi->refs++;
+			pthread_mutex_unlock(&video->data_mutex);
+		}
+
+		circlebuf_push_back(&queue->frames, frame, sizeof(*frame));
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (!full)
+		os_sem_post(queue->semaphore);
+	return !full;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void video_convert_destroy(struct video_convert *convert);
+
+static bool video_input_push(struct video_input *input,
+		const struct input_frame *frame)
+{
+	if (!video_queue_push(input->video, &input->queue, frame)) {
+		os_atomic_inc_long(&input->skipped_frames);
+		os_atomic_inc_long(&input->total_frames);
+		return false;
+	}
+
+	return true;
+}
+
+static void video_input_free(struct video_input *input)
+{
+	video_queue_free(&input->queue);
+	bfree(input);
+}
+
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+	struct video_output *video = input->video;
+	struct input_frame frame;
+
+	os_set_thread_name("video-io: input thread");
+
+	const char *input_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"video_input_thread(%s)", video->info.name);
+
+	while (video_queue_pop(&input->queue, &frame)) {
+		profile_start(input_thread_name);
+
+		input->callback(input->param, &frame.frame);
+
+		release_frame(video, &frame);
+		os_atomic_inc_long(&input->total_frames);
+
+		profile_end(input_thread_name);
+
+		profile_reenable_thread();
+	}
+
+	video_queue_clear(video, &input->queue);
+
+	/* the input was disconnected from within its own callback: its frames
+	 * are released now, so the conversion they came from can go */
+	if (input->detached) {
+		video_convert_destroy(input->detached_convert);
+		input->detached_convert = NULL;
+	}
+
+	os_atomic_set_bool(&input->finished, true);
+	return NULL;
+}
+
+/* stops and frees the input, then destroys convert, which must no longer be
+ * used by any other input.  frames queued for the input point in to the
+ * conversion's buffers, so the conversion has to outlive the input thread */
+static void video_input_stop(struct video_input *input,
+		struct video_convert *convert)
+{
+	struct video_output *video = input->video;
+	struct video_queue *queue = &input->queue;
+
+	if (queue->thread_initialized &&
+	    pthread_equal(pthread_self(), queue->thread)) {
+		queue->stop = true;
+		input->detached = true;
+		input->detached_convert = convert;
+
+		pthread_mutex_lock(&video->input_mutex);
+		da_push_back(video->detached_inputs, &input);
+		pthread_mutex_unlock(&video->input_mutex);
+		return;
+	}
+
+	video_queue_stop(queue);
+	video_input_free(input);
+	video_convert_destroy(convert);
+}
+
+/* joins inputs that were disconnected from their own callbacks, either only
+ * the ones that have finished, or all of them */
+static void video_join_detached_inputs(struct video_output *video,
+		bool wait)
+{
+	DARRAY(struct video_input*) finished;
+	da_init(finished);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	for (size_t i = video->detached_inputs.num; i > 0; i--) {
+		struct video_input *input = video->detached_inputs.array[i - 1];
+
+		if (wait || os_atomic_load_bool(&input->finished)) {
+			da_push_back(finished, &input);
+			da_erase(video->detached_inputs, i - 1);
+		}
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (size_t i = 0; i < finished.num; i++) {
+		struct video_input *input = finished.array[i];
+
+		video_queue_stop(&input->queue);
+		video_input_free(input);
+	}
+
+	da_free(finished);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool scale_info_equal(const struct video_scale_info *a,
+		const struct video_scale_info *b)
+{
+	return a->format     == b->format &&
+	       a->width      == b->width &&
+	       a->height     == b->height &&
+	       a->range      == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+static struct converted_frame *get_free_converted_frame(
+		struct video_convert *convert)
+{
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++) {
+		struct converted_frame *cvf = &convert->frames[i];
+		if (os_atomic_load_long(&cvf->refs) == 0)
+			return cvf;
+	}
+
+	return NULL;
+}
+
+static void skip_convert_inputs(struct video_convert *convert)
+{
+	pthread_mutex_lock(&convert->video->input_mutex);
+
+	for (size_t i = 0; i < convert->inputs.num; i++) {
+		struct video_input *input = convert->inputs.array[i];
+		os_atomic_inc_long(&input->skipped_frames);
+		os_atomic_inc_long(&input->total_frames);
+	}
+
+	pthread_mutex_unlock(&convert->video->input_mutex);
+}
+
+static bool convert_frame(struct video_convert *convert,
+		struct input_frame *in, struct input_frame *out)
+{
+	struct converted_frame *cvf = get_free_converted_frame(convert);
+	bool success;
+
+	/* every buffer is still held by an input that hasn't caught up */
+	if (!cvf)
+		return false;
+
+	success = video_scaler_scale(convert->scaler,
+			cvf->frame.data, cvf->frame.linesize,
+			(const uint8_t * const*)in->frame.data,
+			in->frame.linesize);
+	if (!success) {
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+		return false;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		out->frame.data[i]     = cvf->frame.data[i];
+		out->frame.linesize[i] = cvf->frame.linesize[i];
+	}
+
+	out->frame.timestamp = in->frame.timestamp;
+	out->cfi = NULL;
+	out->cvf = cvf;
+	return true;
+}
+
+static void *video_convert_thread(void *param)
+{
+	struct video_convert *convert = param;
+	struct video_output *video = convert->video;
+	struct input_frame frame;
+
+	os_set_thread_name("video-io: convert thread");
+
+	const char *convert_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"video_convert_thread(%s: %"PRIu32"x%"PRIu32")",
+				video->info.name,
+				convert->conversion.width,
+				convert->conversion.height);
+
+	while (video_queue_pop(&convert->queue, &frame)) {
+		struct input_frame out;
+
+		profile_start(convert_thread_name);
+
+		if (convert_frame(convert, &frame, &out)) {
+			/* hold a reference while handing the frame out so
+			 * that it can't be reused in the meantime */
+			os_atomic_inc_long(&out.cvf->refs);
+
+			pthread_mutex_lock(&video->input_mutex);
+
+			for (size_t i = 0; i < convert->inputs.num; i++) {
+				video_input_push(convert->inputs.array[i],
+						&out);
 			}
+
+			pthread_mutex_unlock(&video->input_mutex);
+
+			os_atomic_dec_long(&out.cvf->refs);
+
 		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+			skip_convert_inputs(convert);
 		}
+
+		release_frame(video, &frame);
+
+		profile_end(convert_thread_name);
+
+		profile_reenable_thread();
 	}
 
-	return success;
+	video_queue_clear(video, &convert->queue);
+	return NULL;
+}
+
+static void video_convert_destroy(struct video_convert *convert)
+{
+	if (!convert)
+		return;
+
+	video_queue_stop(&convert->queue);
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_free(&convert->frames[i].frame);
+	video_scaler_destroy(convert->scaler);
+	video_queue_free(&convert->queue);
+	da_free(convert->inputs);
+	bfree(convert);
+}
+
+static struct video_convert *video_convert_create(struct video_output *video,
+		const struct video_scale_info *conversion)
+{
+	struct video_convert *convert = bzalloc(sizeof(*convert));
+	struct video_scale_info from = {
+		.format     = video->info.format,
+		.width      = video->info.width,
+		.height     = video->info.height,
+		.range      = video->info.range,
+		.colorspace = video->info.colorspace
+	};
+	int ret;
+
+	convert->video = video;
+	convert->conversion = *conversion;
+	pthread_mutex_init_value(&convert->queue.mutex);
+
+	ret = video_scaler_create2(&convert->scaler, conversion, &from,
+			VIDEO_SCALE_FAST_BILINEAR, 0);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_convert_create: Bad "
+			                "scale conversion type");
+		else
+			blog(LOG_ERROR, "video_convert_create: Failed to "
+			                "create scaler");
+		goto fail;
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_init(&convert->frames[i].frame,
+				conversion->format,
+				conversion->width, conversion->height);
+
+	if (!video_queue_init(&convert->queue, video_convert_thread,
+				convert)) {
+		blog(LOG_ERROR, "video_convert_create: Failed to create "
+		                "convert thread");
+		goto fail;
+	}
+
+	return convert;
+
+fail:
+	video_convert_destroy(convert);
+	return NULL;
 }
 
+/* ------------------------------------------------------------------------- */
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
+	struct input_frame frame = {0};
+	bool frame_skipped = false;
 	bool complete;
 	bool skipped;
 
@@ -126,6 +551,8 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->data_mutex);
 
 	frame_info = &video->cache[video->first_added];
+	frame.frame = frame_info->frame;
+	frame.cfi = frame_info;
 
 	pthread_mutex_unlock(&video->data_mutex);
 
@@ -134,11 +561,19 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
-		struct video_data frame = frame_info->frame;
+		struct video_input *input = video->inputs.array[i];
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		if (!input->convert && !video_input_push(input, &frame))
+			frame_skipped = true;
+	}
+
+	for (size_t i = 0; i < video->converts.num; i++) {
+		struct video_convert *convert = video->converts.array[i];
+
+		if (!video_queue_push(video, &convert->queue, &frame)) {
+			skip_convert_inputs(convert);
+			frame_skipped = true;
+		}
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -159,11 +594,19 @@ static inline bool video_output_cur_frame(struct video_output *video)
 			video->last_added = video->first_added;
 	} else if (skipped) {
 		--frame_info->skipped;
-		os_atomic_inc_long(&video->skipped_frames);
+		frame_skipped = true;
 	}
 
 	pthread_mutex_unlock(&video->data_mutex);
 
+	/* a frame is counted as skipped once, whether it repeats a frame that
+	 * the video thread lagged on or one or more inputs could not keep up
+	 * with it.  frames that a conversion drops later on are only counted
+	 * by the inputs of that conversion, as the frame may already have
+	 * been counted here */
+	if (frame_skipped)
+		os_atomic_inc_long(&video->skipped_frames);
+
 	/* -------------------------------- */
 
 	return complete;
@@ -269,10 +712,23 @@ void video_output_close(video_t *video)
 
 	video_output_stop(video);
 
+	/* conversion threads push to inputs, so they are stopped first, but
+	 * their buffers are only freed once no input can use them anymore */
+	for (size_t i = 0; i < video->converts.num; i++)
+		video_queue_stop(&video->converts.array[i]->queue);
+
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_stop(video->inputs.array[i], NULL);
 	da_free(video->inputs);
 
+	for (size_t i = 0; i < video->converts.num; i++)
+		video_convert_destroy(video->converts.array[i]);
+	da_free(video->converts);
+
+	if (video->detached_inputs.num)
+		video_join_detached_inputs(video, true);
+	da_free(video->detached_inputs);
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame*)&video->cache[i]);
 
@@ -287,7 +743,7 @@ static size_t video_get_input_idx(const video_t *video,
 		void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -298,41 +754,62 @@ static size_t video_get_input_idx(const video_t *video,
 static inline bool video_input_init(struct video_input *input,
 		struct video_output *video)
 {
+	input->video = video;
+
 	if (input->conversion.width  != video->info.width ||
 	    input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format) {
-		struct video_scale_info from = {
-			.format = video->info.format,
-			.width  = video->info.width,
-			.height = video->info.height,
-			.range = video->info.range,
-			.colorspace = video->info.colorspace
-		};
-
-		int ret = video_scaler_create(&input->scaler,
-				&input->conversion, &from,
-				VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-				                "scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-				                "create scaler");
+		for (size_t i = 0; i < video->converts.num; i++) {
+			struct video_convert *convert =
+				video->converts.array[i];
+
+			if (scale_info_equal(&convert->conversion,
+						&input->conversion)) {
+				input->convert = convert;
+				break;
+			}
+		}
 
-			return false;
+		if (!input->convert) {
+			input->convert = video_convert_create(video,
+					&input->conversion);
+			if (!input->convert)
+				return false;
+
+			da_push_back(video->converts, &input->convert);
 		}
+	}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					input->conversion.format,
-					input->conversion.width,
-					input->conversion.height);
+	if (!video_queue_init(&input->queue, video_input_thread, input)) {
+		blog(LOG_ERROR, "video_input_init: Failed to create input "
+		                "thread");
+		return false;
 	}
 
+	if (input->convert)
+		da_push_back(input->convert->inputs, &input);
 	return true;
 }
 
+/* must be called with input_mutex locked.  returns the conversion if it's
+ * no longer used by any input and needs to be destroyed */
+static struct video_convert *video_input_detach_convert(
+		struct video_input *input)
+{
+	struct video_convert *convert = input->convert;
+	struct video_output *video = input->video;
+
+	if (!convert)
+		return NULL;
+
+	da_erase_item(convert->inputs, &input);
+	if (convert->inputs.num)
+		return NULL;
+
+	da_erase_item(video->converts, &convert);
+	return convert;
+}
+
 static inline void reset_frames(video_t *video)
 {
 	os_atomic_set_long(&video->skipped_frames, 0);
@@ -344,6 +821,8 @@ bool video_output_connect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
+	struct video_convert *failed_convert = NULL;
+	struct video_input *failed_input = NULL;
 	bool success = false;
 
 	if (!video || !callback)
@@ -352,26 +831,26 @@ bool video_output_connect(video_t *video,
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
+		pthread_mutex_init_value(&input->queue.mutex);
 
-		input.callback = callback;
-		input.param    = param;
+		input->callback = callback;
+		input->param    = param;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format    = video->info.format;
-			input.conversion.width     = video->info.width;
-			input.conversion.height    = video->info.height;
+			input->conversion.format    = video->info.format;
+			input->conversion.width     = video->info.width;
+			input->conversion.height    = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
 
-		success = video_input_init(&input, video);
+		success = video_input_init(input, video);
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -380,11 +859,20 @@ bool video_output_connect(video_t *video,
 				os_atomic_set_bool(&video->raw_active, true);
 			}
 			da_push_back(video->inputs, &input);
+		} else {
+			failed_convert = video_input_detach_convert(input);
+			failed_input = input;
 		}
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
 
+	/* threads are joined outside of input_mutex, conversion threads
+	 * lock it to hand out frames */
+	if (failed_input)
+		video_input_stop(failed_input, failed_convert);
+
+	video_join_detached_inputs(video, false);
 	return success;
 }
 
@@ -406,10 +894,26 @@ static void log_skipped(video_t *video)
 				percentage_skipped);
 }
 
+static void log_input_skipped(struct video_input *input)
+{
+	long skipped = os_atomic_load_long(&input->skipped_frames);
+	long total = os_atomic_load_long(&input->total_frames);
+
+	if (skipped)
+		blog(LOG_INFO, "Video input stopped, number of frames "
+				"skipped by this input due to encoding lag: "
+				"%ld/%ld (%0.1f%%)",
+				skipped, total,
+				(double)skipped / (double)total * 100.0);
+}
+
 void video_output_disconnect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
+	struct video_convert *convert = NULL;
+	struct video_input *input = NULL;
+
 	if (!video || !callback)
 		return;
 
@@ -417,9 +921,12 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array+idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
 
+		convert = video_input_detach_convert(input);
+		log_input_skipped(input);
+
 		if (video->inputs.num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
 			if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -429,6 +936,13 @@ void video_output_disconnect(video_t *video,
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	/* threads are joined outside of input_mutex, conversion threads
+	 * lock it to hand out frames */
+	if (input)
+		video_input_stop(input, convert);
+
+	video_join_detached_inputs(video, false);
 }
 
 bool video_output_active(const video_t *video)
@@ -458,12 +972,36 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		locked = false;
 
 	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
+		bool all_available =
+			video->available_frames == video->info.cache_size;
+		size_t idx = video->last_added;
+
+		if (!all_available && ++idx == video->info.cache_size)
+			idx = 0;
+
+		cfi = &video->cache[idx];
+
+		/* the next frame in the cache is still held by an input that
+		 * hasn't caught up yet */
+		if (cfi->refs) {
+			if (all_available) {
+				for (int i = 0; i < count; i++) {
+					os_atomic_inc_long(
+						&video->skipped_frames);
+					os_atomic_inc_long(
+						&video->total_frames);
+				}
+			} else {
+				video->cache[video->last_added].count += count;
+				video->cache[video->last_added].skipped +=
+					count;
+			}
+
+			pthread_mutex_unlock(&video->data_mutex);
+			return false;
 		}
 
-		cfi = &video->cache[video->last_added];
+		video->last_added = idx;
 		cfi->frame.timestamp = timestamp;
 		cfi->count = count;
 		cfi->skipped = 0;
@@ -16,13 +16,59 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
 #include "video-scaler.h"
 
 #include <libswscale/swscale.h>
 
-struct video_scaler {
+#define MAX_SCALER_THREADS 4
+
+/* frames smaller than this aren't worth splitting up */
+#define MIN_THREADED_SCALE_PIXELS (1280 * 720)
+
+/* each slice converts a horizontal band of the frame with its own swscale
+ * context.  slice boundaries are chosen so that they map to whole rows (and
+ * whole chroma rows) in both the source and the destination.
+ *
+ * when scaling vertically, the filter at the edge of a band would clamp to
+ * the band's first or last row and leave a seam, so slices then also scale
+ * some rows of the neighbouring bands in to their own buffer and only copy
+ * their band's rows to the output */
+struct video_scaler_slice {
+	struct video_scaler *scaler;
 	struct SwsContext *swscale;
+	int src_y;
 	int src_height;
+	int dst_y;
+	int dst_height;
+
+	int crop_top;
+	uint8_t *scratch[MAX_AV_PLANES];
+	int scratch_linesize[MAX_AV_PLANES];
+
+	pthread_t thread;
+	os_sem_t *start_sem;
+	bool thread_initialized;
+	bool success;
+};
+
+struct video_scaler {
+	struct video_scaler_slice slices[MAX_SCALER_THREADS];
+	int num_slices;
+
+	enum video_format src_format;
+	enum video_format dst_format;
+	int dst_width;
+	enum video_scale_type type;
+
+	os_sem_t *done_sem;
+	volatile bool stop;
+
+	uint8_t *const *output;
+	const uint32_t *out_linesize;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
 };
 
 static inline enum AVPixelFormat get_ffmpeg_video_format(
@@ -80,16 +126,236 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 	return 0;
 }
 
+static inline size_t get_num_planes(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I444:
+		return 3;
+	case VIDEO_FORMAT_NV12:
+		return 2;
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+		return 1;
+	}
+
+	return 1;
+}
+
+static inline int get_plane_row(enum video_format format, size_t plane, int y)
+{
+	bool half_height = plane > 0 &&
+		(format == VIDEO_FORMAT_I420 || format == VIDEO_FORMAT_NV12);
+	return half_height ? y / 2 : y;
+}
+
+static inline int get_plane_row_bytes(enum video_format format, size_t plane,
+		int width)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+		return plane > 0 ? (width + 1) / 2 : width;
+	case VIDEO_FORMAT_NV12:
+		return plane > 0 ? (width + 1) / 2 * 2 : width;
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+		return (width + 1) / 2 * 4;
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		return width * 4;
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_NONE:
+		return width;
+	}
+
+	return width;
+}
+
+static inline int gcd(int a, int b)
+{
+	while (b) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static int get_auto_threads(const struct video_scale_info *dst,
+		const struct video_scale_info *src)
+{
+	uint64_t src_pixels = (uint64_t)src->width * src->height;
+	uint64_t dst_pixels = (uint64_t)dst->width * dst->height;
+	int threads;
+
+	if (src_pixels < MIN_THREADED_SCALE_PIXELS &&
+	    dst_pixels < MIN_THREADED_SCALE_PIXELS)
+		return 1;
+
+	threads = os_get_logical_cores() / 2;
+	if (threads > MAX_SCALER_THREADS)
+		threads = MAX_SCALER_THREADS;
+	return threads < 1 ? 1 : threads;
+}
+
+static void *scaler_slice_thread(void *param);
+
+/* source rows on each side of a band needed so that the vertical filter of
+ * the band's own rows never reaches the edge of its slice: bicubic has a
+ * support of two output rows on each side, which covers more source rows
+ * when downscaling.  doubled for the chroma planes of 4:2:0 formats */
+static inline int get_filter_margin(int src_height, int dst_height)
+{
+	int ratio = (src_height + dst_height - 1) / dst_height;
+	return (4 * ratio + 2) * 2;
+}
+
+static void alloc_slice_scratch(struct video_scaler_slice *slice,
+		enum video_format format, int width, int height)
+{
+	size_t planes = get_num_planes(format);
+
+	for (size_t i = 0; i < planes; i++) {
+		int rows = i > 0 ? get_plane_row(format, i, height + 1) : height;
+		int linesize = get_plane_row_bytes(format, i, width);
+
+		linesize = (linesize + 31) & ~31;
+		slice->scratch_linesize[i] = linesize;
+		slice->scratch[i] = bmalloc((size_t)linesize * rows);
+	}
+}
+
+static bool init_slices(struct video_scaler *scaler,
+		const struct video_scale_info *dst,
+		const struct video_scale_info *src,
+		int threads)
+{
+	int div = gcd((int)src->height, (int)dst->height);
+	int src_unit = (int)src->height / div;
+	int dst_unit = (int)dst->height / div;
+	int pad_units = 0;
+	int units;
+
+	/* keep slice boundaries on even rows so that chroma rows of 4:2:0
+	 * formats aren't split between slices */
+	if ((src_unit & 1) || (dst_unit & 1)) {
+		src_unit *= 2;
+		dst_unit *= 2;
+	}
+
+	units = (int)dst->height / dst_unit;
+	if (threads > units)
+		threads = units;
+	if (threads < 1)
+		threads = 1;
+
+	scaler->num_slices = threads;
+
+	if (threads > 1 && src->height != dst->height) {
+		int margin = get_filter_margin((int)src->height,
+				(int)dst->height);
+		pad_units = (margin + src_unit - 1) / src_unit;
+	}
+
+	for (int i = 0; i < threads; i++) {
+		struct video_scaler_slice *slice = &scaler->slices[i];
+		int unit_start = units * i / threads;
+		int unit_end   = units * (i + 1) / threads;
+		int pad_start  = unit_start - pad_units;
+		int pad_end    = unit_end + pad_units;
+		int src_y, src_end, dst_y, dst_end;
+
+		if (pad_start < 0)
+			pad_start = 0;
+		if (pad_end > units)
+			pad_end = units;
+
+		slice->scaler = scaler;
+		slice->dst_y  = unit_start * dst_unit;
+		dst_end = (i == threads - 1) ?
+			(int)dst->height : unit_end * dst_unit;
+		slice->dst_height = dst_end - slice->dst_y;
+
+		/* the rows actually scaled, including the padding */
+		src_y   = pad_start * src_unit;
+		dst_y   = pad_start * dst_unit;
+		src_end = (pad_end == units) ?
+			(int)src->height : pad_end * src_unit;
+		dst_end = (pad_end == units) ?
+			(int)dst->height : pad_end * dst_unit;
+
+		slice->src_y      = src_y;
+		slice->src_height = src_end - src_y;
+		slice->crop_top   = slice->dst_y - dst_y;
+
+		if (dst_end - dst_y != slice->dst_height)
+			alloc_slice_scratch(slice, dst->format,
+					(int)dst->width, dst_end - dst_y);
+
+		slice->swscale = sws_getCachedContext(NULL,
+				src->width, slice->src_height,
+				get_ffmpeg_video_format(src->format),
+				dst->width, dst_end - dst_y,
+				get_ffmpeg_video_format(dst->format),
+				get_ffmpeg_scale_type(scaler->type),
+				NULL, NULL, NULL);
+		if (!slice->swscale)
+			return false;
+	}
+
+	return true;
+}
+
+static bool init_slice_threads(struct video_scaler *scaler)
+{
+	if (scaler->num_slices < 2)
+		return true;
+
+	if (os_sem_init(&scaler->done_sem, 0) != 0)
+		return false;
+
+	/* the first slice is always converted on the calling thread */
+	for (int i = 1; i < scaler->num_slices; i++) {
+		struct video_scaler_slice *slice = &scaler->slices[i];
+
+		if (os_sem_init(&slice->start_sem, 0) != 0)
+			return false;
+		if (pthread_create(&slice->thread, NULL, scaler_slice_thread,
+					slice) != 0)
+			return false;
+
+		slice->thread_initialized = true;
+	}
+
+	return true;
+}
+
 #define FIXED_1_0 (1<<16)
 
 int video_scaler_create(video_scaler_t **scaler_out,
 		const struct video_scale_info *dst,
 		const struct video_scale_info *src,
 		enum video_scale_type type)
+{
+	return video_scaler_create2(scaler_out, dst, src, type, 1);
+}
+
+int video_scaler_create2(video_scaler_t **scaler_out,
+		const struct video_scale_info *dst,
+		const struct video_scale_info *src,
+		enum video_scale_type type, int threads)
 {
 	enum AVPixelFormat format_src = get_ffmpeg_video_format(src->format);
 	enum AVPixelFormat format_dst = get_ffmpeg_video_format(dst->format);
-	int                scale_type = get_ffmpeg_scale_type(type);
 	const int          *coeff_src = get_ffmpeg_coeffs(src->colorspace);
 	const int          *coeff_dst = get_ffmpeg_coeffs(dst->colorspace);
 	int                range_src  = get_ffmpeg_range_type(src->range);
@@ -104,26 +370,39 @@ int video_scaler_create(video_scaler_t **scaler_out,
 	    format_dst == AV_PIX_FMT_NONE)
 		return VIDEO_SCALER_BAD_CONVERSION;
 
+	if (threads <= 0)
+		threads = get_auto_threads(dst, src);
+	if (threads > MAX_SCALER_THREADS)
+		threads = MAX_SCALER_THREADS;
+
 	scaler = bzalloc(sizeof(struct video_scaler));
-	scaler->src_height = src->height;
+	scaler->src_format = src->format;
+	scaler->dst_format = dst->format;
+	scaler->dst_width  = (int)dst->width;
+	scaler->type       = type;
 
-	scaler->swscale = sws_getCachedContext(NULL,
-			src->width, src->height, format_src,
-			dst->width, dst->height, format_dst,
-			scale_type, NULL, NULL, NULL);
-	if (!scaler->swscale) {
+	if (!init_slices(scaler, dst, src, threads)) {
 		blog(LOG_ERROR, "video_scaler_create: Could not create "
 		                "swscale");
 		goto fail;
 	}
 
-	ret = sws_setColorspaceDetails(scaler->swscale,
-			coeff_src, range_src,
-			coeff_dst, range_dst,
-			0, FIXED_1_0, FIXED_1_0);
-	if (ret < 0) {
-		blog(LOG_DEBUG, "video_scaler_create: "
-		                "sws_setColorspaceDetails failed, ignoring");
+	for (int i = 0; i < scaler->num_slices; i++) {
+		ret = sws_setColorspaceDetails(scaler->slices[i].swscale,
+				coeff_src, range_src,
+				coeff_dst, range_dst,
+				0, FIXED_1_0, FIXED_1_0);
+		if (ret < 0) {
+			blog(LOG_DEBUG, "video_scaler_create: "
+			                "sws_setColorspaceDetails failed, "
+			                "ignoring");
+		}
+	}
+
+	if (!init_slice_threads(scaler)) {
+		blog(LOG_ERROR, "video_scaler_create: Could not create "
+		                "scaler threads");
+		goto fail;
 	}
 
 	*scaler_out = scaler;
@@ -137,27 +416,128 @@ fail:
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
-		sws_freeContext(scaler->swscale);
+		scaler->stop = true;
+
+		for (int i = 0; i < scaler->num_slices; i++) {
+			struct video_scaler_slice *slice = &scaler->slices[i];
+
+			if (slice->thread_initialized) {
+				os_sem_post(slice->start_sem);
+				pthread_join(slice->thread, NULL);
+			}
+
+			os_sem_destroy(slice->start_sem);
+			sws_freeContext(slice->swscale);
+
+			for (size_t j = 0; j < MAX_AV_PLANES; j++)
+				bfree(slice->scratch[j]);
+		}
+
+		os_sem_destroy(scaler->done_sem);
 		bfree(scaler);
 	}
 }
 
+static void scale_slice(struct video_scaler_slice *slice)
+{
+	struct video_scaler *scaler = slice->scaler;
+	const uint8_t *input[MAX_AV_PLANES] = {0};
+	uint8_t *output[MAX_AV_PLANES] = {0};
+	size_t in_planes = get_num_planes(scaler->src_format);
+	size_t out_planes = get_num_planes(scaler->dst_format);
+
+	for (size_t i = 0; i < in_planes; i++) {
+		int row = get_plane_row(scaler->src_format, i, slice->src_y);
+		input[i] = scaler->input[i] +
+			(size_t)row * scaler->in_linesize[i];
+	}
+
+	for (size_t i = 0; i < out_planes; i++) {
+		int row = get_plane_row(scaler->dst_format, i, slice->dst_y);
+		output[i] = scaler->output[i] +
+			(size_t)row * scaler->out_linesize[i];
+	}
+
+	int ret = sws_scale(slice->swscale,
+			input, (const int *)scaler->in_linesize,
+			0, slice->src_height,
+			slice->scratch[0] ? slice->scratch : output,
+			slice->scratch[0] ? slice->scratch_linesize :
+				(const int *)scaler->out_linesize);
+	if (ret <= 0) {
+		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d",
+				ret);
+		slice->success = false;
+		return;
+	}
+
+	slice->success = true;
+
+	if (!slice->scratch[0])
+		return;
+
+	/* copy the slice's own band, without the padding rows */
+	for (size_t i = 0; i < out_planes; i++) {
+		int top  = get_plane_row(scaler->dst_format, i, slice->crop_top);
+		int rows = get_plane_row(scaler->dst_format, i,
+				slice->dst_y + slice->dst_height) -
+			get_plane_row(scaler->dst_format, i, slice->dst_y);
+		size_t row_bytes = (size_t)get_plane_row_bytes(
+				scaler->dst_format, i, scaler->dst_width);
+		const uint8_t *in = slice->scratch[i] +
+			(size_t)top * slice->scratch_linesize[i];
+		uint8_t *out = output[i];
+
+		for (int y = 0; y < rows; y++) {
+			memcpy(out, in, row_bytes);
+			in  += slice->scratch_linesize[i];
+			out += scaler->out_linesize[i];
+		}
+	}
+}
+
+static void *scaler_slice_thread(void *param)
+{
+	struct video_scaler_slice *slice = param;
+	struct video_scaler *scaler = slice->scaler;
+
+	os_set_thread_name("video-scaler: slice thread");
+
+	while (os_sem_wait(slice->start_sem) == 0) {
+		if (scaler->stop)
+			break;
+
+		scale_slice(slice);
+		os_sem_post(scaler->done_sem);
+	}
+
+	return NULL;
+}
+
 bool video_scaler_scale(video_scaler_t *scaler,
 		uint8_t *output[], const uint32_t out_linesize[],
 		const uint8_t *const input[], const uint32_t in_linesize[])
 {
+	bool success = true;
+
 	if (!scaler)
 		return false;
 
-	int ret = sws_scale(scaler->swscale,
-			input, (const int *)in_linesize,
-			0, scaler->src_height,
-			output, (const int *)out_linesize);
-	if (ret <= 0) {
-		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d",
-				ret);
-		return false;
-	}
+	scaler->output       = output;
+	scaler->out_linesize = out_linesize;
+	scaler->input        = input;
+	scaler->in_linesize  = in_linesize;
 
-	return true;
+	for (int i = 1; i < scaler->num_slices; i++)
+		os_sem_post(scaler->slices[i].start_sem);
+
+	scale_slice(&scaler->slices[0]);
+
+	for (int i = 1; i < scaler->num_slices; i++)
+		os_sem_wait(scaler->done_sem);
+
+	for (int i = 0; i < scaler->num_slices; i++)
+		success = success && scaler->slices[i].success;
+
+	return success;
 }
@@ -35,6 +35,16 @@ EXPORT int video_scaler_create(video_scaler_t **scaler,
 		const struct video_scale_info *dst,
 		const struct video_scale_info *src,
 		enum video_scale_type type);
+
+/**
+ * Creates a scaler that splits each frame into horizontal slices and
+ * converts them in parallel.  Use a thread count of 0 to pick one
+ * automatically based on the frame size, or 1 to disable threading.
+ */
+EXPORT int video_scaler_create2(video_scaler_t **scaler,
+		const struct video_scale_info *dst,
+		const struct video_scale_info *src,
+		enum video_scale_type type, int threads);
 EXPORT void video_scaler_destroy(video_scaler_t *scaler);
 
 EXPORT bool video_scaler_scale(video_scaler_t *scaler,
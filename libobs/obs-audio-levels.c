@@ -0,0 +1,405 @@
+/******************************************************************************
+    Copyright (C) 2014 by Leonhard Oelke <leonhard@in-verted.de>
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+
+#include "util/threading.h"
+#include "util/platform.h"
+#include "obs.h"
+#include "obs-internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define AUDIO_LEVELS_SSE
+#include <xmmintrin.h>
+#endif
+
+/*
+ *   Audio levels are measured once per source, as the audio comes in, no
+ * matter how many meters are showing the source.  Measuring only starts once
+ * something has enabled levels for the source or subscribed to them.
+ *
+ *   The latest levels are published with a sequence counter: the writer
+ * makes the counter odd while it updates the levels and even again after, and
+ * readers retry if the counter changed (or was odd) while they were copying.
+ * Writers are serialized by audio_levels_mutex, readers never lock.
+ */
+
+/* The true peak is measured with 5x oversampling using Whittaker–Shannon
+ * interpolation over four samples.  The four samples are located at
+ * t=-1.5, -0.5, +0.5, +1.5, the oversamples at t=-0.3, -0.1, +0.1, +0.3.
+ * These are the normalized-sinc weights of the four samples for each
+ * oversample, oldest sample first. */
+static const float sinc_weights[4][4] = {
+	{-0.103943f, 0.233872f, 0.935489f, -0.155915f},
+	{-0.189207f, 0.504551f, 0.756827f, -0.216236f},
+	{-0.216236f, 0.756827f, 0.504551f, -0.189207f},
+	{-0.155915f, 0.935489f, 0.233872f, -0.103943f},
+};
+
+struct channel_levels {
+	float peak;
+	float true_peak;
+	float sum_sq;
+};
+
+/* ------------------------------------------------------------------------- */
+/* measurement */
+
+static inline float interpolated_peak(const float window[4])
+{
+	float peak = 0.0f;
+
+	for (size_t i = 0; i < 4; i++) {
+		float val = window[0] * sinc_weights[i][0] +
+		            window[1] * sinc_weights[i][1] +
+		            window[2] * sinc_weights[i][2] +
+		            window[3] * sinc_weights[i][3];
+		peak = fmaxf(peak, fabsf(val));
+	}
+
+	return peak;
+}
+
+/* window holds the last four samples, oldest first */
+static void measure_c(const float *samples, size_t start, size_t count,
+		float window[4], struct channel_levels *levels)
+{
+	for (size_t i = start; i < count; i++) {
+		float sample = samples[i];
+		float abs_sample = fabsf(sample);
+
+		window[0] = window[1];
+		window[1] = window[2];
+		window[2] = window[3];
+		window[3] = sample;
+
+		levels->peak = fmaxf(levels->peak, abs_sample);
+		levels->true_peak = fmaxf(levels->true_peak, abs_sample);
+		levels->true_peak = fmaxf(levels->true_peak,
+				interpolated_peak(window));
+		levels->sum_sq += sample * sample;
+	}
+}
+
+#ifdef AUDIO_LEVELS_SSE
+
+/* msb(h, g, f, e) lsb(d, c, b, a)   -->  msb(h, h, g, f) lsb(e, d, c, b)
+ */
+#define SHIFT_RIGHT_2PS(msb, lsb) {\
+	__m128 tmp = _mm_shuffle_ps(lsb, msb, _MM_SHUFFLE(0, 0, 3, 3));\
+	lsb = _mm_shuffle_ps(lsb, tmp, _MM_SHUFFLE(2, 1, 2, 1));\
+	msb = _mm_shuffle_ps(msb, msb, _MM_SHUFFLE(3, 3, 2, 1));\
+}
+
+/* x(d, c, b, a) --> (|d|, |c|, |b|, |a|)
+ */
+#define abs_ps(v) \
+	_mm_andnot_ps(_mm_set1_ps(-0.f), v)
+
+/* Take cross product of a vector with a matrix resulting in vector.
+ */
+#define VECTOR_MATRIX_CROSS_PS(out, v, m0, m1, m2, m3) \
+{\
+	out = _mm_mul_ps(v, m0);\
+	__m128 mul1 = _mm_mul_ps(v, m1);\
+	__m128 mul2 = _mm_mul_ps(v, m2);\
+	__m128 mul3 = _mm_mul_ps(v, m3);\
+\
+	_MM_TRANSPOSE4_PS(out, mul1, mul2, mul3);\
+\
+	out = _mm_add_ps(out, mul1);\
+	out = _mm_add_ps(out, mul2);\
+	out = _mm_add_ps(out, mul3);\
+}
+
+static inline float hmax_ps(__m128 x4)
+{
+	float x4_mem[4];
+	_mm_storeu_ps(x4_mem, x4);
+	return fmaxf(fmaxf(x4_mem[0], x4_mem[1]), fmaxf(x4_mem[2], x4_mem[3]));
+}
+
+static inline float hadd_ps(__m128 x4)
+{
+	float x4_mem[4];
+	_mm_storeu_ps(x4_mem, x4);
+	return (x4_mem[0] + x4_mem[1]) + (x4_mem[2] + x4_mem[3]);
+}
+
+/* sample peak, true peak and sum of squares in a single pass, four samples
+ * at a time */
+static void measure_channel(const float *samples, size_t count,
+		float window[4], struct channel_levels *levels)
+{
+	const __m128 m3 = _mm_loadu_ps(sinc_weights[0]);
+	const __m128 m1 = _mm_loadu_ps(sinc_weights[1]);
+	const __m128 p1 = _mm_loadu_ps(sinc_weights[2]);
+	const __m128 p3 = _mm_loadu_ps(sinc_weights[3]);
+
+	__m128 work      = _mm_loadu_ps(window);
+	__m128 peak      = _mm_setzero_ps();
+	__m128 true_peak = _mm_setzero_ps();
+	__m128 sum_sq    = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 new_work = _mm_loadu_ps(samples + i);
+		__m128 intrp_samples;
+
+		peak = _mm_max_ps(peak, abs_ps(new_work));
+		sum_sq = _mm_add_ps(sum_sq, _mm_mul_ps(new_work, new_work));
+
+		/* shift in the new samples one by one */
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		true_peak = _mm_max_ps(true_peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		true_peak = _mm_max_ps(true_peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		true_peak = _mm_max_ps(true_peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		true_peak = _mm_max_ps(true_peak, abs_ps(intrp_samples));
+	}
+
+	_mm_storeu_ps(window, work);
+
+	levels->peak      = hmax_ps(peak);
+	levels->true_peak = fmaxf(levels->peak, hmax_ps(true_peak));
+	levels->sum_sq    = hadd_ps(sum_sq);
+
+	measure_c(samples, i, count, window, levels);
+}
+
+#else
+
+static void measure_channel(const float *samples, size_t count,
+		float window[4], struct channel_levels *levels)
+{
+	measure_c(samples, 0, count, window, levels);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* publishing */
+
+static void publish_levels(obs_source_t *source,
+		const struct obs_audio_levels *levels)
+{
+	os_atomic_inc_long(&source->audio_levels_seq);
+	source->audio_levels = *levels;
+	os_atomic_inc_long(&source->audio_levels_seq);
+}
+
+static inline void reset_accumulated_levels(struct audio_levels_cb *cb,
+		uint64_t ts)
+{
+	memset(&cb->levels, 0, sizeof(cb->levels));
+	memset(cb->sum_sq, 0, sizeof(cb->sum_sq));
+	cb->start_ts = ts;
+}
+
+/* subscribers get the highest peaks and the RMS of everything measured
+ * during their interval */
+static void accumulate_levels(struct audio_levels_cb *cb,
+		const struct obs_audio_levels *levels)
+{
+	struct obs_audio_levels *acc = &cb->levels;
+
+	for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++) {
+		float mag = levels->magnitude[ch];
+
+		acc->peak[ch] = fmaxf(acc->peak[ch], levels->peak[ch]);
+		acc->true_peak[ch] = fmaxf(acc->true_peak[ch],
+				levels->true_peak[ch]);
+		cb->sum_sq[ch] += (double)mag * (double)mag *
+			(double)levels->frames;
+	}
+
+	acc->frames   += levels->frames;
+	acc->channels  = levels->channels;
+	acc->muted     = levels->muted;
+	acc->timestamp = levels->timestamp;
+}
+
+static void signal_levels(obs_source_t *source,
+		const struct obs_audio_levels *levels)
+{
+	for (size_t i = source->audio_levels_cbs.num; i > 0; i--) {
+		struct audio_levels_cb *cb = source->audio_levels_cbs.array +
+			(i - 1);
+		struct obs_audio_levels out;
+
+		if (!cb->start_ts)
+			reset_accumulated_levels(cb, levels->timestamp);
+
+		accumulate_levels(cb, levels);
+
+		if (levels->timestamp - cb->start_ts < cb->interval_ns)
+			continue;
+
+		out = cb->levels;
+		for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+			out.magnitude[ch] = out.frames ?
+				(float)sqrt(cb->sum_sq[ch] /
+						(double)out.frames) : 0.0f;
+
+		reset_accumulated_levels(cb, levels->timestamp);
+		cb->callback(cb->param, source, &out);
+	}
+}
+
+void obs_source_measure_audio_levels(obs_source_t *source,
+		const struct audio_data *data, bool muted)
+{
+	struct obs_audio_levels levels = {0};
+	uint32_t channels = 0;
+
+	if (!os_atomic_load_long(&source->audio_levels_refs))
+		return;
+
+	pthread_mutex_lock(&source->audio_levels_mutex);
+
+	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
+		const float *samples = (const float*)data->data[plane];
+		struct channel_levels ch_levels = {0};
+
+		if (!samples)
+			continue;
+		if (channels == MAX_AUDIO_CHANNELS)
+			break;
+
+		measure_channel(samples, data->frames,
+				source->audio_levels_window[channels],
+				&ch_levels);
+
+		levels.peak[channels]      = ch_levels.peak;
+		levels.true_peak[channels] = ch_levels.true_peak;
+		levels.magnitude[channels] = data->frames ?
+			sqrtf(ch_levels.sum_sq / (float)data->frames) : 0.0f;
+		channels++;
+	}
+
+	levels.timestamp = os_gettime_ns();
+	levels.frames    = data->frames;
+	levels.channels  = channels;
+	levels.muted     = muted;
+
+	publish_levels(source, &levels);
+	signal_levels(source, &levels);
+
+	pthread_mutex_unlock(&source->audio_levels_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* public functions */
+
+void obs_source_enable_audio_levels(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_enable_audio_levels"))
+		return;
+
+	os_atomic_inc_long(&source->audio_levels_refs);
+}
+
+void obs_source_disable_audio_levels(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_disable_audio_levels"))
+		return;
+
+	os_atomic_dec_long(&source->audio_levels_refs);
+}
+
+bool obs_source_get_audio_levels(const obs_source_t *source,
+		struct obs_audio_levels *levels)
+{
+	obs_source_t *s = (obs_source_t*)source;
+	long seq;
+
+	if (!obs_source_valid(source, "obs_source_get_audio_levels"))
+		return false;
+	if (!obs_ptr_valid(levels, "levels"))
+		return false;
+
+	/* the compare-and-swap doesn't change anything, it checks that the
+	 * levels weren't written during the copy and is a full barrier that
+	 * keeps the copy in front of that check */
+	do {
+		seq = os_atomic_load_long(&s->audio_levels_seq);
+		*levels = s->audio_levels;
+	} while ((seq & 1) != 0 ||
+	         !os_atomic_compare_swap_long(&s->audio_levels_seq, seq, seq));
+
+	return levels->timestamp != 0;
+}
+
+void obs_source_add_audio_levels_callback(obs_source_t *source,
+		uint32_t interval_ms, obs_source_audio_levels_t callback,
+		void *param)
+{
+	struct audio_levels_cb cb = {0};
+
+	if (!obs_source_valid(source, "obs_source_add_audio_levels_callback"))
+		return;
+	if (!obs_ptr_valid(callback, "callback"))
+		return;
+
+	cb.callback    = callback;
+	cb.param       = param;
+	cb.interval_ns = (uint64_t)interval_ms * 1000000ULL;
+
+	pthread_mutex_lock(&source->audio_levels_mutex);
+	da_push_back(source->audio_levels_cbs, &cb);
+	pthread_mutex_unlock(&source->audio_levels_mutex);
+
+	os_atomic_inc_long(&source->audio_levels_refs);
+}
+
+void obs_source_remove_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param)
+{
+	bool found = false;
+
+	if (!obs_source_valid(source,
+				"obs_source_remove_audio_levels_callback"))
+		return;
+
+	pthread_mutex_lock(&source->audio_levels_mutex);
+
+	for (size_t i = 0; i < source->audio_levels_cbs.num; i++) {
+		struct audio_levels_cb *cb = source->audio_levels_cbs.array + i;
+
+		if (cb->callback == callback && cb->param == param) {
+			da_erase(source->audio_levels_cbs, i);
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->audio_levels_mutex);
+
+	if (found)
+		os_atomic_dec_long(&source->audio_levels_refs);
+}
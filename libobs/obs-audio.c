@@ -17,25 +17,393 @@
 
 #include <inttypes.h>
 #include "obs-internal.h"
+#include "media-io/audio-math.h"
 
 struct ts_info {
 	uint64_t start;
 	uint64_t end;
 };
 
+#define NBSP "\xC2\xA0"
+
 #define DEBUG_AUDIO 0
 #define MAX_BUFFERING_TICKS 45
 
+/* below this many sources in a render level it's cheaper to just render on
+ * the audio thread than to wake up the render threads */
+#define MIN_PARALLEL_RENDER_SOURCES 2
+
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
+	size_t idx = da_find(audio->render_order, &source, 0);
 
-	if (da_find(audio->render_order, &source, 0) == DARRAY_INVALID) {
+	if (idx == DARRAY_INVALID) {
 		obs_source_t *s = obs_source_get_ref(source);
-		if (s) da_push_back(audio->render_order, &s);
+		if (!s)
+			return;
+
+		idx = audio->render_order.num;
+		da_push_back(audio->render_order, &s);
+	}
+
+	/* the tree is enumerated children first, so the parent always ends
+	 * up after its children in the render order.  the edge is kept so
+	 * that sources that don't depend on each other can be rendered at
+	 * the same time */
+	if (parent) {
+		struct audio_render_edge edge = {parent, idx};
+		da_push_back(audio->render_edges, &edge);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* parallel source rendering                                                 */
+
+/* libobs renders the audio of sources without an audio_render callback
+ * itself, which only touches that source's own buffers.  sources with one
+ * are rendered on the audio thread, one at a time, unless they opted in to
+ * parallel rendering */
+static inline bool source_render_serial(const struct obs_source *source)
+{
+	return source->info.audio_render &&
+	       (source->info.output_flags &
+		OBS_SOURCE_PARALLEL_AUDIO_RENDER) == 0;
+}
+
+static void render_level_sources(struct obs_core_audio *audio)
+{
+	for (;;) {
+		size_t idx = (size_t)(os_atomic_inc_long(&audio->render_next) - 1);
+		if (idx >= audio->render_level.num)
+			break;
+
+		obs_source_audio_render(audio->render_level.array[idx],
+				audio->render_mixers, audio->render_channels,
+				audio->render_sample_rate, audio->render_size);
+	}
+}
+
+static void *audio_render_thread(void *param)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	const char *render_thread_name = param;
+
+	os_set_thread_name("libobs: audio render thread");
+
+	while (os_sem_wait(audio->render_start_sem) == 0) {
+		if (audio->render_stop)
+			break;
+
+		profile_start(render_thread_name);
+		render_level_sources(audio);
+		profile_end(render_thread_name);
+
+		profile_reenable_thread();
+
+		os_sem_post(audio->render_done_sem);
+	}
+
+	return NULL;
+}
+
+static void stop_audio_render_threads(struct obs_core_audio *audio)
+{
+	audio->render_stop = true;
+
+	for (size_t i = 0; i < audio->num_render_threads; i++)
+		os_sem_post(audio->render_start_sem);
+	for (size_t i = 0; i < audio->num_render_threads; i++)
+		pthread_join(audio->render_threads[i], NULL);
+
+	os_sem_destroy(audio->render_start_sem);
+	os_sem_destroy(audio->render_done_sem);
+	audio->render_start_sem = NULL;
+	audio->render_done_sem = NULL;
+	audio->num_render_threads = 0;
+}
+
+/* the workers are only started once a render level has enough sources that
+ * can be rendered in parallel, most setups never need them */
+static void init_audio_render_threads(struct obs_core_audio *audio,
+		size_t sample_rate)
+{
+	size_t num_threads = (size_t)os_get_logical_cores() / 4;
+	uint64_t tick_time;
+
+	if (num_threads > MAX_AUDIO_RENDER_THREADS)
+		num_threads = MAX_AUDIO_RENDER_THREADS;
+
+	audio->render_threads_started = true;
+	audio->render_stop = false;
+	audio->num_render_threads = 0;
+
+	if (!num_threads || !sample_rate)
+		return;
+	if (os_sem_init(&audio->render_start_sem, 0) != 0)
+		goto fail;
+	if (os_sem_init(&audio->render_done_sem, 0) != 0)
+		goto fail;
+
+	tick_time = AUDIO_OUTPUT_FRAMES * 1000000000ULL / sample_rate;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		const char *name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"render_audio(worker" NBSP "%d)", (int)i);
+
+		profile_register_root(name, tick_time);
+
+		if (pthread_create(&audio->render_threads[i], NULL,
+					audio_render_thread, (void*)name) != 0)
+			goto fail;
+
+		audio->num_render_threads++;
+	}
+
+	return;
+
+fail:
+	blog(LOG_WARNING, "init_audio_render_threads: Failed to start audio "
+			"render threads, rendering all sources on the audio "
+			"thread");
+	stop_audio_render_threads(audio);
+}
+
+void obs_free_audio_render_threads(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	stop_audio_render_threads(audio);
+	audio->render_threads_started = false;
+
+	da_free(audio->render_edges);
+	da_free(audio->render_levels);
+	da_free(audio->render_level);
+}
+
+/* a source's level is one more than the highest level of its children, so
+ * sources on the same level never depend on each other */
+static size_t calc_render_levels(struct obs_core_audio *audio)
+{
+	size_t *levels;
+	size_t max_level = 0;
+	bool changed = true;
+
+	da_resize(audio->render_levels, audio->render_order.num);
+	levels = audio->render_levels.array;
+	memset(levels, 0, audio->render_order.num * sizeof(size_t));
+
+	/* edges are recorded children first, so one pass is normally enough.
+	 * more are only needed if the tree changed during enumeration */
+	for (size_t pass = 0; changed && pass < audio->render_order.num;
+			pass++) {
+		changed = false;
+
+		for (size_t i = 0; i < audio->render_edges.num; i++) {
+			struct audio_render_edge *edge =
+				audio->render_edges.array + i;
+			size_t parent_idx = da_find(audio->render_order,
+					&edge->parent, 0);
+			size_t level = levels[edge->child_idx] + 1;
+
+			if (parent_idx == DARRAY_INVALID)
+				continue;
+
+			if (levels[parent_idx] < level) {
+				levels[parent_idx] = level;
+				changed = true;
+
+				if (max_level < level)
+					max_level = level;
+			}
+		}
+	}
+
+	return max_level;
+}
+
+/* ------------------------------------------------------------------------- */
+/* cached render graph
+ *
+ *   Enumerating the active tree of every output channel and walking the
+ * audio source list each tick is wasted work when nothing changed, so the
+ * result is kept as a flat array of weak references.  Changes to output
+ * channels, active children and the audio source list mark it dirty.  It's
+ * also rebuilt once a second regardless, for sources with children that
+ * don't report their changes. */
+
+void obs_invalidate_audio_graph(void)
+{
+	if (obs)
+		os_atomic_set_bool(&obs->audio.graph_dirty, true);
+}
+
+static void clear_audio_graph(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->graph.num; i++)
+		obs_weak_source_release(audio->graph.array[i]);
+
+	da_resize(audio->graph, 0);
+	da_resize(audio->graph_roots, 0);
+	da_resize(audio->graph_audio_sources, 0);
+}
+
+void obs_free_audio_graph(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	clear_audio_graph(audio);
+	da_free(audio->graph);
+	da_free(audio->graph_roots);
+	da_free(audio->graph_audio_sources);
+}
+
+static void rebuild_audio_graph(struct obs_core_audio *audio)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source *source;
+
+	clear_audio_graph(audio);
+	da_resize(audio->render_edges, 0);
+
+	/* NOTE: these are source channels, not audio channels */
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
+		obs_source_t *source = obs_get_output_source(i);
+		if (source) {
+			size_t idx;
+
+			obs_source_enum_active_tree(source, push_audio_tree,
+					audio);
+			push_audio_tree(NULL, source, audio);
+
+			idx = da_find(audio->render_order, &source, 0);
+			if (idx != DARRAY_INVALID)
+				da_push_back(audio->graph_roots, &idx);
+
+			obs_source_release(source);
+		}
+	}
+
+	pthread_mutex_lock(&data->audio_sources_mutex);
+
+	source = data->first_audio_source;
+	while (source) {
+		size_t idx;
+
+		push_audio_tree(NULL, source, audio);
+
+		idx = da_find(audio->render_order, &source, 0);
+		if (idx != DARRAY_INVALID)
+			da_push_back(audio->graph_audio_sources, &idx);
+
+		source = (struct obs_source*)source->next_audio_source;
+	}
+
+	pthread_mutex_unlock(&data->audio_sources_mutex);
+
+	audio->graph_max_level = calc_render_levels(audio);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_weak_source_t *weak = obs_source_get_weak_source(
+				audio->render_order.array[i]);
+		da_push_back(audio->graph, &weak);
+	}
+
+	audio->graph_age = 0;
+}
+
+static void update_audio_graph(struct obs_core_audio *audio,
+		size_t sample_rate)
+{
+	size_t max_age = sample_rate / AUDIO_OUTPUT_FRAMES;
+	bool dirty = os_atomic_set_bool(&audio->graph_dirty, false);
+
+	da_resize(audio->render_order, 0);
+	da_resize(audio->root_nodes, 0);
+
+	if (dirty || ++audio->graph_age >= max_age) {
+		rebuild_audio_graph(audio);
+
+	} else {
+		for (size_t i = 0; i < audio->graph.num; i++) {
+			obs_source_t *source = obs_weak_source_get_source(
+					audio->graph.array[i]);
+
+			/* destroyed since the last rebuild, so skip it for
+			 * now and rebuild next tick */
+			if (!source)
+				os_atomic_set_bool(&audio->graph_dirty, true);
+
+			da_push_back(audio->render_order, &source);
+		}
+	}
+
+	for (size_t i = 0; i < audio->graph_roots.num; i++) {
+		size_t idx = audio->graph_roots.array[i];
+		obs_source_t *source = audio->render_order.array[idx];
+
+		if (source)
+			da_push_back(audio->root_nodes, &source);
 	}
+}
+
+static const char *render_audio_sources_name = "render_audio_sources";
+
+static void render_audio_sources(struct obs_core_audio *audio,
+		uint32_t mixers, size_t channels, size_t sample_rate,
+		size_t size)
+{
+	profile_start(render_audio_sources_name);
+
+	audio->render_mixers = mixers;
+	audio->render_channels = channels;
+	audio->render_sample_rate = sample_rate;
+	audio->render_size = size;
+
+	/* each source only writes its own output, and only reads the output
+	 * of sources on lower levels, so the mix is the same no matter which
+	 * thread renders what */
+	for (size_t level = 0; level <= audio->graph_max_level; level++) {
+		size_t num_threads = 0;
 
-	UNUSED_PARAMETER(parent);
+		da_resize(audio->render_level, 0);
+
+		for (size_t i = 0; i < audio->render_order.num; i++) {
+			obs_source_t *source = audio->render_order.array[i];
+
+			if (!source || audio->render_levels.array[i] != level)
+				continue;
+
+			/* nothing else renders yet, so these can go first */
+			if (source_render_serial(source))
+				obs_source_audio_render(source, mixers,
+						channels, sample_rate, size);
+			else
+				da_push_back(audio->render_level, &source);
+		}
+
+		if (audio->render_level.num >= MIN_PARALLEL_RENDER_SOURCES) {
+			if (!audio->render_threads_started)
+				init_audio_render_threads(audio, sample_rate);
+
+			num_threads = audio->render_level.num - 1;
+			if (num_threads > audio->num_render_threads)
+				num_threads = audio->num_render_threads;
+		}
+
+		audio->render_next = 0;
+
+		for (size_t i = 0; i < num_threads; i++)
+			os_sem_post(audio->render_start_sem);
+
+		render_level_sources(audio);
+
+		for (size_t i = 0; i < num_threads; i++)
+			os_sem_wait(audio->render_done_sem);
+	}
+
+	profile_end(render_audio_sources_name);
 }
 
 static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
@@ -44,8 +412,8 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 }
 
 static inline void mix_audio(struct audio_output_data *mixes,
-		obs_source_t *source, size_t channels, size_t sample_rate,
-		struct ts_info *ts)
+		obs_source_t *source, uint32_t mixers, size_t channels,
+		size_t sample_rate, struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
@@ -62,18 +430,19 @@ static inline void mix_audio(struct audio_output_data *mixes,
 		total_floats -= start_point;
 	}
 
+	/* mixes the source isn't assigned to were silenced when it was
+	 * rendered, so there's nothing to add for them */
+	mixers &= source->audio_mixers;
+
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *mix = mixes[mix_idx].data[ch];
+			float *aud = source->audio_output_buf[mix_idx][ch];
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+			audio_mix(mix + start_point, aud, total_floats);
 		}
 	}
 }
@@ -226,6 +595,109 @@ static inline void discard_audio(struct obs_core_audio *audio,
 	source->audio_ts = ts->end;
 }
 
+/* ------------------------------------------------------------------------- */
+/* adaptive buffering
+ *
+ *   Buffering is added whenever a source falls behind, but a single hiccup
+ * shouldn't add latency for the rest of the session.  Each tick, the
+ * smallest amount of audio any source has buffered ahead of the mix (its
+ * lead) is recorded.  Leads are kept per one second bucket over a sliding
+ * window of BUFFERING_WINDOW_BUCKETS seconds.  If every source stayed far
+ * enough ahead for the whole window, one tick of buffering is removed per
+ * second by having the audio thread output one extra tick right away.  The
+ * output timeline stays continuous and no audio is dropped; it's just
+ * output earlier. */
+
+/* lead that must remain after removing a tick, on top of the tick that's
+ * about to be mixed */
+#define BUFFERING_SAFETY_TICKS 1
+
+static inline void reset_buffering_window(struct obs_core_audio *audio)
+{
+	audio->num_lead_buckets = 0;
+	audio->lead_bucket_idx = 0;
+	audio->cur_bucket_ticks = 0;
+	audio->target_buffering_ticks = audio->total_buffering_ticks;
+}
+
+static inline uint64_t get_source_lead(obs_source_t *source,
+		size_t sample_rate, const struct ts_info *ts)
+{
+	size_t frames = source->audio_input_buf[0].size / sizeof(float);
+	uint64_t end = source->audio_ts +
+		audio_frames_to_ns(sample_rate, frames);
+
+	return end > ts->end ? end - ts->end : 0;
+}
+
+static bool update_buffering(struct obs_core_audio *audio,
+		size_t sample_rate, uint64_t lead)
+{
+	size_t bucket_ticks = sample_rate / AUDIO_OUTPUT_FRAMES;
+	uint64_t tick_ns = audio_frames_to_ns(sample_rate, AUDIO_OUTPUT_FRAMES);
+	uint64_t min_lead = UINT64_MAX;
+	uint64_t lead_ticks;
+	int removable;
+
+	if (!audio->cur_bucket_ticks || lead < audio->cur_bucket_lead)
+		audio->cur_bucket_lead = lead;
+	if (++audio->cur_bucket_ticks < bucket_ticks)
+		return false;
+
+	audio->lead_buckets[audio->lead_bucket_idx] = audio->cur_bucket_lead;
+	audio->lead_bucket_idx = (audio->lead_bucket_idx + 1) %
+		BUFFERING_WINDOW_BUCKETS;
+	if (audio->num_lead_buckets < BUFFERING_WINDOW_BUCKETS)
+		audio->num_lead_buckets++;
+	audio->cur_bucket_ticks = 0;
+
+	for (size_t i = 0; i < audio->num_lead_buckets; i++) {
+		if (audio->lead_buckets[i] < min_lead)
+			min_lead = audio->lead_buckets[i];
+	}
+
+	lead_ticks = min_lead / tick_ns;
+	if (lead_ticks > (uint64_t)audio->total_buffering_ticks +
+			BUFFERING_SAFETY_TICKS + 1)
+		lead_ticks = (uint64_t)audio->total_buffering_ticks +
+			BUFFERING_SAFETY_TICKS + 1;
+
+	removable = (int)lead_ticks - BUFFERING_SAFETY_TICKS - 1;
+	if (removable < 0)
+		removable = 0;
+
+	audio->target_buffering_ticks =
+		audio->total_buffering_ticks - removable;
+
+	if (!removable || audio->num_lead_buckets < BUFFERING_WINDOW_BUCKETS)
+		return false;
+
+	/* every recorded lead is a tick shorter once the tick is removed */
+	for (size_t i = 0; i < audio->num_lead_buckets; i++) {
+		if (audio->lead_buckets[i] != UINT64_MAX)
+			audio->lead_buckets[i] -= tick_ns;
+	}
+
+	return true;
+}
+
+static void remove_audio_buffering(struct obs_core_audio *audio,
+		size_t sample_rate)
+{
+	size_t total_ms;
+	size_t ms;
+
+	audio->total_buffering_ticks--;
+
+	ms = AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
+		sample_rate;
+
+	blog(LOG_INFO, "removing %d milliseconds of audio buffering, total "
+			"audio buffering is now %d milliseconds",
+			(int)ms, (int)total_ms);
+}
+
 static void add_audio_buffering(struct obs_core_audio *audio,
 		size_t sample_rate, struct ts_info *ts, uint64_t min_ts,
 		const char *buffering_name)
@@ -255,6 +727,10 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
+	/* sources have to stay ahead for a whole new window before any of
+	 * this can be removed again */
+	reset_buffering_window(audio);
+
 	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
 		sample_rate;
@@ -324,44 +800,51 @@ static bool audio_buffer_insuffient(struct obs_source *source,
 	return false;
 }
 
-static inline const char *find_min_ts(struct obs_core_data *data,
+static inline obs_source_t *get_audio_source(struct obs_core_audio *audio,
+		size_t i)
+{
+	return audio->render_order.array[audio->graph_audio_sources.array[i]];
+}
+
+static inline const char *find_min_ts(struct obs_core_audio *audio,
 		uint64_t *min_ts)
 {
 	obs_source_t *buffering_source = NULL;
-	struct obs_source *source = data->first_audio_source;
-	while (source) {
-		if (!source->audio_pending && source->audio_ts &&
+
+	for (size_t i = 0; i < audio->graph_audio_sources.num; i++) {
+		obs_source_t *source = get_audio_source(audio, i);
+
+		if (source && !source->audio_pending && source->audio_ts &&
 				source->audio_ts < *min_ts) {
 			*min_ts = source->audio_ts;
 			buffering_source = source;
 		}
-
-		source = (struct obs_source*)source->next_audio_source;
 	}
 	return buffering_source ? obs_source_get_name(buffering_source) : NULL;
 }
 
-static inline bool mark_invalid_sources(struct obs_core_data *data,
+static inline bool mark_invalid_sources(struct obs_core_audio *audio,
 		size_t sample_rate, uint64_t min_ts)
 {
 	bool recalculate = false;
 
-	struct obs_source *source = data->first_audio_source;
-	while (source) {
-		recalculate |= audio_buffer_insuffient(source, sample_rate,
-				min_ts);
-		source = (struct obs_source*)source->next_audio_source;
+	for (size_t i = 0; i < audio->graph_audio_sources.num; i++) {
+		obs_source_t *source = get_audio_source(audio, i);
+
+		if (source)
+			recalculate |= audio_buffer_insuffient(source,
+					sample_rate, min_ts);
 	}
 
 	return recalculate;
 }
 
-static inline const char *calc_min_ts(struct obs_core_data *data,
+static inline const char *calc_min_ts(struct obs_core_audio *audio,
 		size_t sample_rate, uint64_t *min_ts)
 {
-	const char *buffering_name = find_min_ts(data, min_ts);
-	if (mark_invalid_sources(data, sample_rate, *min_ts))
-		buffering_name = find_min_ts(data, min_ts);
+	const char *buffering_name = find_min_ts(audio, min_ts);
+	if (mark_invalid_sources(audio, sample_rate, *min_ts))
+		buffering_name = find_min_ts(audio, min_ts);
 	return buffering_name;
 }
 
@@ -375,19 +858,24 @@ bool audio_callback(void *param,
 		uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts,
 		uint32_t mixers, struct audio_output_data *mixes)
 {
-	struct obs_core_data *data = &obs->data;
 	struct obs_core_audio *audio = &obs->audio;
-	struct obs_source *source;
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
 	size_t audio_size;
 	uint64_t min_ts;
+	uint64_t min_lead = UINT64_MAX;
 
-	da_resize(audio->render_order, 0);
-	da_resize(audio->root_nodes, 0);
+	/* an extra tick (see audio_output_request_extra_tick) outputs the
+	 * next buffered tick early, which removes a tick of buffering */
+	bool extra_tick = start_ts_in == end_ts_in;
 
-	circlebuf_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	if (extra_tick && !audio->buffered_timestamps.size)
+		return false;
+
+	if (!extra_tick)
+		circlebuf_push_back(&audio->buffered_timestamps, &ts,
+				sizeof(ts));
 	circlebuf_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -398,42 +886,16 @@ bool audio_callback(void *param,
 #endif
 
 	/* ------------------------------------------------ */
-	/* build audio render order
-	 * NOTE: these are source channels, not audio channels */
-	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
-		obs_source_t *source = obs_get_output_source(i);
-		if (source) {
-			obs_source_enum_active_tree(source, push_audio_tree,
-					audio);
-			push_audio_tree(NULL, source, audio);
-			da_push_back(audio->root_nodes, &source);
-			obs_source_release(source);
-		}
-	}
-
-	pthread_mutex_lock(&data->audio_sources_mutex);
-
-	source = data->first_audio_source;
-	while (source) {
-		push_audio_tree(NULL, source, audio);
-		source = (struct obs_source*)source->next_audio_source;
-	}
-
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	/* get audio render order */
+	update_audio_graph(audio, sample_rate);
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-				audio_size);
-	}
+	render_audio_sources(audio, mixers, channels, sample_rate, audio_size);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
-	pthread_mutex_lock(&data->audio_sources_mutex);
-	const char *buffering_name = calc_min_ts(data, sample_rate, &min_ts);
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	const char *buffering_name = calc_min_ts(audio, sample_rate, &min_ts);
 
 	/* ------------------------------------------------ */
 	/* if a source has gone backward in time, buffer */
@@ -450,31 +912,29 @@ bool audio_callback(void *param,
 			if (source->audio_pending)
 				continue;
 
-			pthread_mutex_lock(&source->audio_buf_mutex);
-
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-						&ts);
-
-			pthread_mutex_unlock(&source->audio_buf_mutex);
+				mix_audio(mixes, source, mixers, channels,
+						sample_rate, &ts);
 		}
 	}
 
 	/* ------------------------------------------------ */
 	/* discard audio */
-	pthread_mutex_lock(&data->audio_sources_mutex);
+	for (size_t i = 0; i < audio->graph_audio_sources.num; i++) {
+		obs_source_t *source = get_audio_source(audio, i);
+		if (!source)
+			continue;
 
-	source = data->first_audio_source;
-	while (source) {
-		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
-		pthread_mutex_unlock(&source->audio_buf_mutex);
 
-		source = (struct obs_source*)source->next_audio_source;
+		if (!source->info.audio_render && source->audio_ts) {
+			uint64_t lead = get_source_lead(source, sample_rate,
+					&ts);
+			if (lead < min_lead)
+				min_lead = lead;
+		}
 	}
 
-	pthread_mutex_unlock(&data->audio_sources_mutex);
-
 	/* ------------------------------------------------ */
 	/* release audio sources */
 	release_audio_sources(audio);
@@ -488,6 +948,38 @@ bool audio_callback(void *param,
 		return false;
 	}
 
+	/* ------------------------------------------------ */
+	/* shrink buffering if sources have stayed ahead */
+	if (extra_tick)
+		remove_audio_buffering(audio, sample_rate);
+	else if (audio->total_buffering_ticks &&
+	         update_buffering(audio, sample_rate, min_lead))
+		audio_output_request_extra_tick(audio->audio);
+
 	UNUSED_PARAMETER(param);
 	return true;
 }
+
+uint64_t obs_get_audio_buffering_ns(void)
+{
+	size_t sample_rate;
+
+	if (!obs || !obs->audio.audio)
+		return 0;
+
+	sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	return audio_frames_to_ns(sample_rate, (uint64_t)
+			obs->audio.total_buffering_ticks * AUDIO_OUTPUT_FRAMES);
+}
+
+uint64_t obs_get_target_audio_buffering_ns(void)
+{
+	size_t sample_rate;
+
+	if (!obs || !obs->audio.audio)
+		return 0;
+
+	sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	return audio_frames_to_ns(sample_rate, (uint64_t)
+			obs->audio.target_buffering_ticks * AUDIO_OUTPUT_FRAMES);
+}
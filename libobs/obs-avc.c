@@ -17,6 +17,7 @@
 
 #include "obs.h"
 #include "obs-avc.h"
+#include "obs-internal.h"
 #include "util/array-serializer.h"
 
 bool obs_avc_keyframe(const uint8_t *data, size_t size)
@@ -127,22 +128,46 @@ static void serialize_avc_data(struct serializer *s, const uint8_t *data,
 	}
 }
 
+struct packet_output {
+	uint8_t *data;
+	size_t  size;
+	size_t  capacity;
+};
+
+static size_t packet_output_write(void *param, const void *data, size_t size)
+{
+	struct packet_output *out = param;
+
+	if (size > out->capacity - out->size)
+		size = out->capacity - out->size;
+
+	memcpy(out->data + out->size, data, size);
+	out->size += size;
+	return size;
+}
+
 void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 		const struct encoder_packet *src)
 {
-	struct array_output_data output;
-	struct serializer s;
-	long ref = 1;
+	struct packet_output output;
+	struct serializer s = {0};
+
+	/* each start code of three or more bytes becomes a four byte size, so
+	 * the output can only grow by a byte per three bytes of input */
+	output.capacity = src->size + src->size / 3 + 4;
+	output.data     = obs_encoder_packet_alloc(output.capacity);
+	output.size     = 0;
+
+	s.data  = &output;
+	s.write = packet_output_write;
 
-	array_output_serializer_init(&s, &output);
 	*avc_packet = *src;
 
-	serialize(&s, &ref, sizeof(ref));
 	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
 			&avc_packet->priority);
 
-	avc_packet->data          = output.bytes.array + sizeof(ref);
-	avc_packet->size          = output.bytes.num - sizeof(ref);
+	avc_packet->data          = output.data;
+	avc_packet->size          = output.size;
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
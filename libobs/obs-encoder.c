@@ -23,6 +23,19 @@
 #define set_encoder_active(encoder, val) \
 	os_atomic_set_bool(&encoder->active, val)
 
+/* queued audio to warn about (about a second at 48khz) */
+#define AUDIO_QUEUE_WARN_DEPTH 48
+
+struct encoder_audio_chunk {
+	uint64_t timestamp;
+	uint32_t frames;
+};
+
+static const char *encoder_signals[] = {
+	"void update(ptr encoder, bool success)",
+	NULL
+};
+
 struct obs_encoder_info *find_encoder(const char *id)
 {
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
@@ -47,8 +60,11 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 	pthread_mutexattr_t attr;
 
 	pthread_mutex_init_value(&encoder->init_mutex);
+	pthread_mutex_init_value(&encoder->update_mutex);
 	pthread_mutex_init_value(&encoder->callbacks_mutex);
 	pthread_mutex_init_value(&encoder->outputs_mutex);
+	pthread_mutex_init_value(&encoder->audio_encode_mutex);
+	pthread_mutex_init_value(&encoder->audio_queue_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -59,14 +75,21 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 		return false;
 	if (pthread_mutex_init(&encoder->init_mutex, &attr) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->update_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&encoder->callbacks_mutex, &attr) != 0)
 		return false;
 	if (pthread_mutex_init(&encoder->outputs_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->audio_encode_mutex, &attr) != 0)
+		return false;
+	if (pthread_mutex_init(&encoder->audio_queue_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults)
 		encoder->orig_info.get_defaults(encoder->context.settings);
 
+	signal_handler_add_array(encoder->context.signals, encoder_signals);
 	return true;
 }
 
@@ -132,6 +155,8 @@ obs_encoder_t *obs_audio_encoder_create(const char *id, const char *name,
 
 static void receive_video(void *param, struct video_data *frame);
 static void receive_audio(void *param, size_t mix_idx, struct audio_data *data);
+static bool start_audio_thread(struct obs_encoder *encoder);
+static void clear_audio_queue(struct obs_encoder *encoder);
 
 static inline void get_audio_info(const struct obs_encoder *encoder,
 		struct audio_convert_info *info)
@@ -187,10 +212,23 @@ static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 
 static void add_connection(struct obs_encoder *encoder)
 {
+	/* active before the first frame, so from then on updates wait for
+	 * the encoding thread */
+	pthread_mutex_lock(&encoder->update_mutex);
+	set_encoder_active(encoder, true);
+	pthread_mutex_unlock(&encoder->update_mutex);
+
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		struct audio_convert_info audio_info = {0};
 		get_audio_info(encoder, &audio_info);
 
+		/* if the thread can't be created, audio is encoded on the
+		 * audio-io thread like it used to be */
+		if (!start_audio_thread(encoder))
+			blog(LOG_WARNING, "Failed to create audio encoder "
+			                  "thread for '%s'",
+			                  encoder->context.name);
+
 		audio_output_connect(encoder->media, encoder->mixer_idx,
 				&audio_info, receive_audio, encoder);
 	} else {
@@ -204,8 +242,6 @@ static void add_connection(struct obs_encoder *encoder)
 					encoder);
 		}
 	}
-
-	set_encoder_active(encoder, true);
 }
 
 static void remove_connection(struct obs_encoder *encoder, bool shutdown)
@@ -213,6 +249,7 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		audio_output_disconnect(encoder->media, encoder->mixer_idx,
 				receive_audio, encoder);
+		clear_audio_queue(encoder);
 	} else {
 		if (gpu_encode_available(encoder)) {
 			stop_gpu_encode(encoder);
@@ -228,7 +265,14 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 	 * up again */
 	if (shutdown)
 		obs_encoder_shutdown(encoder);
+
+	pthread_mutex_lock(&encoder->update_mutex);
 	set_encoder_active(encoder, false);
+	pthread_mutex_unlock(&encoder->update_mutex);
+
+	/* nothing encodes anymore, so apply an update that came in after
+	 * the last frame */
+	obs_encoder_apply_update(encoder);
 }
 
 static inline void free_audio_buffers(struct obs_encoder *encoder)
@@ -240,9 +284,45 @@ static inline void free_audio_buffers(struct obs_encoder *encoder)
 	}
 }
 
+static void stop_audio_thread(struct obs_encoder *encoder)
+{
+	if (!encoder->audio_thread_active)
+		return;
+
+	os_atomic_set_bool(&encoder->audio_thread_stop, true);
+	os_sem_post(encoder->audio_queue_sem);
+	pthread_join(encoder->audio_thread, NULL);
+
+	encoder->audio_thread_active = false;
+}
+
+static inline void free_audio_queue(struct obs_encoder *encoder)
+{
+	circlebuf_free(&encoder->audio_queue_info);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		circlebuf_free(&encoder->audio_queue[i]);
+		bfree(encoder->audio_queue_buf[i]);
+		encoder->audio_queue_buf[i] = NULL;
+	}
+
+	encoder->audio_queue_buf_size = 0;
+}
+
 static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 {
 	if (encoder) {
+		/* the encoder can be stopped (and destroyed) from its own
+		 * audio thread, in which case the thread destroys the encoder
+		 * once it is done with it */
+		if (encoder->audio_thread_active &&
+		    pthread_equal(pthread_self(), encoder->audio_thread)) {
+			encoder->audio_thread_destroy = true;
+			return;
+		}
+
+		stop_audio_thread(encoder);
+
 		pthread_mutex_lock(&encoder->outputs_mutex);
 		for (size_t i = 0; i < encoder->outputs.num; i++) {
 			struct obs_output *output = encoder->outputs.array[i];
@@ -254,13 +334,18 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		blog(LOG_DEBUG, "encoder '%s' destroyed", encoder->context.name);
 
 		free_audio_buffers(encoder);
+		free_audio_queue(encoder);
+		os_sem_destroy(encoder->audio_queue_sem);
 
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
 		pthread_mutex_destroy(&encoder->init_mutex);
+		pthread_mutex_destroy(&encoder->update_mutex);
 		pthread_mutex_destroy(&encoder->callbacks_mutex);
 		pthread_mutex_destroy(&encoder->outputs_mutex);
+		pthread_mutex_destroy(&encoder->audio_encode_mutex);
+		pthread_mutex_destroy(&encoder->audio_queue_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void*)encoder->info.id);
@@ -373,16 +458,85 @@ obs_properties_t *obs_encoder_properties(const obs_encoder_t *encoder)
 	return NULL;
 }
 
+static void signal_update(struct obs_encoder *encoder, bool success)
+{
+	struct calldata data;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_set_ptr(&data, "encoder", encoder);
+	calldata_set_bool(&data, "success", success);
+	signal_handler_signal(encoder->context.signals, "update", &data);
+}
+
 void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings)
 {
+	bool updated = false;
+	bool success = true;
+
 	if (!obs_encoder_valid(encoder, "obs_encoder_update"))
 		return;
 
+	pthread_mutex_lock(&encoder->update_mutex);
+
 	obs_data_apply(encoder->context.settings, settings);
 
-	if (encoder->info.update && encoder->context.data)
-		encoder->info.update(encoder->context.data,
-				encoder->context.settings);
+	if (encoder->info.update && encoder->context.data) {
+		if (encoder_active(encoder)) {
+			os_atomic_set_bool(&encoder->update_requested, true);
+		} else {
+			success = encoder->info.update(encoder->context.data,
+					encoder->context.settings);
+			updated = true;
+		}
+	}
+
+	pthread_mutex_unlock(&encoder->update_mutex);
+
+	if (updated)
+		signal_update(encoder, success);
+}
+
+/* called on the thread the encoder encodes on, before it encodes a frame */
+void obs_encoder_apply_update(obs_encoder_t *encoder)
+{
+	bool success;
+
+	if (!os_atomic_load_bool(&encoder->update_requested))
+		return;
+
+	pthread_mutex_lock(&encoder->update_mutex);
+	os_atomic_set_bool(&encoder->update_requested, false);
+
+	/* a shut down encoder picks up its settings when it is created
+	 * again */
+	if (!encoder->context.data) {
+		pthread_mutex_unlock(&encoder->update_mutex);
+		return;
+	}
+
+	success = encoder->info.update(encoder->context.data,
+			encoder->context.settings);
+	pthread_mutex_unlock(&encoder->update_mutex);
+
+	if (!success)
+		blog(LOG_WARNING, "Encoder '%s' could not apply its new "
+				"settings while active",
+				encoder->context.name);
+
+	signal_update(encoder, success);
+}
+
+signal_handler_t *obs_encoder_get_signal_handler(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_signal_handler") ?
+		encoder->context.signals : NULL;
+}
+
+proc_handler_t *obs_encoder_get_proc_handler(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_proc_handler") ?
+		encoder->context.procs : NULL;
 }
 
 bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
@@ -798,7 +952,6 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 		struct encoder_callback *cb, struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t)       data;
 	uint8_t               *sei;
 	size_t                size;
 
@@ -806,35 +959,37 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
 	first_packet      = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	first_packet.data = obs_encoder_packet_alloc(size + packet->size);
+	first_packet.size = size + packet->size;
+
+	memcpy(first_packet.data, sei, size);
+	memcpy(first_packet.data + size, packet->data, packet->size);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
 		struct encoder_callback *cb, struct encoder_packet *packet)
 {
+	/* each callback gets its own copy of the packet info, the data is
+	 * shared and referenced by callbacks that keep it */
+	struct encoder_packet cb_packet = *packet;
+
 	/* include SEI in first video packet */
 	if (encoder->info.type == OBS_ENCODER_VIDEO && !cb->sent_first_packet)
-		send_first_video_packet(encoder, cb, packet);
+		send_first_video_packet(encoder, cb, &cb_packet);
 	else
-		cb->new_packet(cb->param, packet);
+		cb->new_packet(cb->param, &cb_packet);
 }
 
 void full_stop(struct obs_encoder *encoder)
@@ -884,10 +1039,20 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
-		for (size_t i = encoder->callbacks.num; i > 0; i--) {
-			struct encoder_callback *cb;
-			cb = encoder->callbacks.array+(i-1);
-			send_packet(encoder, cb, pkt);
+		if (encoder->callbacks.num) {
+			struct encoder_packet shared;
+
+			/* the only copy of the encoder's data, shared by all
+			 * outputs */
+			obs_encoder_packet_create_instance(&shared, pkt);
+
+			for (size_t i = encoder->callbacks.num; i > 0; i--) {
+				struct encoder_callback *cb;
+				cb = encoder->callbacks.array+(i-1);
+				send_packet(encoder, cb, &shared);
+			}
+
+			obs_encoder_packet_release(&shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
@@ -911,6 +1076,8 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 	pkt.timebase_den = encoder->timebase_den;
 	pkt.encoder = encoder;
 
+	obs_encoder_apply_update(encoder);
+
 	profile_start(encoder->profile_encoder_encode_name);
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 			&received);
@@ -1086,12 +1253,10 @@ static bool send_audio_data(struct obs_encoder *encoder)
 }
 
 static const char *receive_audio_name = "receive_audio";
-static void receive_audio(void *param, size_t mix_idx, struct audio_data *data)
+static void encode_audio(struct obs_encoder *encoder, struct audio_data *data)
 {
 	profile_start(receive_audio_name);
 
-	struct obs_encoder *encoder = param;
-
 	if (!encoder->first_received) {
 		encoder->first_raw_ts = data->timestamp;
 		encoder->first_received = true;
@@ -1107,12 +1272,178 @@ static void receive_audio(void *param, size_t mix_idx, struct audio_data *data)
 		}
 	}
 
-	UNUSED_PARAMETER(mix_idx);
-
 end:
 	profile_end(receive_audio_name);
 }
 
+static void queue_audio(struct obs_encoder *encoder, struct audio_data *data)
+{
+	struct encoder_audio_chunk chunk = {data->timestamp, data->frames};
+	size_t size = data->frames * encoder->blocksize;
+	long depth;
+
+	pthread_mutex_lock(&encoder->audio_queue_mutex);
+
+	circlebuf_push_back(&encoder->audio_queue_info, &chunk, sizeof(chunk));
+	for (size_t i = 0; i < encoder->planes; i++)
+		circlebuf_push_back(&encoder->audio_queue[i], data->data[i],
+				size);
+
+	depth = os_atomic_inc_long(&encoder->audio_queue_depth);
+
+	pthread_mutex_unlock(&encoder->audio_queue_mutex);
+
+	os_sem_post(encoder->audio_queue_sem);
+
+	if (depth >= AUDIO_QUEUE_WARN_DEPTH && !encoder->audio_queue_warned) {
+		blog(LOG_WARNING, "Audio encoder '%s' is falling behind, "
+		                  "%ld chunks of audio are waiting to be "
+		                  "encoded",
+		                  encoder->context.name, depth);
+		encoder->audio_queue_warned = true;
+	} else if (depth == 1) {
+		encoder->audio_queue_warned = false;
+	}
+}
+
+/* encodes the next chunk of queued audio, if any */
+static void encode_queued_audio(struct obs_encoder *encoder)
+{
+	struct encoder_audio_chunk chunk;
+	struct audio_data data = {0};
+	size_t size;
+
+	pthread_mutex_lock(&encoder->audio_queue_mutex);
+
+	if (encoder->audio_queue_info.size < sizeof(chunk)) {
+		pthread_mutex_unlock(&encoder->audio_queue_mutex);
+		return;
+	}
+
+	circlebuf_pop_front(&encoder->audio_queue_info, &chunk, sizeof(chunk));
+	size = chunk.frames * encoder->blocksize;
+
+	if (size > encoder->audio_queue_buf_size) {
+		for (size_t i = 0; i < encoder->planes; i++) {
+			bfree(encoder->audio_queue_buf[i]);
+			encoder->audio_queue_buf[i] = bmalloc(size);
+		}
+		encoder->audio_queue_buf_size = size;
+	}
+
+	for (size_t i = 0; i < encoder->planes; i++) {
+		circlebuf_pop_front(&encoder->audio_queue[i],
+				encoder->audio_queue_buf[i], size);
+		data.data[i] = encoder->audio_queue_buf[i];
+	}
+
+	os_atomic_dec_long(&encoder->audio_queue_depth);
+
+	pthread_mutex_unlock(&encoder->audio_queue_mutex);
+
+	data.frames    = chunk.frames;
+	data.timestamp = chunk.timestamp;
+	encode_audio(encoder, &data);
+}
+
+static void *audio_encode_thread(void *param)
+{
+	struct obs_encoder *encoder = param;
+
+	os_set_thread_name("libobs: audio encoder thread");
+
+	while (os_sem_wait(encoder->audio_queue_sem) == 0) {
+		if (os_atomic_load_bool(&encoder->audio_thread_stop))
+			break;
+
+		profile_start(encoder->profile_audio_thread_name);
+
+		pthread_mutex_lock(&encoder->audio_encode_mutex);
+		encode_queued_audio(encoder);
+		pthread_mutex_unlock(&encoder->audio_encode_mutex);
+
+		profile_end(encoder->profile_audio_thread_name);
+
+		profile_reenable_thread();
+
+		if (encoder->audio_thread_destroy) {
+			pthread_detach(encoder->audio_thread);
+			encoder->audio_thread_active = false;
+			obs_encoder_actually_destroy(encoder);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static bool start_audio_thread(struct obs_encoder *encoder)
+{
+	audio_t *audio = encoder->media;
+
+	if (encoder->audio_thread_active)
+		return true;
+	if (!encoder->audio_queue_sem &&
+	    os_sem_init(&encoder->audio_queue_sem, 0) != 0)
+		return false;
+
+	if (!encoder->profile_audio_thread_name) {
+		encoder->profile_audio_thread_name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"audio_encoder_thread(%s)",
+				encoder->context.name);
+		profile_register_root(encoder->profile_audio_thread_name,
+				audio_frames_to_ns(
+					audio_output_get_sample_rate(audio),
+					AUDIO_OUTPUT_FRAMES));
+	}
+
+	encoder->audio_thread_stop = false;
+	if (pthread_create(&encoder->audio_thread, NULL, audio_encode_thread,
+				encoder) != 0)
+		return false;
+
+	encoder->audio_thread_active = true;
+	return true;
+}
+
+/* drops queued audio, waiting for audio being encoded if needed */
+static void clear_audio_queue(struct obs_encoder *encoder)
+{
+	pthread_mutex_lock(&encoder->audio_encode_mutex);
+	pthread_mutex_lock(&encoder->audio_queue_mutex);
+
+	circlebuf_free(&encoder->audio_queue_info);
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		circlebuf_free(&encoder->audio_queue[i]);
+
+	encoder->audio_queue_depth = 0;
+	encoder->audio_queue_warned = false;
+
+	pthread_mutex_unlock(&encoder->audio_queue_mutex);
+	pthread_mutex_unlock(&encoder->audio_encode_mutex);
+}
+
+static void receive_audio(void *param, size_t mix_idx, struct audio_data *data)
+{
+	struct obs_encoder *encoder = param;
+
+	if (encoder->audio_thread_active)
+		queue_audio(encoder, data);
+	else
+		encode_audio(encoder, data);
+
+	UNUSED_PARAMETER(mix_idx);
+}
+
+size_t obs_encoder_get_audio_queue_depth(const obs_encoder_t *encoder)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_audio_queue_depth"))
+		return 0;
+
+	return (size_t)os_atomic_load_long(&encoder->audio_queue_depth);
+}
+
 void obs_encoder_add_output(struct obs_encoder *encoder,
 		struct obs_output *output)
 {
@@ -1133,16 +1464,130 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Packet data
+ *
+ *   Encoded packets are copied once when they leave the encoder and are then
+ *   shared by reference between all outputs.  Packet buffers are allocated in
+ *   power of two size classes and kept for reuse when released, so once a GOP
+ *   or so is in flight, encoding no longer goes through the allocator. */
+
+#define PACKET_MIN_CLASS_SHIFT 8  /* 256 bytes */
+#define PACKET_NUM_CLASSES     15 /* up to 4 MiB */
+#define PACKET_POOL_MAX_BYTES  (8 * 1024 * 1024)
+#define PACKET_POOL_MIN_BLOCKS 8
+
+/* refs must stay directly before the data */
+struct packet_block {
+	struct packet_block *next;
+	size_t size_class;
+	volatile long refs;
+};
+
+static pthread_mutex_t packet_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct packet_block *packet_pool[PACKET_NUM_CLASSES];
+static size_t packet_pool_count[PACKET_NUM_CLASSES];
+
+static volatile long packet_instances = 0;
+static volatile long packet_allocs = 0;
+
+static inline size_t packet_class_size(size_t size_class)
+{
+	return (size_t)1 << (size_class + PACKET_MIN_CLASS_SHIFT);
+}
+
+static inline size_t packet_pool_max_blocks(size_t size_class)
+{
+	size_t blocks = PACKET_POOL_MAX_BYTES / packet_class_size(size_class);
+	return blocks > PACKET_POOL_MIN_BLOCKS ? blocks : PACKET_POOL_MIN_BLOCKS;
+}
+
+static const char *packet_alloc_name = "obs_encoder_packet_alloc";
+uint8_t *obs_encoder_packet_alloc(size_t size)
+{
+	struct packet_block *block = NULL;
+	size_t size_class = 0;
+
+	while (size_class < PACKET_NUM_CLASSES &&
+	       packet_class_size(size_class) < size)
+		size_class++;
+
+	if (size_class < PACKET_NUM_CLASSES) {
+		pthread_mutex_lock(&packet_pool_mutex);
+		block = packet_pool[size_class];
+		if (block) {
+			packet_pool[size_class] = block->next;
+			packet_pool_count[size_class]--;
+		}
+		pthread_mutex_unlock(&packet_pool_mutex);
+
+		size = packet_class_size(size_class);
+	}
+
+	if (!block) {
+		profile_start(packet_alloc_name);
+		block = bmalloc(sizeof(*block) + size);
+		block->size_class = size_class;
+		os_atomic_inc_long(&packet_allocs);
+		profile_end(packet_alloc_name);
+	}
+
+	block->next = NULL;
+	block->refs = 1;
+	return (uint8_t*)(block + 1);
+}
+
+static void packet_free(struct packet_block *block)
+{
+	size_t size_class = block->size_class;
+
+	if (size_class < PACKET_NUM_CLASSES && obs) {
+		pthread_mutex_lock(&packet_pool_mutex);
+		if (packet_pool_count[size_class] <
+				packet_pool_max_blocks(size_class)) {
+			block->next = packet_pool[size_class];
+			packet_pool[size_class] = block;
+			packet_pool_count[size_class]++;
+			block = NULL;
+		}
+		pthread_mutex_unlock(&packet_pool_mutex);
+	}
+
+	bfree(block);
+}
+
+void obs_encoder_packet_pool_free(void)
+{
+	pthread_mutex_lock(&packet_pool_mutex);
+	for (size_t i = 0; i < PACKET_NUM_CLASSES; i++) {
+		while (packet_pool[i]) {
+			struct packet_block *block = packet_pool[i];
+			packet_pool[i] = block->next;
+			bfree(block);
+		}
+		packet_pool_count[i] = 0;
+	}
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	blog(LOG_INFO, "Encoder packets: %ld created, %ld buffers allocated",
+			os_atomic_set_long(&packet_instances, 0),
+			os_atomic_set_long(&packet_allocs, 0));
+}
+
+static const char *packet_create_instance_name =
+	"obs_encoder_packet_create_instance";
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 		const struct encoder_packet *src)
 {
-	long *p_refs;
+	profile_start(packet_create_instance_name);
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void*)(p_refs + 1);
-	*p_refs = 1;
-	memcpy(dst->data, src->data, src->size);
+	dst->data = obs_encoder_packet_alloc(src->size);
+	if (src->size)
+		memcpy(dst->data, src->data, src->size);
+
+	os_atomic_inc_long(&packet_instances);
+	profile_end(packet_create_instance_name);
 }
 
 void obs_duplicate_encoder_packet(struct encoder_packet *dst,
@@ -1163,8 +1608,8 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 		return;
 
 	if (src->data) {
-		long *p_refs = ((long*)src->data) - 1;
-		os_atomic_inc_long(p_refs);
+		struct packet_block *block = ((struct packet_block*)src->data) - 1;
+		os_atomic_inc_long(&block->refs);
 	}
 
 	*dst = *src;
@@ -1176,9 +1621,9 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long*)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		struct packet_block *block = ((struct packet_block*)pkt->data) - 1;
+		if (os_atomic_dec_long(&block->refs) == 0)
+			packet_free(block);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
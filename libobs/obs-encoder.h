@@ -31,6 +31,7 @@ extern "C" {
 
 #define OBS_ENCODER_CAP_DEPRECATED             (1<<0)
 #define OBS_ENCODER_CAP_PASS_TEXTURE           (1<<1)
+#define OBS_ENCODER_CAP_DYN_BITRATE            (1<<2)
 
 /** Specifies the encoder type */
 enum obs_encoder_type {
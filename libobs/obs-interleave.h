@@ -0,0 +1,148 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/darray.h"
+#include "obs.h"
+
+/*
+ * Output packet interleaving
+ *
+ *   Packets are queued per track, each queue sorted by dts.  The next packet
+ *   to send is the earliest of the first packets of all queues, so queueing
+ *   and sending do not depend on how many packets are waiting.  There are at
+ *   most INTERLEAVE_QUEUES tracks, which is few enough to compare the first
+ *   packets directly rather than keeping them in a heap.
+ *
+ *   Kept apart from obs-output.c so the ordering can be tested on its own.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct interleaved_packet {
+	struct encoder_packet           packet;
+	uint64_t                        seq;
+};
+
+/* packets of one track waiting to be interleaved, in the order they will be
+ * sent.  packets before head have already been sent */
+struct interleave_queue {
+	DARRAY(struct interleaved_packet) packets;
+	size_t                          head;
+};
+
+/* video, then one per audio track */
+#define INTERLEAVE_QUEUES (MAX_AUDIO_MIXES + 1)
+
+static inline struct interleave_queue *interleave_get_queue(
+		struct interleave_queue *queues, enum obs_encoder_type type,
+		size_t track_idx)
+{
+	return &queues[type == OBS_ENCODER_VIDEO ? 0 : track_idx + 1];
+}
+
+static inline struct interleaved_packet *interleave_queue_first(
+		struct interleave_queue *queue)
+{
+	return queue->head < queue->packets.num ?
+		queue->packets.array + queue->head : NULL;
+}
+
+static inline struct interleaved_packet *interleave_queue_last(
+		struct interleave_queue *queue)
+{
+	return queue->head < queue->packets.num ?
+		queue->packets.array + queue->packets.num - 1 : NULL;
+}
+
+static inline void interleave_queue_pop(struct interleave_queue *queue)
+{
+	/* sent packets are only erased once they are at least half of the
+	 * array, so this stays cheap however many packets are waiting */
+	if (++queue->head == queue->packets.num) {
+		da_resize(queue->packets, 0);
+		queue->head = 0;
+
+	} else if (queue->head >= 32 && queue->head * 2 >= queue->packets.num) {
+		da_erase_range(queue->packets, 0, queue->head);
+		queue->head = 0;
+	}
+}
+
+/* the order packets are sent in: by dts, and with the same dts, video before
+ * audio.  audio with the same dts goes in the order it was received, video
+ * the other way around (newer video always went first) */
+static inline bool interleave_packet_before(
+		const struct interleaved_packet *a,
+		const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+	if (a->packet.type != b->packet.type)
+		return a->packet.type == OBS_ENCODER_VIDEO;
+	if (a->packet.type == OBS_ENCODER_VIDEO)
+		return a->seq > b->seq;
+	return a->seq < b->seq;
+}
+
+/* returns the next packet to send, and optionally the queue it is in */
+static inline struct interleaved_packet *interleave_first(
+		struct interleave_queue *queues,
+		struct interleave_queue **queue)
+{
+	struct interleaved_packet *first = NULL;
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *cur = &queues[i];
+		struct interleaved_packet *packet =
+			interleave_queue_first(cur);
+
+		if (packet && (!first ||
+		               interleave_packet_before(packet, first))) {
+			first = packet;
+			if (queue)
+				*queue = cur;
+		}
+	}
+
+	return first;
+}
+
+static inline void interleave_insert(struct interleave_queue *queues,
+		uint64_t *seq, const struct encoder_packet *out)
+{
+	struct interleave_queue *queue = interleave_get_queue(queues,
+			out->type, out->track_idx);
+	struct interleaved_packet packet = {*out, (*seq)++};
+	size_t idx = queue->packets.num;
+
+	/* packets of a track arrive in order, so this is almost always the
+	 * end of the queue */
+	while (idx > queue->head &&
+	       interleave_packet_before(&packet,
+		       &queue->packets.array[idx - 1]))
+		idx--;
+
+	da_insert(queue->packets, idx, &packet);
+}
+
+#ifdef __cplusplus
+}
+#endif
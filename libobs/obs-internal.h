@@ -20,6 +20,7 @@
 #include "util/c99defs.h"
 #include "util/darray.h"
 #include "util/circlebuf.h"
+#include "util/spsc-ring.h"
 #include "util/dstr.h"
 #include "util/threading.h"
 #include "util/platform.h"
@@ -35,11 +36,15 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-interleave.h"
 
 #define NUM_TEXTURES 2
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define MAX_TICK_THREADS 4
+#define MAX_AUDIO_RENDER_THREADS 4
+#define BUFFERING_WINDOW_BUCKETS 10
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -286,6 +291,18 @@ struct obs_core_video {
 	uint32_t                        lagged_frames;
 	bool                            thread_initialized;
 
+	/* source ticking, see tick_sources in obs-video.c */
+	DARRAY(struct obs_source*)      tick_serial;
+	DARRAY(struct obs_source*)      tick_parallel;
+	volatile long                   tick_next;
+	float                           tick_seconds;
+	os_sem_t                        *tick_start_sem;
+	os_sem_t                        *tick_done_sem;
+	volatile bool                   tick_stop;
+	pthread_t                       tick_threads[MAX_TICK_THREADS];
+	size_t                          num_tick_threads;
+	bool                            tick_threads_started;
+
 	bool                            gpu_conversion;
 	const char                      *conversion_tech;
 	uint32_t                        conversion_height;
@@ -316,23 +333,62 @@ struct obs_core_video {
 
 struct audio_monitor;
 
+struct audio_render_edge {
+	struct obs_source               *parent;
+	size_t                          child_idx;
+};
+
 struct obs_core_audio {
 	audio_t                         *audio;
 
 	DARRAY(struct obs_source*)      render_order;
 	DARRAY(struct obs_source*)      root_nodes;
 
+	/* cached render graph, see update_audio_graph in obs-audio.c */
+	DARRAY(obs_weak_source_t*)      graph;
+	DARRAY(size_t)                  graph_roots;
+	DARRAY(size_t)                  graph_audio_sources;
+	size_t                          graph_max_level;
+	size_t                          graph_age;
+	volatile bool                   graph_dirty;
+
+	/* parallel source rendering, see render_audio_sources in
+	 * obs-audio.c */
+	DARRAY(struct audio_render_edge) render_edges;
+	DARRAY(size_t)                  render_levels;
+	DARRAY(struct obs_source*)      render_level;
+	volatile long                   render_next;
+	uint32_t                        render_mixers;
+	size_t                          render_channels;
+	size_t                          render_sample_rate;
+	size_t                          render_size;
+	os_sem_t                        *render_start_sem;
+	os_sem_t                        *render_done_sem;
+	volatile bool                   render_stop;
+	pthread_t                       render_threads[MAX_AUDIO_RENDER_THREADS];
+	size_t                          num_render_threads;
+	bool                            render_threads_started;
+
 	uint64_t                        buffered_ts;
 	struct circlebuf                buffered_timestamps;
 	int                             buffering_wait_ticks;
 	int                             total_buffering_ticks;
 
+	/* adaptive buffering, see update_buffering in obs-audio.c */
+	uint64_t                        lead_buckets[BUFFERING_WINDOW_BUCKETS];
+	size_t                          num_lead_buckets;
+	size_t                          lead_bucket_idx;
+	uint64_t                        cur_bucket_lead;
+	size_t                          cur_bucket_ticks;
+	int                             target_buffering_ticks;
+
 	float                           user_volume;
 
 	pthread_mutex_t                 monitoring_mutex;
 	DARRAY(struct audio_monitor*)   monitors;
 	char                            *monitoring_device_name;
 	char                            *monitoring_device_id;
+	uint32_t                        monitoring_latency_ms;
 };
 
 /* user sources, output channels, and displays */
@@ -431,9 +487,14 @@ struct obs_core {
 extern struct obs_core *obs;
 
 extern void *obs_graphics_thread(void *param);
+extern void obs_free_tick_threads(void);
 
 extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
+extern void obs_free_audio_render_threads(void);
+extern void obs_invalidate_audio_graph(void);
+extern void obs_free_audio_graph(void);
+
 extern bool audio_callback(void *param,
 		uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts,
 		uint32_t mixers, struct audio_output_data *mixes);
@@ -537,6 +598,11 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* set for frames whose data is owned by the source, see
+	 * obs_source_output_video_nocopy.  these are never reused */
+	obs_source_frame_release_cb release;
+	void *release_param;
 };
 
 enum audio_action_type {
@@ -565,6 +631,23 @@ struct audio_cb_info {
 	void *param;
 };
 
+struct audio_levels_cb {
+	obs_source_audio_levels_t callback;
+	void *param;
+	uint64_t interval_ns;
+
+	/* levels accumulated since start_ts */
+	uint64_t start_ts;
+	struct obs_audio_levels levels;
+	double sum_sq[MAX_AUDIO_CHANNELS];
+};
+
+struct audio_filter_block {
+	struct obs_audio_data           audio;
+	uint8_t                         *mem;
+	uint32_t                        capacity;
+};
+
 struct obs_source {
 	struct obs_context_data         context;
 	struct obs_source_info          info;
@@ -619,6 +702,13 @@ struct obs_source {
 	uint64_t                        audio_ts;
 	struct circlebuf                audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t                          last_audio_input_buf_size;
+
+	/* audio handed from the source's thread to the audio thread, see
+	 * source_output_audio_data.  audio_ts and audio_input_buf are only
+	 * touched by the audio thread */
+	struct spsc_ring                audio_ring;
+	float                           *audio_ring_buf;
+	bool                            audio_ring_full;
 	DARRAY(struct audio_action)     audio_actions;
 	float                           *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
 	struct resample_info            sample_info;
@@ -628,8 +718,22 @@ struct obs_source {
 	pthread_mutex_t                 audio_mutex;
 	pthread_mutex_t                 audio_cb_mutex;
 	DARRAY(struct audio_cb_info)    audio_cb_list;
+
+	/* audio levels, see obs-audio-levels.c */
+	pthread_mutex_t                 audio_levels_mutex;
+	DARRAY(struct audio_levels_cb)  audio_levels_cbs;
+	volatile long                   audio_levels_refs;
+	volatile long                   audio_levels_seq;
+	struct obs_audio_levels         audio_levels;
+	float                           audio_levels_window[MAX_AUDIO_CHANNELS][4];
+
 	struct obs_audio_data           audio_data;
 	size_t                          audio_storage_size;
+
+	/* output blocks of audio filters, reused every time audio is
+	 * filtered, see obs_filter_get_audio_block */
+	DARRAY(struct audio_filter_block*) audio_filter_blocks;
+	size_t                          audio_filter_blocks_used;
 	uint32_t                        audio_mixers;
 	float                           user_volume;
 	float                           volume;
@@ -653,6 +757,7 @@ struct obs_source {
 	bool                            async_update_texture;
 	bool                            async_unbuffered;
 	bool                            async_decoupled;
+	bool                            async_nocopy_closed;
 	struct obs_source_frame         *async_preload_frame;
 	DARRAY(struct async_frame)      async_cache;
 	DARRAY(struct obs_source_frame*)async_frames;
@@ -743,6 +848,8 @@ extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
+extern bool audio_monitor_get_stats(struct audio_monitor *monitor,
+		struct obs_audio_monitoring_stats *stats);
 
 extern void obs_source_destroy(struct obs_source *source);
 
@@ -796,6 +903,8 @@ extern float obs_source_get_target_volume(obs_source_t *source,
 
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		size_t channels, size_t sample_rate, size_t size);
+extern void obs_source_measure_audio_levels(obs_source_t *source,
+		const struct audio_data *data, bool muted);
 
 extern void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy);
 
@@ -865,7 +974,8 @@ struct obs_output {
 	pthread_t                       end_data_capture_thread;
 	os_event_t                      *stopping_event;
 	pthread_mutex_t                 interleaved_mutex;
-	DARRAY(struct encoder_packet)   interleaved_packets;
+	struct interleave_queue         interleave_queues[INTERLEAVE_QUEUES];
+	uint64_t                        interleave_seq;
 	int                             stop_code;
 
 	int                             reconnect_retry_sec;
@@ -944,6 +1054,11 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 
 extern void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 		const struct encoder_packet *src);
+
+/* allocates packet data with a reference count of 1, to be released with
+ * obs_encoder_packet_release */
+extern uint8_t *obs_encoder_packet_alloc(size_t size);
+extern void obs_encoder_packet_pool_free(void);
 void obs_output_destroy(obs_output_t *output);
 
 
@@ -971,6 +1086,12 @@ struct obs_encoder {
 
 	pthread_mutex_t                 init_mutex;
 
+	/* updates to an active encoder are deferred to the thread it encodes
+	 * on, so that they never run at the same time as an encode.
+	 * update_mutex protects the settings while they change */
+	pthread_mutex_t                 update_mutex;
+	volatile bool                   update_requested;
+
 	uint32_t                        samplerate;
 	size_t                          planes;
 	size_t                          blocksize;
@@ -997,6 +1118,24 @@ struct obs_encoder {
 	struct circlebuf                audio_input_buffer[MAX_AV_PLANES];
 	uint8_t                         *audio_output_buffer[MAX_AV_PLANES];
 
+	/* audio encoders encode on their own thread so that they do not hold
+	 * up the audio-io thread.  audio_encode_mutex is held while queued
+	 * audio is being encoded, audio_queue_mutex protects the queue */
+	pthread_t                       audio_thread;
+	bool                            audio_thread_active;
+	volatile bool                   audio_thread_stop;
+	bool                            audio_thread_destroy;
+	os_sem_t                        *audio_queue_sem;
+	pthread_mutex_t                 audio_encode_mutex;
+	pthread_mutex_t                 audio_queue_mutex;
+	struct circlebuf                audio_queue_info;
+	struct circlebuf                audio_queue[MAX_AV_PLANES];
+	uint8_t                         *audio_queue_buf[MAX_AV_PLANES];
+	size_t                          audio_queue_buf_size;
+	volatile long                   audio_queue_depth;
+	bool                            audio_queue_warned;
+	const char                      *profile_audio_thread_name;
+
 	/* if a video encoder is paired with an audio encoder, make it start
 	 * up at the specific timestamp.  if this is the audio encoder,
 	 * wait_for_video makes it wait until it's ready to sync up with
@@ -1027,6 +1166,8 @@ extern struct obs_encoder_info *find_encoder(const char *id);
 extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
 
+extern void obs_encoder_apply_update(obs_encoder_t *encoder);
+
 extern void obs_encoder_start(obs_encoder_t *encoder,
 		void (*new_packet)(void *param, struct encoder_packet *packet),
 		void *param);
@@ -164,9 +164,16 @@ fail:
 
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array+i);
-	da_free(output->interleaved_packets);
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = queue->head; j < queue->packets.num; j++)
+			obs_encoder_packet_release(
+					&queue->packets.array[j].packet);
+
+		da_free(queue->packets);
+		queue->head = 0;
+	}
 }
 
 void obs_output_destroy(obs_output_t *output)
@@ -1013,36 +1020,31 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_t sei;
 	uint8_t *data;
 	size_t size;
-	long ref = 1;
-
-	DARRAY(uint8_t) out_data;
 
 	if (out->priority > 1)
 		return false;
 
 	sei_init(&sei, 0.0);
 
-	da_init(out_data);
-	da_push_back_array(out_data, &ref, sizeof(ref));
-	da_push_back_array(out_data, out->data, out->size);
-
 	caption_frame_init(&cf);
 	caption_frame_from_text(&cf, &output->caption_head->text[0]);
 
 	sei_from_caption_frame(&sei, &cf);
 
-	data = malloc(sei_render_size(&sei));
-	size = sei_render(&sei, data);
+	/* the packet data is shared with other outputs, so the caption goes
+	 * in to a new packet */
+	data = obs_encoder_packet_alloc(out->size + 4 + sei_render_size(&sei));
+	memcpy(data, out->data, out->size);
+
 	/* TODO SEI should come after AUD/SPS/PPS, but before any VCL */
-	da_push_back_array(out_data, nal_start, 4);
-	da_push_back_array(out_data, data, size);
-	free(data);
+	memcpy(data + out->size, nal_start, 4);
+	size = sei_render(&sei, data + out->size + 4);
 
 	obs_encoder_packet_release(out);
 
 	*out = backup;
-	out->data = (uint8_t*)out_data.array + sizeof(ref);
-	out->size = out_data.num - sizeof(ref);
+	out->data = data;
+	out->size = backup.size + 4 + size;
 
 	sei_free(&sei);
 
@@ -1053,9 +1055,53 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 }
 #endif
 
+/* ------------------------------------------------------------------------- */
+/* Interleaving (see obs-interleave.h) */
+
+static inline struct interleaved_packet *first_interleaved_packet(
+		struct obs_output *output, struct interleave_queue **queue)
+{
+	return interleave_first(output->interleave_queues, queue);
+}
+
+static inline void insert_interleaved_packet(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	interleave_insert(output->interleave_queues, &output->interleave_seq,
+			out);
+}
+
+/* discards all packets that would be sent before stop, and stop itself if
+ * inclusive is set */
+static void discard_interleaved_packets(struct obs_output *output,
+		const struct interleaved_packet *stop, bool inclusive)
+{
+	const struct interleaved_packet stop_packet = *stop;
+	struct interleave_queue *queue;
+	struct interleaved_packet *packet;
+
+	while ((packet = first_interleaved_packet(output, &queue)) != NULL) {
+		bool discard = interleave_packet_before(packet, &stop_packet) ||
+			(inclusive && packet->seq == stop_packet.seq);
+		if (!discard)
+			break;
+
+		obs_encoder_packet_release(&packet->packet);
+		interleave_queue_pop(queue);
+	}
+}
+
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct interleave_queue *queue;
+	struct interleaved_packet *first = first_interleaved_packet(output,
+			&queue);
+	struct encoder_packet out;
+
+	if (!first)
+		return;
+
+	out = first->packet;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
@@ -1063,7 +1109,7 @@ static inline void send_interleaved(struct obs_output *output)
 	if (!has_higher_opposing_ts(output, &out))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	interleave_queue_pop(queue);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1109,189 +1155,149 @@ static inline void set_higher_ts(struct obs_output *output,
 	}
 }
 
-static inline struct encoder_packet *find_first_packet_type(
+static inline struct interleaved_packet *find_first_packet_type(
 		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx);
+		size_t audio_idx)
+{
+	return interleave_queue_first(interleave_get_queue(
+			output->interleave_queues, type, audio_idx));
+}
+
+static inline struct interleaved_packet *find_last_packet_type(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	return interleave_queue_last(interleave_get_queue(
+			output->interleave_queues, type, audio_idx));
+}
 
 /* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+static struct interleaved_packet *get_interleaved_start(
+		struct obs_output *output)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
-	struct encoder_packet *first_video = find_first_packet_type(output,
+	struct interleaved_packet *first_video = find_first_packet_type(output,
 			OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
-
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
+	struct interleaved_packet *closest = NULL;
+
+	if (!first_video)
+		return NULL;
+
+	for (size_t i = 1; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
 
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+		for (size_t j = queue->head; j < queue->packets.num; j++) {
+			struct interleaved_packet *packet =
+				&queue->packets.array[j];
+			int64_t diff = llabs(packet->packet.dts_usec -
+					first_video->packet.dts_usec);
+
+			if (diff < closest_diff || (diff == closest_diff &&
+					interleave_packet_before(packet,
+						closest))) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return NULL;
+
+	return interleave_packet_before(first_video, closest) ?
+		first_video : closest;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+/* returns -1 if a track has no packets yet, otherwise whether the first
+ * packets of each track up to and including *last should be pruned */
+static int prune_premature_packets(struct obs_output *output,
+		struct interleaved_packet **last)
 {
 	size_t audio_mixes = num_audio_mixes(output);
-	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	struct interleaved_packet *video;
 	int64_t duration_usec;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1) {
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!video) {
 		output->received_video = false;
 		return -1;
 	}
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
-	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
+	*last = video;
+	duration_usec = video->packet.timebase_num * 1000000LL /
+		video->packet.timebase_den;
 
 	for (size_t i = 0; i < audio_mixes; i++) {
-		struct encoder_packet *audio;
-		int audio_idx;
+		struct interleaved_packet *audio;
 
-		audio_idx = find_first_packet_type_idx(output,
-				OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (interleave_packet_before(*last, audio))
+			*last = audio;
 
-		diff = audio->dts_usec - video->dts_usec;
+		diff = audio->packet.dts_usec - video->packet.dts_usec;
 		if (diff > max_diff)
 			max_diff = diff;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
-}
-
-static void discard_to_idx(struct obs_output *output, size_t idx)
-{
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
-	}
-
-	da_erase_range(output->interleaved_packets, 0, idx);
+	return diff > duration_usec ? 1 : 0;
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct interleaved_packet *last = NULL;
+	int prune = prune_premature_packets(output, &last);
 
 #if DEBUG_STARTING_PACKETS == 1
-	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-				packet->type == OBS_ENCODER_AUDIO ?
-				"audio" : "video", (int)packet->track_idx,
-				packet->dts_usec,
-				(int)i < prune_start ? "true" : "false");
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune);
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
+
+		for (size_t j = queue->head; j < queue->packets.num; j++) {
+			struct interleaved_packet *packet =
+				&queue->packets.array[j];
+			bool pruned = prune == 1 && (packet == last ||
+					interleave_packet_before(packet, last));
+
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, "
+					"pruned = %s",
+					packet->packet.type ==
+					OBS_ENCODER_AUDIO ? "audio" : "video",
+					(int)packet->packet.track_idx,
+					packet->packet.dts_usec,
+					pruned ? "true" : "false");
+		}
 	}
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
+	if (prune == -1) {
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
 
-	return true;
-}
-
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)i;
-		}
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
+	} else if (prune == 1) {
+		discard_interleaved_packets(output, last, true);
 
-			return (int)(i - 1);
-		}
+	} else {
+		struct interleaved_packet *start = get_interleaved_start(
+				output);
+		if (start)
+			discard_interleaved_packets(output, start, false);
 	}
 
-	return -1;
-}
-
-static inline struct encoder_packet *find_first_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *find_last_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return true;
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output,
-		struct encoder_packet **video,
-		struct encoder_packet **audio, size_t audio_mixes)
+		struct interleaved_packet **video,
+		struct interleaved_packet **audio, size_t audio_mixes)
 {
 	*video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
 	if (!*video)
@@ -1314,11 +1320,11 @@ static bool get_audio_and_video_packets(struct obs_output *output,
 
 static bool initialize_interleaved_packets(struct obs_output *output)
 {
-	struct encoder_packet *video;
-	struct encoder_packet *audio[MAX_AUDIO_MIXES];
-	struct encoder_packet *last_audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet *video;
+	struct interleaved_packet *audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet *last_audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet *start;
 	size_t audio_mixes = num_audio_mixes(output);
-	size_t start_idx;
 
 	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
 		return false;
@@ -1329,29 +1335,29 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 
 	/* ensure that there is audio past the first video packet */
 	for (size_t i = 0; i < audio_mixes; i++) {
-		if (last_audio[i]->dts_usec < video->dts_usec) {
+		if (last_audio[i]->packet.dts_usec < video->packet.dts_usec) {
 			output->received_audio = false;
 			return false;
 		}
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
+	start = get_interleaved_start(output);
+	if (start && start != first_interleaved_packet(output, NULL)) {
+		discard_interleaved_packets(output, start, false);
 		if (!get_audio_and_video_packets(output, &video, audio,
 					audio_mixes))
 			return false;
 	}
 
 	/* get new offsets */
-	output->video_offset = video->pts;
+	output->video_offset = video->packet.pts;
 	for (size_t i = 0; i < audio_mixes; i++)
-		output->audio_offsets[i] = audio[i]->dts;
+		output->audio_offsets[i] = audio[i]->packet.dts;
 
 #if DEBUG_STARTING_PACKETS == 1
-	int64_t v = video->dts_usec;
-	int64_t a = audio[0]->dts_usec;
+	int64_t v = video->packet.dts_usec;
+	int64_t a = audio[0]->packet.dts_usec;
 	int64_t diff = v - a;
 
 	blog(LOG_DEBUG, "output '%s' offset for video: %lld, audio: %lld, "
@@ -1360,67 +1366,35 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 #endif
 
 	/* subtract offsets from highest TS offset variables */
-	output->highest_audio_ts -= audio[0]->dts_usec;
-	output->highest_video_ts -= video->dts_usec;
-
-	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
-	}
+	output->highest_audio_ts -= audio[0]->packet.dts_usec;
+	output->highest_video_ts -= video->packet.dts_usec;
 
-	return true;
-}
-
-static inline void insert_interleaved_packet(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
+	/* apply new offsets to all existing packet DTS/PTS values.  each
+	 * track is offset as a whole, so the queues stay sorted */
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &output->interleave_queues[i];
 
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
+		for (size_t j = queue->head; j < queue->packets.num; j++)
+			apply_interleaved_packet_offset(output,
+					&queue->packets.array[j].packet);
 	}
 
-	da_insert(output->interleaved_packets, idx, out);
-}
-
-static void resort_interleaved_packets(struct obs_output *output)
-{
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-			sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
+	return true;
 }
 
 static void discard_unused_audio_packets(struct obs_output *output,
 		int64_t dts_usec)
 {
-	size_t idx = 0;
+	struct interleave_queue *queue;
+	struct interleaved_packet *packet;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
+	while ((packet = first_interleaved_packet(output, &queue)) != NULL) {
+		if (packet->packet.dts_usec >= dts_usec)
 			break;
-	}
 
-	if (idx)
-		discard_to_idx(output, idx);
+		obs_encoder_packet_release(&packet->packet);
+		interleave_queue_pop(queue);
+	}
 }
 
 static void interleave_packets(void *data, struct encoder_packet *packet)
@@ -1454,7 +1428,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -1469,10 +1443,8 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->received_audio && output->received_video) {
 		if (!was_started) {
 			if (prune_interleaved_packets(output)) {
-				if (initialize_interleaved_packets(output)) {
-					resort_interleaved_packets(output);
+				if (initialize_interleaved_packets(output))
 					send_interleaved(output);
-				}
 			}
 		} else {
 			send_interleaved(output);
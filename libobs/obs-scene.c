@@ -18,6 +18,7 @@
 
 #include "util/threading.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-math.h"
 #include "obs-scene.h"
 
 const struct obs_source_info group_info;
@@ -235,6 +236,8 @@ static inline void detach_sceneitem(struct obs_scene_item *item)
 		item->next->prev = item->prev;
 
 	item->parent = NULL;
+
+	obs_invalidate_audio_graph();
 }
 
 static inline void attach_sceneitem(struct obs_scene *parent,
@@ -254,6 +257,8 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 			parent->first_item->prev = item;
 		parent->first_item = item;
 	}
+
+	obs_invalidate_audio_graph();
 }
 
 void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy)
@@ -685,6 +690,9 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	item->user_visible = vis;
 
 	pthread_mutex_unlock(&item->actions_mutex);
+
+	/* active_refs changed after the active child was added/removed */
+	obs_invalidate_audio_graph();
 }
 
 static void scene_load(void *data, obs_data_t *settings);
@@ -1023,27 +1031,16 @@ static void process_all_audio_actions(struct obs_scene_item *item,
 	while (apply_scene_item_volume(item, NULL, 0, sample_rate));
 }
 
-static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
-		size_t pos, size_t count)
+static inline void mix_audio_with_buf(float *p_out, float *p_in,
+		float *buf_in, size_t pos, size_t count)
 {
-	register float *out = p_out;
-	register float *buf = buf_in + pos;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
+	audio_mix_buf(p_out, p_in + pos, buf_in + pos, count);
 }
 
 static inline void mix_audio(float *p_out, float *p_in,
 		size_t pos, size_t count)
 {
-	register float *out = p_out;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	audio_mix(p_out, p_in + pos, count);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -1088,6 +1085,7 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 	while (item) {
 		uint64_t source_ts;
 		size_t pos, count;
+		uint32_t child_mixers;
 		bool apply_buf;
 
 		apply_buf = apply_scene_item_volume(item, &buf, timestamp,
@@ -1113,9 +1111,14 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 			continue;
 		}
 
+		/* the child's output for mixes it isn't assigned to is
+		 * silence, so skip those entirely */
+		child_mixers = mixers &
+			obs_source_get_audio_mixers(item->source);
+
 		obs_source_get_audio_mix(item->source, &child_audio);
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((child_mixers & (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
@@ -1146,7 +1149,8 @@ const struct obs_source_info scene_info =
 	.type          = OBS_SOURCE_TYPE_SCENE,
 	.output_flags  = OBS_SOURCE_VIDEO |
 	                 OBS_SOURCE_CUSTOM_DRAW |
-	                 OBS_SOURCE_COMPOSITE,
+	                 OBS_SOURCE_COMPOSITE |
+	                 OBS_SOURCE_PARALLEL_AUDIO_RENDER,
 	.get_name      = scene_getname,
 	.create        = scene_create,
 	.destroy       = scene_destroy,
@@ -1167,7 +1171,8 @@ const struct obs_source_info group_info =
 	.type          = OBS_SOURCE_TYPE_SCENE,
 	.output_flags  = OBS_SOURCE_VIDEO |
 	                 OBS_SOURCE_CUSTOM_DRAW |
-	                 OBS_SOURCE_COMPOSITE,
+	                 OBS_SOURCE_COMPOSITE |
+	                 OBS_SOURCE_PARALLEL_AUDIO_RENDER,
 	.get_name      = group_getname,
 	.create        = scene_create,
 	.destroy       = scene_destroy,
@@ -1689,6 +1694,8 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene,
 
 	full_unlock(scene);
 
+	obs_invalidate_audio_graph();
+
 	if (!scene->source->context.private)
 		init_hotkeys(scene, item, obs_source_get_name(source));
 
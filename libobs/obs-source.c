@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-math.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "callback/calldata.h"
@@ -115,6 +116,20 @@ static void allocate_audio_output_buffer(struct obs_source *source)
 	}
 }
 
+/* how much audio a source can queue for the audio thread */
+#define AUDIO_RING_SECONDS 1
+
+static void allocate_audio_ring(struct obs_source *source)
+{
+	audio_t *audio = obs->audio.audio;
+	size_t channels = audio ? audio_output_get_channels(audio) : 2;
+	size_t sample_rate = audio ? audio_output_get_sample_rate(audio) :
+		48000;
+
+	spsc_ring_init(&source->audio_ring, AUDIO_RING_SECONDS *
+			sample_rate * channels * sizeof(float));
+}
+
 static inline bool is_async_video_source(const struct obs_source *source)
 {
 	return (source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) ==
@@ -147,6 +162,7 @@ bool obs_source_init(struct obs_source *source)
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
+	pthread_mutex_init_value(&source->audio_levels_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -160,6 +176,8 @@ bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->audio_cb_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->audio_levels_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->audio_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
@@ -179,6 +197,8 @@ bool obs_source_init(struct obs_source *source)
 	source->audio_mixers = 0xFF;
 
 	if (is_audio_source(source)) {
+		allocate_audio_ring(source);
+
 		pthread_mutex_lock(&obs->data.audio_sources_mutex);
 
 		source->next_audio_source = obs->data.first_audio_source;
@@ -190,6 +210,8 @@ bool obs_source_init(struct obs_source *source)
 		obs->data.first_audio_source = source;
 
 		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+
+		obs_invalidate_audio_graph();
 	}
 
 	source->private_settings = obs_data_create();
@@ -520,6 +542,40 @@ static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 		obs_source_frame_destroy(frame);
 }
 
+/* hands the data of a frame from obs_source_output_video_nocopy back to the
+ * source, only the frame structure itself is owned by libobs */
+static inline void release_nocopy_frame(struct async_frame *af)
+{
+	af->release(af->release_param);
+	bfree(af->frame);
+}
+
+/* hands every queued frame back before the source's destroy callback runs,
+ * the release callbacks of no-copy frames may use the source's data */
+static void release_async_frames(struct obs_source *source)
+{
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+
+		if (af->release)
+			release_nocopy_frame(af);
+		else
+			obs_source_frame_decref(af->frame);
+	}
+
+	da_resize(source->async_cache, 0);
+	da_resize(source->async_frames, 0);
+	source->cur_async_frame = NULL;
+	source->prev_async_frame = NULL;
+
+	/* frames output from now on are released right away */
+	source->async_nocopy_closed = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 		obs_source_t *filter);
 
@@ -542,6 +598,8 @@ void obs_source_destroy(struct obs_source *source)
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 
+	obs_invalidate_audio_graph();
+
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
 
@@ -556,6 +614,8 @@ void obs_source_destroy(struct obs_source *source)
 
 	obs_source_dosignal(source, "source_destroy", "destroy");
 
+	release_async_frames(source);
+
 	if (source->context.data) {
 		source->info.destroy(source->context.data);
 		source->context.data = NULL;
@@ -567,6 +627,8 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	/* only copied frames output while the source was being destroyed can
+	 * be left here */
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -585,8 +647,15 @@ void obs_source_destroy(struct obs_source *source)
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
 		bfree(source->audio_data.data[i]);
+	for (i = 0; i < source->audio_filter_blocks.num; i++) {
+		bfree(source->audio_filter_blocks.array[i]->mem);
+		bfree(source->audio_filter_blocks.array[i]);
+	}
+	da_free(source->audio_filter_blocks);
 	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		circlebuf_free(&source->audio_input_buf[i]);
+	spsc_ring_free(&source->audio_ring);
+	bfree(source->audio_ring_buf);
 	audio_resampler_destroy(source->resampler);
 	bfree(source->audio_output_buf[0][0]);
 
@@ -597,6 +666,7 @@ void obs_source_destroy(struct obs_source *source)
 
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
+	da_free(source->audio_levels_cbs);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
 	da_free(source->filters);
@@ -604,6 +674,7 @@ void obs_source_destroy(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_actions_mutex);
 	pthread_mutex_destroy(&source->audio_buf_mutex);
 	pthread_mutex_destroy(&source->audio_cb_mutex);
+	pthread_mutex_destroy(&source->audio_levels_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
 	obs_data_release(source->private_settings);
@@ -1108,7 +1179,34 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 	source->timing_adjust = os_time - timestamp;
 }
 
-static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+/*
+ * Audio is handed to the audio thread through source->audio_ring as a
+ * sequence of records, each a header optionally followed by one plane of
+ * floats per channel.  Writers hold audio_buf_mutex, so that the ring only
+ * ever sees one producer; the audio thread is the only consumer and the only
+ * thread that touches audio_ts and audio_input_buf.
+ */
+
+enum audio_ring_type {
+	AUDIO_RING_DATA,
+	AUDIO_RING_RESET,
+};
+
+struct audio_ring_header {
+	uint64_t timestamp;
+	uint32_t frames;
+	uint32_t channels;
+	uint8_t  type;
+	bool     push_back;
+};
+
+/* large chunks are split so that the audio thread's copy stays small */
+#define AUDIO_RING_MAX_FRAMES (AUDIO_OUTPUT_FRAMES * 4)
+
+/* space kept free for resets, so that they are never lost to a full ring */
+#define AUDIO_RING_RESERVE (sizeof(struct audio_ring_header) * 8)
+
+static void clear_audio_input(obs_source_t *source, uint64_t timestamp)
 {
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		if (source->audio_input_buf[i].size)
@@ -1117,8 +1215,31 @@ static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 	}
 
 	source->last_audio_input_buf_size = 0;
-	source->audio_ts = os_time;
+	source->audio_ts = timestamp;
+}
+
+/* call with audio_buf_mutex locked */
+static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+{
+	struct audio_ring_header header = {
+		.timestamp = os_time,
+		.type      = AUDIO_RING_RESET
+	};
+
 	source->next_audio_sys_ts_min = os_time;
+
+	if (!source->audio_ring.capacity)
+		return;
+
+	if (spsc_ring_write_avail(&source->audio_ring) < sizeof(header)) {
+		blog(LOG_WARNING, "Source '%s' audio queue is full, could "
+		                  "not reset its audio",
+		                  source->context.name);
+		return;
+	}
+
+	spsc_ring_write(&source->audio_ring, &header, sizeof(header));
+	spsc_ring_commit_write(&source->audio_ring);
 }
 
 static void handle_ts_jump(obs_source_t *source, uint64_t expected,
@@ -1166,7 +1287,7 @@ static void source_output_audio_place(obs_source_t *source,
 	size_t size = in->frames * sizeof(float);
 
 	if (!source->audio_ts || in->timestamp < source->audio_ts)
-		reset_audio_data(source, in->timestamp);
+		clear_audio_input(source, in->timestamp);
 
 	buf_placement = get_buf_placement(audio,
 			in->timestamp - source->audio_ts) * sizeof(float);
@@ -1215,6 +1336,113 @@ static inline void source_output_audio_push_back(obs_source_t *source,
 	source->last_audio_input_buf_size = 0;
 }
 
+/* call with audio_buf_mutex locked */
+static void queue_audio_data(obs_source_t *source, const struct audio_data *in,
+		bool push_back)
+{
+	struct spsc_ring *ring = &source->audio_ring;
+	size_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	size_t records = (in->frames + AUDIO_RING_MAX_FRAMES - 1) /
+		AUDIO_RING_MAX_FRAMES;
+	size_t size = records * sizeof(struct audio_ring_header) +
+		in->frames * channels * sizeof(float);
+	uint32_t offset = 0;
+
+	if (!ring->capacity || !in->frames)
+		return;
+
+	/* if the audio thread falls this far behind, the data would be
+	 * discarded as out of date anyway */
+	if (spsc_ring_write_avail(ring) < size + AUDIO_RING_RESERVE) {
+		if (!source->audio_ring_full)
+			blog(LOG_WARNING, "Source '%s' audio queue is full, "
+			                  "dropping audio",
+			                  source->context.name);
+		source->audio_ring_full = true;
+		return;
+	}
+
+	source->audio_ring_full = false;
+
+	while (offset < in->frames) {
+		struct audio_ring_header header = {
+			.timestamp = in->timestamp +
+				conv_frames_to_time(sample_rate, offset),
+			.frames    = in->frames - offset,
+			.channels  = (uint32_t)channels,
+			.type      = AUDIO_RING_DATA,
+			.push_back = push_back || offset > 0
+		};
+
+		if (header.frames > AUDIO_RING_MAX_FRAMES)
+			header.frames = AUDIO_RING_MAX_FRAMES;
+
+		spsc_ring_write(ring, &header, sizeof(header));
+		for (size_t ch = 0; ch < channels; ch++)
+			spsc_ring_write(ring, in->data[ch] + offset *
+					sizeof(float),
+					header.frames * sizeof(float));
+
+		offset += header.frames;
+	}
+
+	spsc_ring_commit_write(ring);
+}
+
+/* audio thread: moves queued audio in to audio_input_buf */
+static void drain_audio_ring(obs_source_t *source)
+{
+	struct spsc_ring *ring = &source->audio_ring;
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	struct audio_ring_header header;
+
+	while (spsc_ring_read_avail(ring) >= sizeof(header)) {
+		struct audio_data in = {0};
+		size_t size;
+
+		spsc_ring_read(ring, &header, sizeof(header));
+
+		if (header.type == AUDIO_RING_RESET) {
+			clear_audio_input(source, header.timestamp);
+			spsc_ring_commit_read(ring);
+			continue;
+		}
+
+		size = header.frames * sizeof(float);
+
+		/* queued before an audio reset changed the channel count */
+		if (header.channels != channels) {
+			spsc_ring_read(ring, NULL, size * header.channels);
+			spsc_ring_commit_read(ring);
+			continue;
+		}
+
+		if (!source->audio_ring_buf)
+			source->audio_ring_buf = bmalloc(sizeof(float) *
+					AUDIO_RING_MAX_FRAMES *
+					MAX_AUDIO_CHANNELS);
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *plane = source->audio_ring_buf +
+				ch * AUDIO_RING_MAX_FRAMES;
+
+			spsc_ring_read(ring, plane, size);
+			in.data[ch] = (uint8_t*)plane;
+		}
+
+		spsc_ring_commit_read(ring);
+
+		in.frames = header.frames;
+		in.timestamp = header.timestamp;
+
+		if (header.push_back && source->audio_ts)
+			source_output_audio_push_back(source, &in);
+		else
+			source_output_audio_place(source, &in);
+	}
+}
+
 static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 {
 	if (source->push_to_mute_enabled && source->user_push_to_mute_pressed)
@@ -1245,6 +1473,7 @@ static void source_output_audio_data(obs_source_t *source,
 	int64_t sync_offset;
 	bool using_direct_ts = false;
 	bool push_back = false;
+	bool muted;
 
 	/* detects 'directly' set timestamps as long as they're within
 	 * a certain threshold */
@@ -1311,16 +1540,14 @@ static void source_output_audio_data(obs_source_t *source,
 		source->last_sync_offset = sync_offset;
 	}
 
-	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
-		if (push_back && source->audio_ts)
-			source_output_audio_push_back(source, &in);
-		else
-			source_output_audio_place(source, &in);
-	}
+	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY)
+		queue_audio_data(source, &in, push_back);
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
-	source_signal_audio_data(source, data, source_muted(source, os_time));
+	muted = source_muted(source, os_time);
+	obs_source_measure_audio_levels(source, data, muted);
+	source_signal_audio_data(source, data, muted);
 }
 
 enum convert_type {
@@ -1996,6 +2223,59 @@ obs_source_t *obs_filter_get_target(const obs_source_t *filter)
 		filter->filter_target : NULL;
 }
 
+/* blocks are kept for the life of the parent and handed out again every time
+ * its audio is filtered, so a filter chain does not allocate once the blocks
+ * are large enough.  always called with the parent's filter_mutex locked */
+struct obs_audio_data *obs_filter_get_audio_block(obs_source_t *filter,
+		uint32_t frames)
+{
+	struct audio_filter_block *block;
+	obs_source_t *parent;
+	size_t planes;
+	size_t plane_size;
+
+	if (!obs_source_valid(filter, "obs_filter_get_audio_block"))
+		return NULL;
+
+	parent = filter->filter_parent;
+	if (!parent) {
+		blog(LOG_WARNING, "obs_filter_get_audio_block: '%s' is not a "
+				"filter of a source", filter->context.name);
+		return NULL;
+	}
+
+	if (parent->audio_filter_blocks_used ==
+			parent->audio_filter_blocks.num) {
+		block = bzalloc(sizeof(*block));
+		da_push_back(parent->audio_filter_blocks, &block);
+	}
+
+	block = parent->audio_filter_blocks.array[
+		parent->audio_filter_blocks_used++];
+
+	planes = audio_output_get_planes(obs->audio.audio);
+
+	/* keep every plane 32 byte aligned */
+	frames = (frames + 7) & ~7;
+	plane_size = (size_t)frames *
+		audio_output_get_block_size(obs->audio.audio);
+
+	if (block->capacity < frames) {
+		bfree(block->mem);
+		block->mem = bmalloc(plane_size * planes);
+		block->capacity = frames;
+	} else {
+		plane_size = (size_t)block->capacity *
+			audio_output_get_block_size(obs->audio.audio);
+	}
+
+	memset(&block->audio, 0, sizeof(block->audio));
+	for (size_t i = 0; i < planes; i++)
+		block->audio.data[i] = block->mem + plane_size * i;
+
+	return &block->audio;
+}
+
 static bool filter_compatible(obs_source_t *source, obs_source_t *filter)
 {
 	uint32_t s_caps = source->info.output_flags;
@@ -2330,10 +2610,27 @@ static inline bool async_texture_changed(struct obs_source *source,
 
 static inline void free_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+
+		if (af->release) {
+			/* frames still held by the renderer are released
+			 * once it lets go of them */
+			if (!af->used)
+				continue;
+
+			af->used = false;
+			if (os_atomic_dec_long(&af->frame->refs) != 0)
+				continue;
+
+			release_nocopy_frame(af);
+		} else {
+			obs_source_frame_decref(af->frame);
+		}
+
+		da_erase(source->async_cache, i - 1);
+	}
 
-	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
@@ -2347,7 +2644,7 @@ static void clean_cache(obs_source_t *source)
 {
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
+		if (!af->used && !af->release) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
 				obs_source_frame_destroy(af->frame);
 				da_erase(source->async_cache, i - 1);
@@ -2357,19 +2654,16 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *cache_video(struct obs_source *source,
+
+/* call with async_mutex locked.  returns false if the queued frames have been
+ * flushed because too many have piled up */
+static bool prepare_async_cache(struct obs_source *source,
 		const struct obs_source_frame *frame)
 {
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
-
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -2380,9 +2674,25 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 		source->async_cache_full_range = frame->full_range;
 	}
 
+	return true;
+}
+
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline struct obs_source_frame *cache_video(struct obs_source *source,
+		const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!prepare_async_cache(source, frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return NULL;
+	}
+
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->release) {
 			new_frame = af->frame;
 			af->used = true;
 			af->unused_count = 0;
@@ -2401,6 +2711,8 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.release = NULL;
+		new_af.release_param = NULL;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -2459,6 +2771,32 @@ void obs_source_output_video(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+static void frame2_to_frame(struct obs_source_frame *dst,
+		const struct obs_source_frame2 *src)
+{
+	enum video_range_type range = resolve_video_range(src->format,
+			src->range);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		dst->data[i] = src->data[i];
+		dst->linesize[i] = src->linesize[i];
+	}
+
+	dst->width = src->width;
+	dst->height = src->height;
+	dst->timestamp = src->timestamp;
+	dst->format = src->format;
+	dst->full_range = range == VIDEO_RANGE_FULL;
+	dst->flip = src->flip;
+
+	memcpy(&dst->color_matrix, &src->color_matrix,
+			sizeof(src->color_matrix));
+	memcpy(&dst->color_range_min, &src->color_range_min,
+			sizeof(src->color_range_min));
+	memcpy(&dst->color_range_max, &src->color_range_max,
+			sizeof(src->color_range_max));
+}
+
 void obs_source_output_video2(obs_source_t *source,
 		const struct obs_source_frame2 *frame)
 {
@@ -2468,29 +2806,59 @@ void obs_source_output_video2(obs_source_t *source,
 	}
 
 	struct obs_source_frame new_frame;
-	enum video_range_type range = resolve_video_range(frame->format,
-			frame->range);
+	frame2_to_frame(&new_frame, frame);
 
-	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-		new_frame.data[i] = frame->data[i];
-		new_frame.linesize[i] = frame->linesize[i];
+	obs_source_output_video_internal(source, &new_frame);
+}
+
+void obs_source_output_video_nocopy(obs_source_t *source,
+		const struct obs_source_frame2 *frame,
+		obs_source_frame_release_cb release, void *param)
+{
+	struct obs_source_frame *new_frame;
+	struct async_frame new_af;
+
+	if (!obs_ptr_valid(release, "obs_source_output_video_nocopy"))
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video_nocopy")) {
+		release(param);
+		return;
 	}
 
-	new_frame.width = frame->width;
-	new_frame.height = frame->height;
-	new_frame.timestamp = frame->timestamp;
-	new_frame.format = frame->format;
-	new_frame.full_range = range == VIDEO_RANGE_FULL;
-	new_frame.flip = frame->flip;
+	if (!frame) {
+		obs_source_output_video_internal(source, NULL);
+		release(param);
+		return;
+	}
 
-	memcpy(&new_frame.color_matrix, &frame->color_matrix,
-			sizeof(frame->color_matrix));
-	memcpy(&new_frame.color_range_min, &frame->color_range_min,
-			sizeof(frame->color_range_min));
-	memcpy(&new_frame.color_range_max, &frame->color_range_max,
-			sizeof(frame->color_range_max));
+	new_frame = bzalloc(sizeof(*new_frame));
+	frame2_to_frame(new_frame, frame);
 
-	obs_source_output_video_internal(source, &new_frame);
+	/* the reference held by the cache, dropped once the frame is no
+	 * longer queued or displayed */
+	new_frame->refs = 1;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_nocopy_closed ||
+	    !prepare_async_cache(source, new_frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		release(param);
+		bfree(new_frame);
+		return;
+	}
+
+	new_af.frame = new_frame;
+	new_af.used = true;
+	new_af.unused_count = 0;
+	new_af.release = release;
+	new_af.release_param = param;
+
+	da_push_back(source->async_cache, &new_af);
+	da_push_back(source->async_frames, &new_frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
 }
 
 static inline bool preload_frame_changed(obs_source_t *source,
@@ -2682,25 +3050,15 @@ static void copy_audio_data(obs_source_t *source,
 		source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
 static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
 	float **data = (float**)source->audio_data.data;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
-
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
+	audio_downmix(data[0], (const float *const *)data, channels, frames);
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
-	}
+	for (size_t channel = 1; channel < channels; channel++)
+		memcpy(data[channel], data[0], frames * sizeof(float));
 }
 
 static void process_audio_balancing(struct obs_source *source, uint32_t frames,
@@ -2710,24 +3068,17 @@ static void process_audio_balancing(struct obs_source *source, uint32_t frames,
 
 	switch(type) {
 	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] *
-				sinf((1.0f - balance) * (M_PI/2.0f));
-			data[1][frame] = data[1][frame] *
-				sinf(balance * (M_PI/2.0f));
-		}
+		audio_scale(data[0], sinf((1.0f - balance) * (M_PI/2.0f)),
+				frames);
+		audio_scale(data[1], sinf(balance * (M_PI/2.0f)), frames);
 		break;
 	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
+		audio_scale(data[0], sqrtf(1.0f - balance), frames);
+		audio_scale(data[1], sqrtf(balance), frames);
 		break;
 	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
+		audio_scale(data[0], 1.0f - balance, frames);
+		audio_scale(data[1], balance, frames);
 		break;
 	default:
 		break;
@@ -2790,6 +3141,7 @@ void obs_source_output_audio(obs_source_t *source,
 	process_audio(source, audio);
 
 	pthread_mutex_lock(&source->filter_mutex);
+	source->audio_filter_blocks_used = 0;
 	output = filter_async_audio(source, &source->audio_data);
 
 	if (output) {
@@ -2817,13 +3169,41 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *f = &source->async_cache.array[i];
 
-		if (f->frame == frame) {
-			f->used = false;
-			break;
+		if (f->frame != frame)
+			continue;
+
+		/* source-owned frames can't be reused, so drop the cache's
+		 * reference and hand them back once nothing else uses them */
+		if (f->release && f->used) {
+			if (os_atomic_dec_long(&frame->refs) == 0) {
+				release_nocopy_frame(f);
+				da_erase(source->async_cache, i);
+				return;
+			}
 		}
+
+		f->used = false;
+		break;
 	}
 }
 
+/* call with async_mutex locked, after the last reference has been released */
+static void destroy_async_frame(obs_source_t *source,
+		struct obs_source_frame *frame)
+{
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *f = &source->async_cache.array[i];
+
+		if (f->frame == frame && f->release) {
+			release_nocopy_frame(f);
+			da_erase(source->async_cache, i);
+			return;
+		}
+	}
+
+	obs_source_frame_destroy(frame);
+}
+
 /* #define DEBUG_ASYNC_FRAMES 1 */
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
@@ -2973,7 +3353,7 @@ void obs_source_release_frame(obs_source_t *source,
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			destroy_async_frame(source, frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3458,6 +3838,7 @@ bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
 		obs_source_activate(child, type);
 	}
 
+	obs_invalidate_audio_graph();
 	return true;
 }
 
@@ -3473,6 +3854,8 @@ void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
 		type = (i < parent->activate_refs) ? MAIN_VIEW : AUX_VIEW;
 		obs_source_deactivate(child, type);
 	}
+
+	obs_invalidate_audio_graph();
 }
 
 void obs_source_save(obs_source_t *source)
@@ -3950,24 +4333,16 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 		size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	audio_scale(source->audio_output_buf[mix][0], vol,
+			AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 		size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_scale_buf(source->audio_output_buf[mix][ch], vol_data,
+				AUDIO_OUTPUT_FRAMES);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -4125,11 +4500,8 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		uint32_t mixers, size_t channels, size_t sample_rate,
 		size_t size)
 {
-	pthread_mutex_lock(&source->audio_buf_mutex);
-
 	if (source->audio_input_buf[0].size < size) {
 		source->audio_pending = true;
-		pthread_mutex_unlock(&source->audio_buf_mutex);
 		return;
 	}
 
@@ -4138,8 +4510,6 @@ static inline void process_audio_source_tick(obs_source_t *source,
 				source->audio_output_buf[0][ch],
 				size);
 
-	pthread_mutex_unlock(&source->audio_buf_mutex);
-
 	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
 
@@ -4176,6 +4546,8 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		return;
 	}
 
+	drain_audio_ring(source);
+
 	if (!source->audio_ts) {
 		source->audio_pending = true;
 		return;
@@ -4256,12 +4628,20 @@ void obs_source_set_monitoring_type(obs_source_t *source,
 	now_on = type != OBS_MONITORING_TYPE_NONE;
 
 	if (was_on != now_on) {
-		if (!was_on) {
-			source->monitor = audio_monitor_create(source);
-		} else {
-			audio_monitor_destroy(source->monitor);
-			source->monitor = NULL;
-		}
+		struct audio_monitor *old_monitor = NULL;
+		struct audio_monitor *new_monitor = NULL;
+
+		if (!was_on)
+			new_monitor = audio_monitor_create(source);
+
+		/* swap under the monitoring mutex so that stats queries never
+		 * see a monitor that is being destroyed */
+		pthread_mutex_lock(&obs->audio.monitoring_mutex);
+		old_monitor = source->monitor;
+		source->monitor = new_monitor;
+		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+		audio_monitor_destroy(old_monitor);
 	}
 
 	source->monitoring_type = type;
@@ -4274,6 +4654,26 @@ enum obs_monitoring_type obs_source_get_monitoring_type(
 		source->monitoring_type : OBS_MONITORING_TYPE_NONE;
 }
 
+bool obs_source_get_audio_monitoring_stats(const obs_source_t *source,
+		struct obs_audio_monitoring_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_audio_monitoring_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_source_get_audio_monitoring_stats"))
+		return false;
+
+	bool success = false;
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	if (source->monitor)
+		success = audio_monitor_get_stats(source->monitor, stats);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	return success;
+}
+
 void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered)
 {
 	if (!obs_source_valid(source, "obs_source_set_async_unbuffered"))
@@ -140,6 +140,42 @@ enum obs_balance_type {
  */
 #define OBS_SOURCE_CAP_DISABLED (1<<10)
 
+/**
+ * Source must be ticked even when it is not shown or active
+ *
+ * By default, video_tick is only called for sources that are currently shown
+ * or active somewhere (and for filters of such sources).  Specify this flag
+ * if the source needs to keep doing work in video_tick while hidden.
+ *
+ * Async video sources are always ticked.
+ */
+#define OBS_SOURCE_TICK_WHEN_HIDDEN (1<<11)
+
+/**
+ * Source can be ticked from a thread other than the graphics thread
+ *
+ * Sources are ticked one after another on the graphics thread by default.
+ * With this flag, video_tick may be called from a worker thread at the same
+ * time as the video_tick of other sources, so it must not enter the graphics
+ * context or touch state shared with other sources without locking it.
+ *
+ * Ignored for scenes, transitions and composite sources.
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1<<12)
+
+/**
+ * Source's audio can be rendered on a thread other than the audio thread
+ *
+ * The audio_render callbacks of sources are called on the audio thread, one
+ * after another, by default.  With this flag, audio_render may be called
+ * from a worker thread at the same time as the audio of other sources is
+ * rendered, so it must lock any state it shares with other sources.  The
+ * audio of its children is always rendered before its own.
+ *
+ * Only affects sources with an audio_render callback.
+ */
+#define OBS_SOURCE_PARALLEL_AUDIO_RENDER (1<<13)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -308,7 +344,10 @@ struct obs_source_info {
 	 *                data for later if time is needed for processing.  If
 	 *                you are returning new data, that data must exist
 	 *                until the next call to the filter_audio callback or
-	 *                until the filter is removed/destroyed.
+	 *                until the filter is removed/destroyed.  New data
+	 *                can be written to a block from
+	 *                obs_filter_get_audio_block instead of a buffer of
+	 *                the filter's own.
 	 */
 	struct obs_audio_data *(*filter_audio)(void *data,
 			struct obs_audio_data *audio);
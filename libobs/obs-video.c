@@ -24,12 +24,166 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 
+#define NBSP "\xC2\xA0"
+
+/* below this many sources it's cheaper to just tick on the graphics thread
+ * than to wake up the tick threads */
+#define MIN_PARALLEL_TICK_SOURCES 8
+
+static inline bool source_has_refs(const struct obs_source *source)
+{
+	return os_atomic_load_long(&source->show_refs) > 0 ||
+	       os_atomic_load_long(&source->activate_refs) > 0 ||
+	       source->showing || source->active;
+}
+
+/* sources that are neither shown nor active anywhere don't need to be ticked,
+ * unless they still need to process a pending update, consume async frames,
+ * or have explicitly asked to keep ticking while hidden */
+static inline bool source_needs_tick(const struct obs_source *source)
+{
+	const struct obs_source *parent = source->filter_parent;
+	const uint32_t flags = source->info.output_flags;
+
+	if ((flags & (OBS_SOURCE_ASYNC | OBS_SOURCE_TICK_WHEN_HIDDEN)) != 0)
+		return true;
+	if (source->defer_update || source_has_refs(source))
+		return true;
+
+	/* filters are not part of the active tree, so they follow their
+	 * parent instead */
+	return parent && source_has_refs(parent);
+}
+
+/* sources are ticked in order on the graphics thread unless they opted in to
+ * parallel ticking.  scenes, groups and transitions change the show/active
+ * state of their children when ticked, so they are always ticked serially,
+ * before anything else is */
+static inline bool source_tick_serial(const struct obs_source *source)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	return source->info.type == OBS_SOURCE_TYPE_SCENE ||
+	       source->info.type == OBS_SOURCE_TYPE_TRANSITION ||
+	       (flags & OBS_SOURCE_COMPOSITE) != 0 ||
+	       (flags & OBS_SOURCE_PARALLEL_TICK) == 0;
+}
+
+static void tick_parallel_sources(struct obs_core_video *video)
+{
+	for (;;) {
+		size_t idx = (size_t)(os_atomic_inc_long(&video->tick_next) - 1);
+		if (idx >= video->tick_parallel.num)
+			break;
+
+		obs_source_video_tick(video->tick_parallel.array[idx],
+				video->tick_seconds);
+	}
+}
+
+static void *tick_thread(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+	const char *tick_thread_name = param;
+
+	os_set_thread_name("libobs: tick thread");
+	profile_register_root(tick_thread_name,
+			video_output_get_frame_time(video->video));
+
+	while (os_sem_wait(video->tick_start_sem) == 0) {
+		if (video->tick_stop)
+			break;
+
+		profile_start(tick_thread_name);
+		tick_parallel_sources(video);
+		profile_end(tick_thread_name);
+
+		profile_reenable_thread();
+
+		os_sem_post(video->tick_done_sem);
+	}
+
+	return NULL;
+}
+
+static void stop_tick_threads(struct obs_core_video *video)
+{
+	video->tick_stop = true;
+
+	for (size_t i = 0; i < video->num_tick_threads; i++)
+		os_sem_post(video->tick_start_sem);
+	for (size_t i = 0; i < video->num_tick_threads; i++)
+		pthread_join(video->tick_threads[i], NULL);
+
+	os_sem_destroy(video->tick_start_sem);
+	os_sem_destroy(video->tick_done_sem);
+	video->tick_start_sem = NULL;
+	video->tick_done_sem = NULL;
+	video->num_tick_threads = 0;
+}
+
+/* the workers are only started once enough sources that opted in to parallel
+ * ticking are being ticked, most setups never need them */
+static void init_tick_threads(struct obs_core_video *video)
+{
+	size_t num_threads = (size_t)os_get_logical_cores() / 4;
+
+	if (num_threads > MAX_TICK_THREADS)
+		num_threads = MAX_TICK_THREADS;
+
+	video->tick_threads_started = true;
+	video->tick_stop = false;
+	video->num_tick_threads = 0;
+
+	if (!num_threads)
+		return;
+	if (os_sem_init(&video->tick_start_sem, 0) != 0)
+		goto fail;
+	if (os_sem_init(&video->tick_done_sem, 0) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		const char *name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"tick_sources(worker" NBSP "%d)", (int)i);
+
+		if (pthread_create(&video->tick_threads[i], NULL,
+					tick_thread, (void*)name) != 0)
+			goto fail;
+
+		video->num_tick_threads++;
+	}
+
+	return;
+
+fail:
+	blog(LOG_WARNING, "init_tick_threads: Failed to start tick threads, "
+			"ticking all sources on the graphics thread");
+	stop_tick_threads(video);
+}
+
+void obs_free_tick_threads(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	stop_tick_threads(video);
+	video->tick_threads_started = false;
+
+	da_free(video->tick_serial);
+	da_free(video->tick_parallel);
+}
+
+static const char *tick_serial_sources_name = "tick_serial_sources";
+static const char *tick_parallel_sources_name = "tick_parallel_sources";
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
-	struct obs_core_data *data = &obs->data;
-	struct obs_source    *source;
-	uint64_t             delta_time;
-	float                seconds;
+	struct obs_core_data  *data = &obs->data;
+	struct obs_core_video *video = &obs->video;
+	struct obs_source     *source;
+	uint64_t              delta_time;
+	float                 seconds;
+	size_t                num_threads = 0;
 
 	if (!last_time)
 		last_time = cur_time -
@@ -52,7 +206,7 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
 
 	/* ------------------------------------- */
-	/* call the tick function of each source */
+	/* gather the sources that need ticking  */
 
 	pthread_mutex_lock(&data->sources_mutex);
 
@@ -61,14 +215,59 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 		struct obs_source *cur_source = obs_source_get_ref(source);
 		source = (struct obs_source*)source->context.next;
 
-		if (cur_source) {
-			obs_source_video_tick(cur_source, seconds);
+		if (!cur_source)
+			continue;
+
+		if (!source_needs_tick(cur_source))
 			obs_source_release(cur_source);
-		}
+		else if (source_tick_serial(cur_source))
+			da_push_back(video->tick_serial, &cur_source);
+		else
+			da_push_back(video->tick_parallel, &cur_source);
 	}
 
 	pthread_mutex_unlock(&data->sources_mutex);
 
+	/* ------------------------------------- */
+	/* call the tick function of each source */
+
+	profile_start(tick_serial_sources_name);
+	for (size_t i = 0; i < video->tick_serial.num; i++)
+		obs_source_video_tick(video->tick_serial.array[i], seconds);
+	profile_end(tick_serial_sources_name);
+
+	profile_start(tick_parallel_sources_name);
+
+	video->tick_seconds = seconds;
+	video->tick_next = 0;
+
+	if (video->tick_parallel.num >= MIN_PARALLEL_TICK_SOURCES) {
+		if (!video->tick_threads_started)
+			init_tick_threads(video);
+		num_threads = video->num_tick_threads;
+	}
+
+	for (size_t i = 0; i < num_threads; i++)
+		os_sem_post(video->tick_start_sem);
+
+	tick_parallel_sources(video);
+
+	for (size_t i = 0; i < num_threads; i++)
+		os_sem_wait(video->tick_done_sem);
+
+	profile_end(tick_parallel_sources_name);
+
+	/* ------------------------------------- */
+	/* release sources after ticking         */
+
+	for (size_t i = 0; i < video->tick_serial.num; i++)
+		obs_source_release(video->tick_serial.array[i]);
+	for (size_t i = 0; i < video->tick_parallel.num; i++)
+		obs_source_release(video->tick_parallel.array[i]);
+
+	da_resize(video->tick_serial, 0);
+	da_resize(video->tick_parallel, 0);
+
 	return cur_time;
 }
 
@@ -809,8 +1008,6 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 		video->cur_texture = 0;
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(void)
 {
 	struct obs_core_video *video = &obs->video;
@@ -461,6 +461,8 @@ static void stop_video(void)
 			pthread_join(video->video_thread, &thread_retval);
 			video->thread_initialized = false;
 		}
+
+		obs_free_tick_threads();
 	}
 
 }
@@ -571,6 +573,8 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
+	audio->graph_dirty = true;
+
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
 		return true;
@@ -588,6 +592,9 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	obs_free_audio_render_threads();
+	obs_free_audio_graph();
+
 	circlebuf_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -992,6 +999,7 @@ void obs_shutdown(void)
 
 	obs_free_audio();
 	obs_free_data();
+	obs_encoder_packet_pool_free();
 	obs_free_video();
 	obs_free_hotkeys();
 	obs_free_graphics();
@@ -1394,6 +1402,8 @@ void obs_set_output_source(uint32_t channel, obs_source_t *source)
 
 	pthread_mutex_unlock(&view->channels_mutex);
 
+	obs_invalidate_audio_graph();
+
 	if (source)
 		obs_source_activate(source, MAIN_VIEW);
 
@@ -2209,6 +2219,35 @@ bool obs_set_audio_monitoring_device(const char *name, const char *id)
 #endif
 }
 
+void obs_set_audio_monitoring_latency(uint32_t latency_ms)
+{
+	if (!obs)
+		return;
+
+#if defined(_WIN32) || HAVE_PULSEAUDIO || defined(__APPLE__)
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	if (obs->audio.monitoring_latency_ms != latency_ms) {
+		obs->audio.monitoring_latency_ms = latency_ms;
+
+		for (size_t i = 0; i < obs->audio.monitors.num; i++) {
+			struct audio_monitor *monitor =
+				obs->audio.monitors.array[i];
+			audio_monitor_reset(monitor);
+		}
+	}
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+#else
+	UNUSED_PARAMETER(latency_ms);
+#endif
+}
+
+uint32_t obs_get_audio_monitoring_latency(void)
+{
+	return obs ? obs->audio.monitoring_latency_ms : 0;
+}
+
 void obs_get_audio_monitoring_device(const char **name, const char **id)
 {
 	if (!obs)
@@ -152,7 +152,8 @@ struct obs_transform_info {
 struct obs_video_info {
 #ifndef SWIG
 	/**
-	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11")
+	 * Graphics module to use (usually "libobs-opengl" or "libobs-d3d11",
+	 * or "libobs-null" to run without a GPU or display)
 	 */
 	const char          *graphics_module;
 #endif
@@ -390,6 +391,16 @@ EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+/**
+ * Gets the current amount of audio buffering (in nanoseconds).  Buffering
+ * is added when sources fall behind, and is gradually removed again once
+ * all sources have stayed far enough ahead for a while.
+ */
+EXPORT uint64_t obs_get_audio_buffering_ns(void);
+
+/** Gets the audio buffering currently being worked towards (in nanoseconds) */
+EXPORT uint64_t obs_get_target_audio_buffering_ns(void);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -706,6 +717,16 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb,
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/**
+ * Sets the target latency of audio monitoring in milliseconds, or 0 for the
+ * default buffering.  With a target latency, monitoring keeps the output
+ * latency at the target by adjusting the playback rate slightly instead of
+ * growing its buffer when the device underruns.  Only supported by the
+ * PulseAudio monitoring backend, other backends ignore it.
+ */
+EXPORT void obs_set_audio_monitoring_latency(uint32_t latency_ms);
+EXPORT uint32_t obs_get_audio_monitoring_latency(void);
+
 EXPORT void obs_add_tick_callback(
 		void (*tick)(void *param, float seconds),
 		void *param);
@@ -911,6 +932,16 @@ EXPORT obs_source_t *obs_filter_get_parent(const obs_source_t *filter);
  */
 EXPORT obs_source_t *obs_filter_get_target(const obs_source_t *filter);
 
+/**
+ * Gets a block of audio for an audio filter to write its output to when it
+ * cannot filter the audio it was given in place.  The planes can hold
+ * the given number of frames in the audio output format, frames and timestamp
+ * are left for the filter to set.  The block stays valid until the parent
+ * source's next audio is filtered.  Only usable inside of filter_audio.
+ */
+EXPORT struct obs_audio_data *obs_filter_get_audio_block(obs_source_t *filter,
+		uint32_t frames);
+
 /** Used to directly render a non-async source without any filter processing */
 EXPORT void obs_source_default_render(obs_source_t *source);
 
@@ -1085,6 +1116,50 @@ EXPORT void obs_source_add_audio_capture_callback(obs_source_t *source,
 EXPORT void obs_source_remove_audio_capture_callback(obs_source_t *source,
 		obs_source_audio_capture_t callback, void *param);
 
+/**
+ * Audio levels of a source's audio as it comes in (after filters, before
+ * volume).  All values are linear, use obs_mul_to_db to convert to dB.
+ */
+struct obs_audio_levels {
+	uint64_t timestamp; /**< system time the levels were measured at */
+	uint32_t frames;    /**< number of frames that were measured */
+	uint32_t channels;
+	bool     muted;
+	float    magnitude[MAX_AUDIO_CHANNELS]; /**< RMS */
+	float    peak[MAX_AUDIO_CHANNELS];      /**< sample peak */
+	float    true_peak[MAX_AUDIO_CHANNELS]; /**< 5x oversampled peak */
+};
+
+typedef void (*obs_source_audio_levels_t)(void *param, obs_source_t *source,
+		const struct obs_audio_levels *levels);
+
+/**
+ * Enables/disables measuring audio levels for obs_source_get_audio_levels.
+ * Calls are counted, levels are measured while there are more enables than
+ * disables or while there are audio level callbacks.
+ */
+EXPORT void obs_source_enable_audio_levels(obs_source_t *source);
+EXPORT void obs_source_disable_audio_levels(obs_source_t *source);
+
+/**
+ * Gets the levels of the audio that most recently came in.  Does not lock,
+ * so it can be polled from any thread.  Returns false if nothing has been
+ * measured yet.
+ */
+EXPORT bool obs_source_get_audio_levels(const obs_source_t *source,
+		struct obs_audio_levels *levels);
+
+/**
+ * Adds/removes an audio levels callback.  The callback is called at most
+ * once per interval with the highest peaks and the RMS of all the audio
+ * that came in during that interval.
+ */
+EXPORT void obs_source_add_audio_levels_callback(obs_source_t *source,
+		uint32_t interval_ms, obs_source_audio_levels_t callback,
+		void *param);
+EXPORT void obs_source_remove_audio_levels_callback(obs_source_t *source,
+		obs_source_audio_levels_t callback, void *param);
+
 enum obs_deinterlace_mode {
 	OBS_DEINTERLACE_MODE_DISABLE,
 	OBS_DEINTERLACE_MODE_DISCARD,
@@ -1122,6 +1197,24 @@ EXPORT void obs_source_set_monitoring_type(obs_source_t *source,
 EXPORT enum obs_monitoring_type obs_source_get_monitoring_type(
 		const obs_source_t *source);
 
+struct obs_audio_monitoring_stats {
+	/** Audio waiting to be played, including the device's buffer */
+	uint64_t latency_ns;
+	/** Target latency, or 0 if monitoring uses the default buffering */
+	uint64_t target_latency_ns;
+	/** Number of times the device ran out of audio to play */
+	uint32_t underruns;
+	/** Playback rate correction in parts per million */
+	int32_t  rate_adjust_ppm;
+};
+
+/**
+ * Gets the statistics of a source's audio monitoring.  Returns false if the
+ * source is not monitored or the monitoring backend has no statistics.
+ */
+EXPORT bool obs_source_get_audio_monitoring_stats(const obs_source_t *source,
+		struct obs_audio_monitoring_stats *stats);
+
 /** Gets private front-end settings data.  This data is saved/loaded
  * automatically.  Returns an incremented reference. */
 EXPORT obs_data_t *obs_source_get_private_settings(obs_source_t *item);
@@ -1174,6 +1267,19 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 		const struct obs_source_frame2 *frame);
 
+typedef void (*obs_source_frame_release_cb)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The frame data stays
+ * owned by the source and must stay valid until libobs calls release, which
+ * happens once the frame has been uploaded or has been dropped.  release is
+ * always called exactly once, from any thread, possibly before this function
+ * returns.  It must not call back in to this source.
+ */
+EXPORT void obs_source_output_video_nocopy(obs_source_t *source,
+		const struct obs_source_frame2 *frame,
+		obs_source_frame_release_cb release, void *param);
+
 /**
  * Preloads asynchronous video data to allow instantaneous playback
  *
@@ -1954,7 +2060,8 @@ EXPORT obs_properties_t *obs_encoder_properties(const obs_encoder_t *encoder);
 
 /**
  * Updates the settings of the encoder context.  Usually used for changing
- * bitrate while active
+ * bitrate while active.  An active encoder applies them before its next
+ * frame, and signals "update" once it has
  */
 EXPORT void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings);
 
@@ -1965,6 +2072,14 @@ EXPORT bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
 /** Returns the current settings for this encoder */
 EXPORT obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder);
 
+/** Returns the signal handler for this encoder */
+EXPORT signal_handler_t *obs_encoder_get_signal_handler(
+		const obs_encoder_t *encoder);
+
+/** Returns the procedure handler for this encoder */
+EXPORT proc_handler_t *obs_encoder_get_proc_handler(
+		const obs_encoder_t *encoder);
+
 /** Sets the video output context to be used with this encoder */
 EXPORT void obs_encoder_set_video(obs_encoder_t *encoder, video_t *video);
 
@@ -1986,6 +2101,12 @@ EXPORT audio_t *obs_encoder_audio(const obs_encoder_t *encoder);
 /** Returns true if encoder is active, false otherwise */
 EXPORT bool obs_encoder_active(const obs_encoder_t *encoder);
 
+/**
+ * Returns the number of chunks of audio waiting to be encoded by an audio
+ * encoder.  Each chunk is one audio output tick (usually 1024 frames).
+ */
+EXPORT size_t obs_encoder_get_audio_queue_depth(const obs_encoder_t *encoder);
+
 EXPORT void *obs_encoder_get_type_data(obs_encoder_t *encoder);
 
 EXPORT const char *obs_encoder_get_id(const obs_encoder_t *encoder);
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+#include <assert.h>
+
+#include "bmem.h"
+#include "threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed size lock-free byte ring for exactly one producer thread and one
+ * consumer thread.
+ *
+ *   The producer stages any number of writes with spsc_ring_write and makes
+ * them visible to the consumer all at once with spsc_ring_commit_write, so a
+ * record made of several pieces is never seen half written.  The consumer
+ * works the same way with spsc_ring_read and spsc_ring_commit_read.  One byte
+ * is always left unused to tell a full ring apart from an empty one.
+ *
+ *   Positions are published with a compare-and-swap rather than
+ * os_atomic_set_long, because the compare-and-swap is a full barrier on
+ * every platform, which orders the data copies before the new position.
+ */
+
+struct spsc_ring {
+	uint8_t       *data;
+	size_t        capacity;
+
+	volatile long read_pos;
+	volatile long write_pos;
+
+	/* producer/consumer private positions of staged writes/reads */
+	size_t        write_staged;
+	size_t        read_staged;
+};
+
+static inline void spsc_ring_init(struct spsc_ring *ring, size_t capacity)
+{
+	memset(ring, 0, sizeof(struct spsc_ring));
+	ring->data     = bmalloc(capacity);
+	ring->capacity = capacity;
+}
+
+static inline void spsc_ring_free(struct spsc_ring *ring)
+{
+	bfree(ring->data);
+	memset(ring, 0, sizeof(struct spsc_ring));
+}
+
+static inline size_t spsc_ring_used(const struct spsc_ring *ring,
+		size_t read_pos, size_t write_pos)
+{
+	return (write_pos >= read_pos) ?
+		(write_pos - read_pos) :
+		(ring->capacity - read_pos + write_pos);
+}
+
+/** producer: number of bytes that can still be written */
+static inline size_t spsc_ring_write_avail(const struct spsc_ring *ring)
+{
+	size_t read_pos = (size_t)os_atomic_load_long(&ring->read_pos);
+
+	if (!ring->capacity)
+		return 0;
+
+	return ring->capacity - 1 -
+		spsc_ring_used(ring, read_pos, ring->write_staged);
+}
+
+/** consumer: number of committed bytes that have not been read yet */
+static inline size_t spsc_ring_read_avail(const struct spsc_ring *ring)
+{
+	size_t write_pos = (size_t)os_atomic_load_long(&ring->write_pos);
+	return spsc_ring_used(ring, ring->read_staged, write_pos);
+}
+
+/** producer: stages a write, the caller checks spsc_ring_write_avail */
+static inline void spsc_ring_write(struct spsc_ring *ring, const void *data,
+		size_t size)
+{
+	size_t pos = ring->write_staged;
+	size_t back_size = ring->capacity - pos;
+
+	assert(size <= spsc_ring_write_avail(ring));
+
+	if (size <= back_size) {
+		memcpy(ring->data + pos, data, size);
+	} else {
+		memcpy(ring->data + pos, data, back_size);
+		memcpy(ring->data, (const uint8_t*)data + back_size,
+				size - back_size);
+	}
+
+	pos += size;
+	if (pos >= ring->capacity)
+		pos -= ring->capacity;
+	ring->write_staged = pos;
+}
+
+/** producer: drops any staged writes that have not been committed */
+static inline void spsc_ring_cancel_write(struct spsc_ring *ring)
+{
+	ring->write_staged = (size_t)os_atomic_load_long(&ring->write_pos);
+}
+
+/** producer: makes the staged writes visible to the consumer */
+static inline void spsc_ring_commit_write(struct spsc_ring *ring)
+{
+	long old_pos = os_atomic_load_long(&ring->write_pos);
+	os_atomic_compare_swap_long(&ring->write_pos, old_pos,
+			(long)ring->write_staged);
+}
+
+/**
+ * consumer: stages a read of committed data, the caller checks
+ * spsc_ring_read_avail.  data can be NULL to skip bytes.
+ */
+static inline void spsc_ring_read(struct spsc_ring *ring, void *data,
+		size_t size)
+{
+	size_t pos = ring->read_staged;
+	size_t back_size = ring->capacity - pos;
+
+	assert(size <= spsc_ring_read_avail(ring));
+
+	if (data) {
+		if (size <= back_size) {
+			memcpy(data, ring->data + pos, size);
+		} else {
+			memcpy(data, ring->data + pos, back_size);
+			memcpy((uint8_t*)data + back_size, ring->data,
+					size - back_size);
+		}
+	}
+
+	pos += size;
+	if (pos >= ring->capacity)
+		pos -= ring->capacity;
+	ring->read_staged = pos;
+}
+
+/** consumer: hands the space of the staged reads back to the producer */
+static inline void spsc_ring_commit_read(struct spsc_ring *ring)
+{
+	long old_pos = os_atomic_load_long(&ring->read_pos);
+	os_atomic_compare_swap_long(&ring->read_pos, old_pos,
+			(long)ring->read_staged);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/platform.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -32,6 +34,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* above this many damaged rectangles the bounding box is captured instead */
+#define XSHM_MAX_DAMAGE_RECTS 16
+
+struct xshm_rect {
+	int16_t          x;
+	int16_t          y;
+	uint16_t         width;
+	uint16_t         height;
+	uint32_t         offset;
+};
+
 struct xshm_data {
 	obs_source_t     *source;
 
@@ -53,6 +66,23 @@ struct xshm_data {
 	bool             use_xinerama;
 	bool             use_randr;
 	bool             advanced;
+	bool             use_damage;
+
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	bool             damage_full;
+	struct xshm_rect rects[XSHM_MAX_DAMAGE_RECTS];
+	size_t           num_rects;
+
+	/* bytes fetched from the X server and uploaded, compared to what
+	 * capturing the full screen every frame would have copied */
+	uint64_t         stats_start;
+	uint64_t         stats_bytes;
+	uint64_t         stats_full_bytes;
+	uint64_t         total_bytes;
+	uint64_t         total_full_bytes;
+	int64_t          bytes_per_sec;
+	int64_t          full_bytes_per_sec;
 };
 
 /**
@@ -88,9 +118,261 @@ static bool xshm_check_extensions(xcb_connection_t *xcb)
 	if (!xcb_get_extension_data(xcb, &xcb_randr_id)->present)
 		blog(LOG_INFO, "Missing Randr extension !");
 
+	if (!xcb_get_extension_data(xcb, &xcb_damage_id)->present)
+		blog(LOG_INFO, "Missing Damage extension !");
+
 	return ok;
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * @note the xfixes version has to be queried before, which is done by
+ *       xcb_xcursor_init
+ */
+static void xshm_damage_init(struct xshm_data *data)
+{
+	xcb_damage_query_version_cookie_t ver_c;
+
+	if (!data->use_damage)
+		return;
+	if (!xcb_get_extension_data(data->xcb, &xcb_damage_id)->present)
+		return;
+
+	ver_c = xcb_damage_query_version_unchecked(data->xcb,
+			XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
+	free(xcb_damage_query_version_reply(data->xcb, ver_c, NULL));
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->damage_full = true;
+}
+
+/**
+ * Stop tracking damage
+ */
+static void xshm_damage_free(struct xshm_data *data)
+{
+	if (data->damage) {
+		xcb_damage_destroy(data->xcb, data->damage);
+		data->damage = 0;
+	}
+	if (data->damage_region) {
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+		data->damage_region = 0;
+	}
+}
+
+/**
+ * Clip a damaged rectangle to the captured screen, relative to it
+ *
+ * @return false if the rectangle is outside of the captured screen
+ */
+static bool xshm_clip_rect(struct xshm_data *data, const xcb_rectangle_t *r,
+		int_fast32_t *x1, int_fast32_t *y1,
+		int_fast32_t *x2, int_fast32_t *y2)
+{
+	*x1 = r->x - data->x_org;
+	*y1 = r->y - data->y_org;
+	*x2 = *x1 + r->width;
+	*y2 = *y1 + r->height;
+
+	if (*x1 < 0) *x1 = 0;
+	if (*y1 < 0) *y1 = 0;
+	if (*x2 > data->width)  *x2 = data->width;
+	if (*y2 > data->height) *y2 = data->height;
+
+	return *x1 < *x2 && *y1 < *y2;
+}
+
+static inline void xshm_set_rect(struct xshm_rect *rect,
+		int_fast32_t x1, int_fast32_t y1,
+		int_fast32_t x2, int_fast32_t y2)
+{
+	rect->x      = (int16_t)x1;
+	rect->y      = (int16_t)y1;
+	rect->width  = (uint16_t)(x2 - x1);
+	rect->height = (uint16_t)(y2 - y1);
+}
+
+/**
+ * Collect the regions that changed since the last call
+ *
+ * Rectangles of the damaged region don't overlap, so they always fit in the
+ * shm segment next to each other.  When there are too many of them, their
+ * bounding box is used instead.
+ *
+ * @return false if damage can't be fetched
+ */
+static bool xshm_get_damage(struct xshm_data *data)
+{
+	xcb_xfixes_fetch_region_cookie_t reg_c;
+	xcb_xfixes_fetch_region_reply_t  *reg_r;
+	xcb_generic_event_t              *event;
+	uint32_t                         offset = 0;
+
+	data->num_rects = 0;
+
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+			data->damage_region);
+	reg_c = xcb_xfixes_fetch_region_unchecked(data->xcb,
+			data->damage_region);
+	reg_r = xcb_xfixes_fetch_region_reply(data->xcb, reg_c, NULL);
+
+	/* damage notify events aren't used, don't let them pile up */
+	while ((event = xcb_poll_for_event(data->xcb)) != NULL)
+		free(event);
+
+	if (!reg_r)
+		return false;
+
+	xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reg_r);
+	int count = xcb_xfixes_fetch_region_rectangles_length(reg_r);
+
+	if (count > XSHM_MAX_DAMAGE_RECTS) {
+		int_fast32_t bx1 = data->width, by1 = data->height;
+		int_fast32_t bx2 = 0, by2 = 0;
+
+		for (int i = 0; i < count; i++) {
+			int_fast32_t x1, y1, x2, y2;
+			if (!xshm_clip_rect(data, &rects[i], &x1, &y1, &x2, &y2))
+				continue;
+
+			if (x1 < bx1) bx1 = x1;
+			if (y1 < by1) by1 = y1;
+			if (x2 > bx2) bx2 = x2;
+			if (y2 > by2) by2 = y2;
+		}
+
+		if (bx1 < bx2 && by1 < by2)
+			xshm_set_rect(&data->rects[data->num_rects++],
+					bx1, by1, bx2, by2);
+	} else {
+		for (int i = 0; i < count; i++) {
+			int_fast32_t x1, y1, x2, y2;
+			if (xshm_clip_rect(data, &rects[i], &x1, &y1, &x2, &y2))
+				xshm_set_rect(&data->rects[data->num_rects++],
+						x1, y1, x2, y2);
+		}
+	}
+
+	for (size_t i = 0; i < data->num_rects; i++) {
+		struct xshm_rect *rect = &data->rects[i];
+		rect->offset = offset;
+		offset += (uint32_t)rect->width * rect->height * 4;
+	}
+
+	free(reg_r);
+	return true;
+}
+
+/**
+ * Fetch the damaged rectangles in to the shm segment
+ *
+ * @return false on error
+ */
+static bool xshm_get_rects(struct xshm_data *data)
+{
+	xcb_shm_get_image_cookie_t img_c[XSHM_MAX_DAMAGE_RECTS];
+	bool success = true;
+
+	for (size_t i = 0; i < data->num_rects; i++) {
+		struct xshm_rect *rect = &data->rects[i];
+
+		img_c[i] = xcb_shm_get_image_unchecked(data->xcb,
+				data->xcb_screen->root,
+				data->x_org + rect->x, data->y_org + rect->y,
+				rect->width, rect->height,
+				~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+				data->xshm->seg, rect->offset);
+	}
+
+	for (size_t i = 0; i < data->num_rects; i++) {
+		xcb_shm_get_image_reply_t *img_r;
+
+		img_r = xcb_shm_get_image_reply(data->xcb, img_c[i], NULL);
+		if (!img_r)
+			success = false;
+		free(img_r);
+	}
+
+	return success;
+}
+
+/**
+ * Upload the damaged rectangles
+ *
+ * @note requires to be called within the obs graphics context
+ * @return false if partial texture updates aren't supported
+ */
+static bool xshm_upload_rects(struct xshm_data *data)
+{
+	for (size_t i = 0; i < data->num_rects; i++) {
+		struct xshm_rect *rect = &data->rects[i];
+
+		if (!gs_texture_set_image_region(data->texture,
+				data->xshm->data + rect->offset,
+				rect->width * 4, rect->x, rect->y,
+				rect->width, rect->height))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Account for copied bytes, updated once per second
+ */
+static void xshm_update_stats(struct xshm_data *data, uint64_t bytes)
+{
+	uint64_t full_bytes = (uint64_t)data->width * data->height * 4;
+	uint64_t ts = os_gettime_ns();
+
+	data->stats_bytes      += bytes;
+	data->stats_full_bytes += full_bytes;
+	data->total_bytes      += bytes;
+	data->total_full_bytes += full_bytes;
+
+	if (!data->stats_start) {
+		data->stats_start = ts;
+
+	} else if (ts - data->stats_start >= 1000000000ULL) {
+		double secs = (double)(ts - data->stats_start) / 1000000000.0;
+
+		data->bytes_per_sec      = (int64_t)(data->stats_bytes / secs);
+		data->full_bytes_per_sec =
+			(int64_t)(data->stats_full_bytes / secs);
+		data->stats_bytes      = 0;
+		data->stats_full_bytes = 0;
+		data->stats_start      = ts;
+	}
+}
+
+static void xshm_log_stats(struct xshm_data *data)
+{
+	if (!data->total_full_bytes)
+		return;
+
+	blog(LOG_INFO, "Copied %"PRIu64" MB instead of %"PRIu64" MB (%.1f%%)",
+			data->total_bytes / 1048576,
+			data->total_full_bytes / 1048576,
+			(double)data->total_bytes * 100.0 /
+			(double)data->total_full_bytes);
+
+	data->total_bytes      = 0;
+	data->total_full_bytes = 0;
+	data->stats_start      = 0;
+	data->stats_bytes      = 0;
+	data->stats_full_bytes = 0;
+	data->bytes_per_sec      = 0;
+	data->full_bytes_per_sec = 0;
+}
+
 /**
  * Update the capture
  *
@@ -156,6 +438,8 @@ static const char* xshm_getname(void *unused)
  */
 static void xshm_capture_stop(struct xshm_data *data)
 {
+	xshm_log_stats(data);
+
 	obs_enter_graphics();
 
 	if (data->texture) {
@@ -175,6 +459,7 @@ static void xshm_capture_stop(struct xshm_data *data)
 	}
 
 	if (data->xcb) {
+		xshm_damage_free(data);
 		xcb_disconnect(data->xcb);
 		data->xcb = NULL;
 	}
@@ -219,6 +504,8 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->x_org, data->y_org);
 
+	xshm_damage_init(data);
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
@@ -242,6 +529,7 @@ static void xshm_update(void *vptr, obs_data_t *settings)
 	data->screen_id   = obs_data_get_int(settings, "screen");
 	data->show_cursor = obs_data_get_bool(settings, "show_cursor");
 	data->advanced    = obs_data_get_bool(settings, "advanced");
+	data->use_damage  = obs_data_get_bool(settings, "use_damage");
 	data->server      = bstrdup(obs_data_get_string(settings, "server"));
 
 	xshm_capture_start(data);
@@ -255,6 +543,7 @@ static void xshm_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, "screen", 0);
 	obs_data_set_default_bool(defaults, "show_cursor", true);
 	obs_data_set_default_bool(defaults, "advanced", false);
+	obs_data_set_default_bool(defaults, "use_damage", true);
 }
 
 /**
@@ -266,8 +555,10 @@ static bool xshm_toggle_advanced(obs_properties_t *props,
 	UNUSED_PARAMETER(p);
 	const bool visible     = obs_data_get_bool(settings, "advanced");
 	obs_property_t *server = obs_properties_get(props, "server");
+	obs_property_t *damage = obs_properties_get(props, "use_damage");
 
 	obs_property_set_visible(server, visible);
+	obs_property_set_visible(damage, visible);
 
 	/* trigger server changed callback so the screen list is refreshed */
 	obs_property_modified(server, settings);
@@ -362,6 +653,8 @@ static obs_properties_t *xshm_properties(void *vptr)
 			obs_module_text("AdvancedSettings"));
 	obs_property_t *server = obs_properties_add_text(props, "server",
 			obs_module_text("XServer"), OBS_TEXT_DEFAULT);
+	obs_properties_add_bool(props, "use_damage",
+			obs_module_text("CaptureChangedRegions"));
 
 	obs_property_set_modified_callback(advanced, xshm_toggle_advanced);
 	obs_property_set_modified_callback(server, xshm_server_changed);
@@ -389,6 +682,17 @@ static void xshm_destroy(void *vptr)
 	bfree(data);
 }
 
+/**
+ * Get the bytes copied per second, and what full captures would have copied
+ */
+static void xshm_get_stats(void *vptr, calldata_t *cd)
+{
+	XSHM_DATA(vptr);
+
+	calldata_set_int(cd, "bytes_per_sec", data->bytes_per_sec);
+	calldata_set_int(cd, "full_bytes_per_sec", data->full_bytes_per_sec);
+}
+
 /**
  * Create the capture
  */
@@ -397,6 +701,10 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 	data->source = source;
 
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph, "void get_stats(out int bytes_per_sec, "
+			"out int full_bytes_per_sec)", xshm_get_stats, data);
+
 	xshm_update(data, settings);
 
 	return data;
@@ -404,6 +712,9 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 
 /**
  * Prepare the capture data
+ *
+ * With damage tracking only the changed regions are fetched and uploaded,
+ * nothing is done when the screen didn't change.
  */
 static void xshm_video_tick(void *vptr, float seconds)
 {
@@ -415,32 +726,72 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t           img_c;
-	xcb_shm_get_image_reply_t            *img_r;
 	xcb_xfixes_get_cursor_image_cookie_t cur_c;
 	xcb_xfixes_get_cursor_image_reply_t  *cur_r;
+	bool full = !data->damage || data->damage_full;
+	bool captured;
 
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
-			data->x_org, data->y_org, data->width, data->height,
-			~0, XCB_IMAGE_FORMAT_Z_PIXMAP, data->xshm->seg, 0);
 	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
 
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
+	if (!full && !xshm_get_damage(data)) {
+		blog(LOG_WARNING, "Failed to fetch damage, disabling it");
+		xshm_damage_free(data);
+		full = true;
+	}
 
-	if (!img_r)
-		goto exit;
+	if (full) {
+		/* discard the damage up to now, the full screen is
+		 * captured */
+		if (data->damage)
+			xcb_damage_subtract(data->xcb, data->damage,
+					XCB_NONE, XCB_NONE);
+
+		data->rects[0].x      = 0;
+		data->rects[0].y      = 0;
+		data->rects[0].width  = (uint16_t)data->width;
+		data->rects[0].height = (uint16_t)data->height;
+		data->rects[0].offset = 0;
+		data->num_rects       = 1;
+	}
+
+	captured = data->num_rects && xshm_get_rects(data);
+	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *) data->xshm->data,
-		data->width * 4, false);
+	if (captured) {
+		uint64_t bytes = 0;
+
+		if (full) {
+			gs_texture_set_image(data->texture,
+				(void *) data->xshm->data,
+				data->width * 4, false);
+			data->damage_full = false;
+
+		} else if (!xshm_upload_rects(data)) {
+			blog(LOG_INFO, "Partial texture updates not supported, "
+					"disabling damage tracking");
+			xshm_damage_free(data);
+		}
+
+		for (size_t i = 0; i < data->num_rects; i++)
+			bytes += (uint64_t)data->rects[i].width *
+				data->rects[i].height * 4;
+		xshm_update_stats(data, bytes);
+
+	} else if (data->num_rects) {
+		/* a region failed to be fetched, start over with a full
+		 * capture next time */
+		data->damage_full = true;
+
+	} else {
+		xshm_update_stats(data, 0);
+	}
+
 	xcb_xcursor_update(data->cursor, cur_r);
 
 	obs_leave_graphics();
 
-exit:
-	free(img_r);
 	free(cur_r);
 }
 
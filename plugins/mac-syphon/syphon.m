@@ -1276,7 +1276,8 @@ struct obs_source_info syphon_info = {
 	.id             = "syphon-input",
 	.type           = OBS_SOURCE_TYPE_INPUT,
 	.output_flags   = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-	                  OBS_SOURCE_DO_NOT_DUPLICATE,
+	                  OBS_SOURCE_DO_NOT_DUPLICATE |
+	                  OBS_SOURCE_TICK_WHEN_HIDDEN,
 	.get_name       = syphon_get_name,
 	.create         = syphon_create,
 	.destroy        = syphon_destroy,
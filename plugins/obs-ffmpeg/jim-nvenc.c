@@ -230,20 +230,22 @@ static bool nvenc_update(void *data, obs_data_t *settings)
 {
 	struct nvenc_data *enc = data;
 
-	/* Only support reconfiguration of CBR bitrate */
-	if (enc->can_change_bitrate) {
-		int bitrate = (int)obs_data_get_int(settings, "bitrate");
+	/* Only support reconfiguration of CBR bitrate, report anything else
+	 * as not applied */
+	if (!enc->can_change_bitrate)
+		return false;
 
-		enc->config.rcParams.averageBitRate = bitrate * 1000;
-		enc->config.rcParams.maxBitRate     = bitrate * 1000;
+	int bitrate = (int)obs_data_get_int(settings, "bitrate");
 
-		NV_ENC_RECONFIGURE_PARAMS params = {0};
-		params.version                   = NV_ENC_RECONFIGURE_PARAMS_VER;
-		params.reInitEncodeParams        = enc->params;
+	enc->config.rcParams.averageBitRate = bitrate * 1000;
+	enc->config.rcParams.maxBitRate     = bitrate * 1000;
 
-		if (FAILED(nv.nvEncReconfigureEncoder(enc->session, &params))) {
-			return false;
-		}
+	NV_ENC_RECONFIGURE_PARAMS params = {0};
+	params.version                   = NV_ENC_RECONFIGURE_PARAMS_VER;
+	params.reInitEncodeParams        = enc->params;
+
+	if (FAILED(nv.nvEncReconfigureEncoder(enc->session, &params))) {
+		return false;
 	}
 
 	return true;
@@ -932,7 +934,8 @@ struct obs_encoder_info nvenc_info = {
 	.id                      = "jim_nvenc",
 	.codec                   = "h264",
 	.type                    = OBS_ENCODER_VIDEO,
-	.caps                    = OBS_ENCODER_CAP_PASS_TEXTURE,
+	.caps                    = OBS_ENCODER_CAP_PASS_TEXTURE |
+	                           OBS_ENCODER_CAP_DYN_BITRATE,
 	.get_name                = nvenc_get_name,
 	.create                  = nvenc_create,
 	.destroy                 = nvenc_destroy,
@@ -0,0 +1,124 @@
+#include <string.h>
+#include <math.h>
+
+#include <media-io/audio-math.h>
+#include <media-io/audio-io.h>
+
+#include "audio-dynamics.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define DYNAMICS_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef DYNAMICS_SSE
+
+/* follows four channels at once, unused lanes repeat the first channel so
+ * that they do not change the maximum */
+static void follow_channels_sse(float *env_buf, const float *const *planes,
+		size_t count, size_t frames, float attack_gain,
+		float release_gain, float envelope)
+{
+	const float *p0 = planes[0];
+	const float *p1 = count > 1 ? planes[1] : p0;
+	const float *p2 = count > 2 ? planes[2] : p0;
+	const float *p3 = count > 3 ? planes[3] : p0;
+
+	const __m128 sign    = _mm_set1_ps(-0.0f);
+	const __m128 attack  = _mm_set1_ps(attack_gain);
+	const __m128 release = _mm_set1_ps(release_gain);
+	__m128 env = _mm_set1_ps(envelope);
+
+	for (size_t i = 0; i < frames; i++) {
+		__m128 env_in = _mm_setr_ps(p0[i], p1[i], p2[i], p3[i]);
+		__m128 rising, gain, max;
+
+		env_in = _mm_andnot_ps(sign, env_in);
+
+		/* same as env < env_in ? attack_gain : release_gain */
+		rising = _mm_cmplt_ps(env, env_in);
+		gain = _mm_or_ps(_mm_and_ps(rising, attack),
+				_mm_andnot_ps(rising, release));
+
+		env = _mm_add_ps(env_in,
+				_mm_mul_ps(gain, _mm_sub_ps(env, env_in)));
+
+		max = _mm_max_ps(env, _mm_shuffle_ps(env, env,
+					_MM_SHUFFLE(2, 3, 0, 1)));
+		max = _mm_max_ps(max, _mm_shuffle_ps(max, max,
+					_MM_SHUFFLE(1, 0, 3, 2)));
+		_mm_store_ss(env_buf + i, _mm_max_ss(max,
+					_mm_load_ss(env_buf + i)));
+	}
+}
+
+#else
+
+static void follow_channel(float *env_buf, const float *samples,
+		size_t frames, float attack_gain, float release_gain,
+		float env)
+{
+	for (size_t i = 0; i < frames; i++) {
+		const float env_in = fabsf(samples[i]);
+		if (env < env_in) {
+			env = env_in + attack_gain * (env - env_in);
+		} else {
+			env = env_in + release_gain * (env - env_in);
+		}
+		env_buf[i] = fmaxf(env_buf[i], env);
+	}
+}
+
+#endif
+
+void dynamics_peak_envelope(float *env_buf, float *const *samples,
+		size_t channels, size_t frames, float attack_gain,
+		float release_gain, float *envelope)
+{
+	const float *planes[MAX_AUDIO_CHANNELS];
+	size_t count = 0;
+
+	if (!frames)
+		return;
+
+	for (size_t ch = 0; ch < channels && ch < MAX_AUDIO_CHANNELS; ch++) {
+		if (samples[ch])
+			planes[count++] = samples[ch];
+	}
+
+	memset(env_buf, 0, frames * sizeof(float));
+
+#ifdef DYNAMICS_SSE
+	for (size_t ch = 0; ch < count; ch += 4) {
+		size_t group = count - ch < 4 ? count - ch : 4;
+		follow_channels_sse(env_buf, planes + ch, group, frames,
+				attack_gain, release_gain, *envelope);
+	}
+#else
+	for (size_t ch = 0; ch < count; ch++)
+		follow_channel(env_buf, planes[ch], frames, attack_gain,
+				release_gain, *envelope);
+#endif
+
+	*envelope = env_buf[frames - 1];
+}
+
+void dynamics_compression_gain(float *buf, size_t frames, float threshold_db,
+		float slope, float output_gain)
+{
+	/* below the threshold the gain is 0 dB, which saves the log/pow */
+	const float threshold = db_to_mul(threshold_db);
+
+	for (size_t i = 0; i < frames; i++) {
+		float env = buf[i];
+
+		if (env <= threshold) {
+			buf[i] = output_gain;
+		} else {
+			const float env_db = mul_to_db(env);
+			float gain = slope * (threshold_db - env_db);
+			buf[i] = db_to_mul(fminf(0, gain)) * output_gain;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Shared envelope and gain code of the compressor and limiter filters
+ *
+ *   The envelope follower depends on the previous sample, so it is vectorized
+ * across channels instead of across samples: with SSE, four channels are
+ * followed at once.  Results are the same as the scalar code.
+ */
+
+/**
+ * Peak envelope of all channels.  Each channel is followed from *envelope,
+ * env_buf gets the highest envelope of the channels for each sample and
+ * *envelope is set to the last value of env_buf.  NULL channels are ignored.
+ */
+extern void dynamics_peak_envelope(float *env_buf, float *const *samples,
+		size_t channels, size_t frames, float attack_gain,
+		float release_gain, float *envelope);
+
+/**
+ * Turns an envelope in to the gain to apply to each sample (including the
+ * output gain), in place.
+ */
+extern void dynamics_compression_gain(float *buf, size_t frames,
+		float threshold_db, float slope, float output_gain);
@@ -5,9 +5,11 @@
 #include <obs-module.h>
 #include <media-io/audio-math.h>
 #include <util/platform.h>
-#include <util/circlebuf.h>
 #include <util/threading.h>
 
+#include "sidechain-bus.h"
+#include "audio-dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -76,48 +78,22 @@ struct compressor_data {
 	uint64_t sidechain_check_time;
 	obs_weak_source_t *weak_sidechain;
 	char *sidechain_name;
+	struct sidechain_reader sidechain;
 
-	pthread_mutex_t sidechain_mutex;
-	struct circlebuf sidechain_data[MAX_AUDIO_CHANNELS];
 	float *sidechain_buf[MAX_AUDIO_CHANNELS];
-	size_t max_sidechain_frames;
 };
 
 /* -------------------------------------------------------- */
 
-static inline obs_source_t *get_sidechain(struct compressor_data *cd)
-{
-	if (cd->weak_sidechain)
-		return obs_weak_source_get_source(cd->weak_sidechain);
-	return NULL;
-}
-
 static inline void get_sidechain_data(struct compressor_data *cd,
 		const uint32_t num_samples)
 {
-	size_t data_size = cd->envelope_buf_len * sizeof(float);
-	if (!data_size)
-		return;
-
-	pthread_mutex_lock(&cd->sidechain_mutex);
-	if (cd->max_sidechain_frames < num_samples)
-		cd->max_sidechain_frames = num_samples;
-
-	if (cd->sidechain_data[0].size < data_size) {
-		pthread_mutex_unlock(&cd->sidechain_mutex);
-		goto clear;
-	}
-
-	for (size_t i = 0; i < cd->num_channels; i++)
-		circlebuf_pop_front(&cd->sidechain_data[i],
-				cd->sidechain_buf[i], data_size);
-
-	pthread_mutex_unlock(&cd->sidechain_mutex);
-	return;
-
-clear:
-	for (size_t i = 0; i < cd->num_channels; i++)
-		memset(cd->sidechain_buf[i], 0, data_size);
+	/* the mutex only keeps the bus from being swapped out, reading the
+	 * bus itself does not lock */
+	pthread_mutex_lock(&cd->sidechain_update_mutex);
+	sidechain_reader_read(&cd->sidechain, cd->sidechain_buf,
+			cd->num_channels, num_samples);
+	pthread_mutex_unlock(&cd->sidechain_update_mutex);
 }
 
 static void resize_env_buffer(struct compressor_data *cd, size_t len)
@@ -141,47 +117,6 @@ static const char *compressor_name(void *unused)
 	return obs_module_text("Compressor");
 }
 
-static void sidechain_capture(void *param, obs_source_t *source,
-		const struct audio_data *audio_data, bool muted)
-{
-	struct compressor_data *cd = param;
-
-	UNUSED_PARAMETER(source);
-
-	pthread_mutex_lock(&cd->sidechain_mutex);
-
-	if (cd->max_sidechain_frames < audio_data->frames)
-		cd->max_sidechain_frames = audio_data->frames;
-
-	size_t expected_size = cd->max_sidechain_frames * sizeof(float);
-
-	if (!expected_size)
-		goto unlock;
-
-	if (cd->sidechain_data[0].size > expected_size * 2) {
-		for (size_t i = 0; i < cd->num_channels; i++) {
-			circlebuf_pop_front(&cd->sidechain_data[i], NULL,
-					expected_size);
-		}
-	}
-
-	if (muted) {
-		for (size_t i = 0; i < cd->num_channels; i++) {
-			circlebuf_push_back_zero(&cd->sidechain_data[i],
-					audio_data->frames * sizeof(float));
-		}
-	} else {
-		for (size_t i = 0; i < cd->num_channels; i++) {
-			circlebuf_push_back(&cd->sidechain_data[i],
-					audio_data->data[i],
-					audio_data->frames * sizeof(float));
-		}
-	}
-
-unlock:
-	pthread_mutex_unlock(&cd->sidechain_mutex);
-}
-
 static void compressor_update(void *data, obs_data_t *s)
 {
 	struct compressor_data *cd = data;
@@ -213,6 +148,7 @@ static void compressor_update(void *data, obs_data_t *s)
 	bool valid_sidechain =
 		*sidechain_name && strcmp(sidechain_name, "none") != 0;
 	obs_weak_source_t *old_weak_sidechain = NULL;
+	struct sidechain_bus *old_bus = NULL;
 
 	pthread_mutex_lock(&cd->sidechain_update_mutex);
 
@@ -220,6 +156,8 @@ static void compressor_update(void *data, obs_data_t *s)
 		if (cd->weak_sidechain) {
 			old_weak_sidechain = cd->weak_sidechain;
 			cd->weak_sidechain = NULL;
+			old_bus = cd->sidechain.bus;
+			sidechain_reader_init(&cd->sidechain, NULL);
 		}
 
 		bfree(cd->sidechain_name);
@@ -231,6 +169,8 @@ static void compressor_update(void *data, obs_data_t *s)
 			if (cd->weak_sidechain) {
 				old_weak_sidechain = cd->weak_sidechain;
 				cd->weak_sidechain = NULL;
+				old_bus = cd->sidechain.bus;
+				sidechain_reader_init(&cd->sidechain, NULL);
 			}
 
 			bfree(cd->sidechain_name);
@@ -241,18 +181,8 @@ static void compressor_update(void *data, obs_data_t *s)
 
 	pthread_mutex_unlock(&cd->sidechain_update_mutex);
 
-	if (old_weak_sidechain) {
-		obs_source_t *old_sidechain =
-			obs_weak_source_get_source(old_weak_sidechain);
-
-		if (old_sidechain) {
-			obs_source_remove_audio_capture_callback(old_sidechain,
-					sidechain_capture, cd);
-			obs_source_release(old_sidechain);
-		}
-
-		obs_weak_source_release(old_weak_sidechain);
-	}
+	sidechain_bus_release(old_bus);
+	obs_weak_source_release(old_weak_sidechain);
 
 	size_t sample_len = sample_rate * DEFAULT_AUDIO_BUF_MS / MS_IN_S;
 	if (cd->envelope_buf_len == 0)
@@ -264,14 +194,7 @@ static void *compressor_create(obs_data_t *settings, obs_source_t *filter)
 	struct compressor_data *cd = bzalloc(sizeof(struct compressor_data));
 	cd->context = filter;
 
-	if (pthread_mutex_init(&cd->sidechain_mutex, NULL) != 0) {
-		blog(LOG_ERROR, "Failed to create mutex");
-		bfree(cd);
-		return NULL;
-	}
-
 	if (pthread_mutex_init(&cd->sidechain_update_mutex, NULL) != 0) {
-		pthread_mutex_destroy(&cd->sidechain_mutex);
 		blog(LOG_ERROR, "Failed to create mutex");
 		bfree(cd);
 		return NULL;
@@ -285,22 +208,11 @@ static void compressor_destroy(void *data)
 {
 	struct compressor_data *cd = data;
 
-	if (cd->weak_sidechain) {
-		obs_source_t *sidechain = get_sidechain(cd);
-		if (sidechain) {
-			obs_source_remove_audio_capture_callback(sidechain,
-					sidechain_capture, cd);
-			obs_source_release(sidechain);
-		}
+	sidechain_bus_release(cd->sidechain.bus);
+	obs_weak_source_release(cd->weak_sidechain);
 
-		obs_weak_source_release(cd->weak_sidechain);
-	}
-
-	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		circlebuf_free(&cd->sidechain_data[i]);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		bfree(cd->sidechain_buf[i]);
-	}
-	pthread_mutex_destroy(&cd->sidechain_mutex);
 	pthread_mutex_destroy(&cd->sidechain_update_mutex);
 
 	bfree(cd->sidechain_name);
@@ -315,27 +227,9 @@ static void analyze_envelope(struct compressor_data *cd,
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+	dynamics_peak_envelope(cd->envelope_buf, samples, cd->num_channels,
+			num_samples, cd->attack_gain, cd->release_gain,
+			&cd->envelope);
 }
 
 static void analyze_sidechain(struct compressor_data *cd,
@@ -347,44 +241,21 @@ static void analyze_sidechain(struct compressor_data *cd,
 
 	get_sidechain_data(cd, num_samples);
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-	float **sidechain_buf = cd->sidechain_buf;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!sidechain_buf[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in  = fabsf(sidechain_buf[chan][i]);
-
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
-	cd->envelope = cd->envelope_buf[num_samples - 1];
+	dynamics_peak_envelope(cd->envelope_buf, cd->sidechain_buf,
+			cd->num_channels, num_samples, cd->attack_gain,
+			cd->release_gain, &cd->envelope);
 }
 
 static inline void process_compression(const struct compressor_data *cd,
 	float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
+	dynamics_compression_gain(cd->envelope_buf, num_samples,
+			cd->threshold, cd->slope, cd->output_gain);
+
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c])
+			audio_scale_buf(samples[c], cd->envelope_buf,
+					num_samples);
 	}
 }
 
@@ -411,24 +282,23 @@ static void compressor_tick(void *data, float seconds)
 			obs_get_source_by_name(new_name) : NULL;
 		obs_weak_source_t *weak_sidechain = sidechain ?
 			obs_source_get_weak_source(sidechain) : NULL;
+		struct sidechain_bus *bus = sidechain_bus_acquire(sidechain);
 
 		pthread_mutex_lock(&cd->sidechain_update_mutex);
 
 		if (cd->sidechain_name &&
 		    strcmp(cd->sidechain_name, new_name) == 0) {
 			cd->weak_sidechain = weak_sidechain;
+			sidechain_reader_init(&cd->sidechain, bus);
 			weak_sidechain = NULL;
+			bus = NULL;
 		}
 
 		pthread_mutex_unlock(&cd->sidechain_update_mutex);
 
-		if (sidechain) {
-			obs_source_add_audio_capture_callback(sidechain,
-					sidechain_capture, cd);
-
-			obs_weak_source_release(weak_sidechain);
-			obs_source_release(sidechain);
-		}
+		sidechain_bus_release(bus);
+		obs_weak_source_release(weak_sidechain);
+		obs_source_release(sidechain);
 
 		bfree(new_name);
 	}
@@ -276,19 +276,22 @@ static void analyze_envelope(struct expander_data *cd,
 		float *env_in = cd->env_in;
 
 		if (cd->detector == RMS_DETECT) {
+			const float *in = samples[chan];
+
 			runave[0] = rmscoef * cd->runave[chan] +
-				(1 - rmscoef) * powf(samples[chan][0], 2.0f);
+				(1 - rmscoef) * (in[0] * in[0]);
 			env_in[0] = sqrtf(fmaxf(runave[0], 0));
 			for (uint32_t i = 1; i < num_samples; ++i) {
 				runave[i] = rmscoef * runave[i - 1] +
-					(1 - rmscoef) *
-					powf(samples[chan][i], 2.0f);
+					(1 - rmscoef) * (in[i] * in[i]);
 				env_in[i] = sqrtf(runave[i]);
 			}
 		} else if (cd->detector == PEAK_DETECT) {
+			const float *in = samples[chan];
+
 			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
-				env_in[i] = fabsf(samples[chan][i]);
+				runave[i] = in[i] * in[i];
+				env_in[i] = fabsf(in[i]);
 			}
 		}
 
@@ -340,7 +343,9 @@ static inline void process_expansion(struct expander_data *cd,
 					(1.0f - release_gain) * gain;
 			}
 
-			gain = db_to_mul(fminf(0, cd->gaindB[chan][i]));
+			/* no attenuation is common, skip the pow for it */
+			gain = cd->gaindB[chan][i] >= 0.0f ? 1.0f :
+				db_to_mul(cd->gaindB[chan][i]);
 			if (samples[chan])
 				samples[chan][i] *= gain * cd->output_gain;
 		}
@@ -50,10 +50,6 @@ struct noise_suppress_data {
 	/* 16 bit PCM buffers */
 	float *copy_buffers[MAX_PREPROC_CHANNELS];
 	spx_int16_t *segment_buffers[MAX_PREPROC_CHANNELS];
-
-	/* output data */
-	struct obs_audio_data output_audio;
-	DARRAY(float) output_data;
 };
 
 /* -------------------------------------------------------- */
@@ -85,7 +81,6 @@ static void noise_suppress_destroy(void *data)
 	bfree(ng->segment_buffers[0]);
 	bfree(ng->copy_buffers[0]);
 	circlebuf_free(&ng->info_buffer);
-	da_free(ng->output_data);
 	bfree(ng);
 }
 
@@ -203,6 +198,7 @@ static struct obs_audio_data *noise_suppress_filter_audio(void *data,
 	struct obs_audio_data *audio)
 {
 	struct noise_suppress_data *ng = data;
+	struct obs_audio_data *output;
 	struct ng_audio_info info;
 	size_t segment_size = ng->frames * sizeof(float);
 	size_t out_size;
@@ -254,21 +250,19 @@ static struct obs_audio_data *noise_suppress_filter_audio(void *data,
 	/* -----------------------------------------------
 	 * if there's enough audio data buffered in the output circlebuf,
 	 * pop and return a packet */
-	circlebuf_pop_front(&ng->info_buffer, NULL, sizeof(info));
-	da_resize(ng->output_data, out_size * ng->channels);
+	output = obs_filter_get_audio_block(ng->context, info.frames);
+	if (!output)
+		return NULL;
 
-	for (size_t i = 0; i < ng->channels; i++) {
-		ng->output_audio.data[i] =
-			(uint8_t*)&ng->output_data.array[i * out_size];
+	circlebuf_pop_front(&ng->info_buffer, NULL, sizeof(info));
 
-		circlebuf_pop_front(&ng->output_buffers[i],
-				ng->output_audio.data[i],
+	for (size_t i = 0; i < ng->channels; i++)
+		circlebuf_pop_front(&ng->output_buffers[i], output->data[i],
 				out_size);
-	}
 
-	ng->output_audio.frames = info.frames;
-	ng->output_audio.timestamp = info.timestamp;
-	return &ng->output_audio;
+	output->frames = info.frames;
+	output->timestamp = info.timestamp;
+	return output;
 }
 
 static void noise_suppress_defaults(obs_data_t *s)
@@ -0,0 +1,298 @@
+#include <util/threading.h>
+#include <util/darray.h>
+#include <util/bmem.h>
+
+#include "sidechain-bus.h"
+
+/* how much key source audio the ring holds */
+#define BUS_RING_MS 500
+
+/* positions wrap at a multiple of the ring size (and well within a long) */
+#define BUS_POS_WRAP_RINGS 1024
+
+struct sidechain_bus {
+	obs_weak_source_t *weak_source;
+	long              refs;
+
+	size_t            channels;
+	size_t            frames;
+	size_t            pos_wrap;
+	float             *ring[MAX_AUDIO_CHANNELS];
+
+	/* only written by the key source's audio capture callback.  positions
+	 * are frame counts modulo pos_wrap, not ring offsets */
+	volatile long     write_pos;
+	volatile long     max_chunk;
+};
+
+static pthread_mutex_t buses_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct sidechain_bus*) buses;
+
+static inline size_t pos_add(const struct sidechain_bus *bus, size_t pos,
+		size_t frames)
+{
+	return (pos + frames) % bus->pos_wrap;
+}
+
+static inline size_t pos_diff(const struct sidechain_bus *bus, size_t pos,
+		size_t prev_pos)
+{
+	return (pos + bus->pos_wrap - prev_pos) % bus->pos_wrap;
+}
+
+/* ------------------------------------------------------------------------- */
+/* writer */
+
+static void write_ring(struct sidechain_bus *bus, size_t ch, size_t offset,
+		const float *data, size_t frames)
+{
+	size_t back_frames = bus->frames - offset;
+	float *ring = bus->ring[ch];
+
+	if (frames > back_frames) {
+		if (data) {
+			memcpy(ring + offset, data, back_frames * sizeof(float));
+			memcpy(ring, data + back_frames,
+					(frames - back_frames) * sizeof(float));
+		} else {
+			memset(ring + offset, 0, back_frames * sizeof(float));
+			memset(ring, 0, (frames - back_frames) * sizeof(float));
+		}
+	} else {
+		if (data)
+			memcpy(ring + offset, data, frames * sizeof(float));
+		else
+			memset(ring + offset, 0, frames * sizeof(float));
+	}
+}
+
+static void bus_capture(void *param, obs_source_t *source,
+		const struct audio_data *audio_data, bool muted)
+{
+	struct sidechain_bus *bus = param;
+	size_t pos = (size_t)os_atomic_load_long(&bus->write_pos);
+	size_t frames = audio_data->frames;
+	size_t offset;
+
+	/* anything bigger than the ring would be overwritten anyway */
+	if (frames > bus->frames / 2)
+		frames = bus->frames / 2;
+	if (!frames)
+		return;
+
+	if ((long)frames > bus->max_chunk)
+		os_atomic_set_long(&bus->max_chunk, (long)frames);
+
+	offset = pos % bus->frames;
+
+	for (size_t ch = 0; ch < bus->channels; ch++) {
+		const float *data = muted ? NULL :
+			(const float*)audio_data->data[ch];
+		write_ring(bus, ch, offset, data, frames);
+	}
+
+	/* the compare-and-swap is a full barrier, so the audio is in the ring
+	 * before readers can see the new position */
+	os_atomic_compare_swap_long(&bus->write_pos, (long)pos,
+			(long)pos_add(bus, pos, frames));
+
+	UNUSED_PARAMETER(source);
+}
+
+/* ------------------------------------------------------------------------- */
+/* bus list */
+
+static struct sidechain_bus *bus_create(obs_source_t *source)
+{
+	struct sidechain_bus *bus = bzalloc(sizeof(struct sidechain_bus));
+	audio_t *audio = obs_get_audio();
+
+	bus->weak_source = obs_source_get_weak_source(source);
+	bus->refs        = 1;
+	bus->channels    = audio_output_get_channels(audio);
+	bus->frames      = audio_output_get_sample_rate(audio) * BUS_RING_MS /
+		1000;
+	bus->pos_wrap    = bus->frames * BUS_POS_WRAP_RINGS;
+
+	for (size_t ch = 0; ch < bus->channels; ch++)
+		bus->ring[ch] = bzalloc(bus->frames * sizeof(float));
+
+	obs_source_add_audio_capture_callback(source, bus_capture, bus);
+	return bus;
+}
+
+static void bus_destroy(struct sidechain_bus *bus)
+{
+	obs_source_t *source = obs_weak_source_get_source(bus->weak_source);
+
+	/* once this returns, the capture callback is not running */
+	if (source) {
+		obs_source_remove_audio_capture_callback(source, bus_capture,
+				bus);
+		obs_source_release(source);
+	}
+
+	for (size_t ch = 0; ch < bus->channels; ch++)
+		bfree(bus->ring[ch]);
+
+	obs_weak_source_release(bus->weak_source);
+	bfree(bus);
+}
+
+struct sidechain_bus *sidechain_bus_acquire(obs_source_t *source)
+{
+	struct sidechain_bus *bus = NULL;
+
+	if (!source)
+		return NULL;
+
+	pthread_mutex_lock(&buses_mutex);
+
+	for (size_t i = 0; i < buses.num; i++) {
+		if (obs_weak_source_references_source(
+					buses.array[i]->weak_source, source)) {
+			bus = buses.array[i];
+			bus->refs++;
+			break;
+		}
+	}
+
+	if (!bus) {
+		bus = bus_create(source);
+		da_push_back(buses, &bus);
+	}
+
+	pthread_mutex_unlock(&buses_mutex);
+	return bus;
+}
+
+void sidechain_bus_release(struct sidechain_bus *bus)
+{
+	bool destroy;
+
+	if (!bus)
+		return;
+
+	pthread_mutex_lock(&buses_mutex);
+
+	destroy = --bus->refs == 0;
+	if (destroy) {
+		da_erase_item(buses, &bus);
+		if (!buses.num)
+			da_free(buses);
+	}
+
+	pthread_mutex_unlock(&buses_mutex);
+
+	if (destroy)
+		bus_destroy(bus);
+}
+
+/* ------------------------------------------------------------------------- */
+/* readers */
+
+void sidechain_reader_init(struct sidechain_reader *reader,
+		struct sidechain_bus *bus)
+{
+	memset(reader, 0, sizeof(*reader));
+	reader->bus = bus;
+}
+
+/* loads the write position with a full barrier in front of it, so that the
+ * ring has been read before the position is checked */
+static inline size_t load_write_pos_after_read(struct sidechain_bus *bus)
+{
+	long pos;
+
+	do {
+		pos = os_atomic_load_long(&bus->write_pos);
+	} while (!os_atomic_compare_swap_long(&bus->write_pos, pos, pos));
+
+	return (size_t)pos;
+}
+
+static void read_ring(struct sidechain_bus *bus, float **data,
+		size_t channels, size_t offset, size_t frames)
+{
+	size_t back_frames = bus->frames - offset;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *ring = bus->ring[ch];
+
+		if (frames > back_frames) {
+			memcpy(data[ch], ring + offset,
+					back_frames * sizeof(float));
+			memcpy(data[ch] + back_frames, ring,
+					(frames - back_frames) * sizeof(float));
+		} else {
+			memcpy(data[ch], ring + offset, frames * sizeof(float));
+		}
+	}
+}
+
+static inline void clear_data(float **data, size_t channels, size_t frames)
+{
+	for (size_t ch = 0; ch < channels; ch++)
+		memset(data[ch], 0, frames * sizeof(float));
+}
+
+bool sidechain_reader_read(struct sidechain_reader *reader,
+		float **data, size_t channels, size_t frames)
+{
+	struct sidechain_bus *bus = reader->bus;
+	size_t bus_channels;
+	size_t write_pos;
+	size_t max_chunk;
+	size_t avail;
+
+	if (!bus || frames > bus->frames / 2)
+		goto fail;
+
+	bus_channels = channels < bus->channels ? channels : bus->channels;
+
+	write_pos = (size_t)os_atomic_load_long(&bus->write_pos);
+	max_chunk = (size_t)os_atomic_load_long(&bus->max_chunk);
+	avail = pos_diff(bus, write_pos, reader->pos);
+
+	if (reader->max_frames < frames)
+		reader->max_frames = frames;
+	if (reader->max_frames < max_chunk)
+		reader->max_frames = max_chunk;
+
+	/* start reading from the newest audio, and if reading fell behind by
+	 * more than a couple of chunks, skip ahead to keep latency down */
+	if (!reader->synced || avail > bus->frames) {
+		reader->pos = write_pos;
+		reader->synced = true;
+		avail = 0;
+
+	} else if (avail > reader->max_frames * 2) {
+		reader->pos = pos_diff(bus, write_pos, reader->max_frames);
+		avail = reader->max_frames;
+	}
+
+	if (avail < frames)
+		goto fail;
+
+	read_ring(bus, data, bus_channels,
+			reader->pos % bus->frames, frames);
+
+	/* the key source may have written over the audio while it was being
+	 * copied, including a chunk it has not published yet */
+	write_pos = load_write_pos_after_read(bus);
+	if (pos_diff(bus, write_pos, reader->pos) + max_chunk > bus->frames) {
+		reader->synced = false;
+		goto fail;
+	}
+
+	reader->pos = pos_add(bus, reader->pos, frames);
+
+	if (bus_channels < channels)
+		clear_data(data + bus_channels, channels - bus_channels,
+				frames);
+	return true;
+
+fail:
+	clear_data(data, channels, frames);
+	return false;
+}
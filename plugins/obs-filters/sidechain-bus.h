@@ -0,0 +1,35 @@
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Shared sidechain audio
+ *
+ *   There is one bus per key source no matter how many filters are keyed off
+ * of it.  The bus copies the key source's audio once in to a ring, and every
+ * filter reads from the ring at its own position without locking.
+ */
+
+struct sidechain_bus;
+
+struct sidechain_reader {
+	struct sidechain_bus *bus;
+	size_t               pos;
+	size_t               max_frames;
+	bool                 synced;
+};
+
+/** Gets the bus of a source, creating it if needed */
+extern struct sidechain_bus *sidechain_bus_acquire(obs_source_t *source);
+extern void sidechain_bus_release(struct sidechain_bus *bus);
+
+/** Starts reading a bus (or stops reading, if bus is NULL) */
+extern void sidechain_reader_init(struct sidechain_reader *reader,
+		struct sidechain_bus *bus);
+
+/**
+ * Reads the next frames of the key source in to data.  If not enough audio
+ * is available, data is cleared and false is returned.
+ */
+extern bool sidechain_reader_read(struct sidechain_reader *reader,
+		float **data, size_t channels, size_t frames);
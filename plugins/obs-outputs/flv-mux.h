@@ -21,6 +21,9 @@
 
 #define MILLISECOND_DEN   1000
 
+/* 11 byte tag header plus the 5 byte AVC video tag header */
+#define FLV_TAG_HEADER_MAX_SIZE 16
+
 static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 {
 	return (int32_t)(val * MILLISECOND_DEN / packet->timebase_den);
@@ -32,3 +35,10 @@ extern bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 		bool write_header, size_t audio_idx);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 		uint8_t **output, size_t *size, bool is_header);
+
+/* writes only the tag header of a packet (everything before the packet data)
+ * to output, which must hold FLV_TAG_HEADER_MAX_SIZE bytes.  returns the
+ * number of bytes written, or 0 if the packet is empty.  the packet data
+ * follows it; the trailing tag size is not included */
+extern size_t flv_packet_mux_header(struct encoder_packet *packet,
+		int32_t dts_offset, uint8_t *output, bool is_header);
@@ -4204,18 +4204,19 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* encodes the chunk header of the first chunk of a packet in to header
+ * (RTMP_MAX_HEADER_SIZE bytes) and the header of the chunks that follow it in
+ * to cont (3 bytes).  returns the size of the first header, or 0 on error */
+static int
+EncodeChunkHeader(RTMP *r, RTMPPacket *packet, char *header, char *cont,
+                  int *contSize)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
-    int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    int cSize;
+    char *hptr, *hend = header + RTMP_MAX_HEADER_SIZE, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4226,7 +4227,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
             free(r->m_vecChannelsOut);
             r->m_vecChannelsOut = NULL;
             r->m_channelsAllocatedOut = 0;
-            return FALSE;
+            return 0;
         }
         r->m_vecChannelsOut = packets;
         memset(r->m_vecChannelsOut + r->m_channelsAllocatedOut, 0, sizeof(RTMPPacket*) * (n - r->m_channelsAllocatedOut));
@@ -4252,40 +4253,17 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     {
         RTMP_Log(RTMP_LOGERROR, "sanity failed!! trying to send header of type: 0x%02x.",
                  (unsigned char)packet->m_headerType);
-        return FALSE;
+        return 0;
     }
 
     nSize = packetSize[packet->m_headerType];
-    hSize = nSize;
     cSize = 0;
     t = packet->m_nTimeStamp - last;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
-
     if (packet->m_nChannel > 319)
         cSize = 2;
     else if (packet->m_nChannel > 63)
         cSize = 1;
-    if (cSize)
-    {
-        header -= cSize;
-        hSize += cSize;
-    }
-
-    if (nSize > 1 && t >= 0xffffff)
-    {
-        header -= 4;
-        hSize += 4;
-    }
 
     hptr = header;
     c = packet->m_headerType << 6;
@@ -4326,6 +4304,45 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    cont[0] = (0xc0 | c);
+    memcpy(cont + 1, header + 1, cSize);
+    *contSize = 1 + cSize;
+
+    return (int)(hptr - header);
+}
+
+static void
+SaveSentPacket(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, contSize;
+    char *header, hbuf[RTMP_MAX_HEADER_SIZE], cont[3];
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    hSize = EncodeChunkHeader(r, packet, hbuf, cont, &contSize);
+    if (!hSize)
+        return FALSE;
+
+    if (packet->m_body)
+    {
+        header = packet->m_body - hSize;
+        memcpy(header, hbuf, hSize);
+    }
+    else
+    {
+        header = hbuf;
+    }
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4338,7 +4355,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         int chunks = (nSize+nChunkSize-1) / nChunkSize;
         if (chunks > 1)
         {
-            tlen = chunks * (cSize + 1) + nSize + hSize;
+            tlen = chunks * contSize + nSize + hSize;
             tbuf = malloc(tlen);
             if (!tbuf)
                 return FALSE;
@@ -4371,21 +4388,9 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
 
         if (nSize > 0)
         {
-            header = buffer - 1;
-            hSize = 1;
-            if (cSize)
-            {
-                header -= cSize;
-                hSize += cSize;
-            }
-            *header = (0xc0 | c);
-            if (cSize)
-            {
-                int tmp = packet->m_nChannel - 64;
-                header[1] = tmp & 0xff;
-                if (cSize == 2)
-                    header[2] = tmp >> 8;
-            }
+            header = buffer - contSize;
+            hSize = contSize;
+            memcpy(header, cont, contSize);
         }
     }
     if (tbuf)
@@ -4415,9 +4420,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    SaveSentPacket(r, packet);
     return TRUE;
 }
 
@@ -5526,3 +5529,186 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+#ifdef _WIN32
+typedef WSABUF RTMPIOVec;
+#define IOV_BASE(v) (v).buf
+#define IOV_LEN(v)  (v).len
+#else
+typedef struct iovec RTMPIOVec;
+#define IOV_BASE(v) (v).iov_base
+#define IOV_LEN(v)  (v).iov_len
+#endif
+
+#define RTMP_MAX_IOV 64
+
+static int
+WriteV(RTMP *r, RTMPIOVec *iov, int count)
+{
+    while (count > 0)
+    {
+        int nBytes;
+#ifdef _WIN32
+        DWORD sent = 0;
+        nBytes = WSASend(r->m_sb.sb_socket, iov, count, &sent, 0, NULL, NULL);
+        if (nBytes == 0)
+            nBytes = (int)sent;
+#else
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d", __FUNCTION__,
+                     sockerr);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            r->last_error_code = sockerr;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        while (count > 0 && (size_t)nBytes >= (size_t)IOV_LEN(*iov))
+        {
+            nBytes -= (int)IOV_LEN(*iov);
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            IOV_BASE(*iov) = (char *)IOV_BASE(*iov) + nBytes;
+            IOV_LEN(*iov) -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
+/* sends an audio or video FLV tag whose data is not contiguous with its
+ * header.  tag holds the 11 byte FLV tag header followed by any tag data that
+ * comes before data (the codec header).  on plain TCP connections the chunk
+ * headers, tag data and data are sent together with one gather write per
+ * RTMP_MAX_IOV segments, without copying data */
+int
+RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *data,
+              int dataSize, int streamIdx)
+{
+    RTMPPacket packet = {0};
+    RTMPIOVec iov[RTMP_MAX_IOV];
+    char header[RTMP_MAX_HEADER_SIZE], cont[3];
+    const char *seg[2];
+    int segSize[2];
+    int hSize, contSize, nSize, nChunkSize, count = 0, i;
+
+    if (tagSize < 11 || dataSize < 0)
+        return -1;
+
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = tag[0];
+    packet.m_nBodySize = AMF_DecodeInt24(tag + 1);
+    packet.m_nTimeStamp = AMF_DecodeInt24(tag + 4);
+    packet.m_nTimeStamp |= (uint32_t)(uint8_t)tag[7] << 24;
+    packet.m_headerType = packet.m_nTimeStamp ?
+        RTMP_PACKET_SIZE_MEDIUM : RTMP_PACKET_SIZE_LARGE;
+
+    seg[0] = tag + 11;
+    segSize[0] = tagSize - 11;
+    seg[1] = data;
+    segSize[1] = dataSize;
+
+    if ((packet.m_packetType != RTMP_PACKET_TYPE_AUDIO &&
+            packet.m_packetType != RTMP_PACKET_TYPE_VIDEO) ||
+            packet.m_nBodySize !=
+            (uint32_t)segSize[0] + (uint32_t)segSize[1])
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, invalid tag", __FUNCTION__);
+        return -1;
+    }
+
+    /* anything that transforms the stream (tls, rtmpe, rtmpt) or queues it
+     * itself needs contiguous data: copy it in to a packet once instead */
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP) || r->m_bCustomSend
+#if defined(CRYPTO) && !defined(NO_SSL)
+            || r->m_sb.sb_ssl || r->Link.rc4keyOut
+#endif
+       )
+    {
+        int ret;
+
+        if (!RTMPPacket_Alloc(&packet, packet.m_nBodySize))
+            return -1;
+
+        memcpy(packet.m_body, seg[0], segSize[0]);
+        memcpy(packet.m_body + segSize[0], seg[1], segSize[1]);
+
+        ret = RTMP_SendPacket(r, &packet, FALSE);
+        RTMPPacket_Free(&packet);
+        return ret ? tagSize + dataSize : -1;
+    }
+
+    hSize = EncodeChunkHeader(r, &packet, header, cont, &contSize);
+    if (!hSize)
+        return -1;
+
+    IOV_BASE(iov[count]) = header;
+    IOV_LEN(iov[count]) = hSize;
+    count++;
+
+    nChunkSize = r->m_outChunkSize;
+    nSize = 0;
+
+    for (i = 0; i < 2; i++)
+    {
+        const char *ptr = seg[i];
+        int left = segSize[i];
+
+        while (left > 0)
+        {
+            int size = left;
+
+            if (nSize == nChunkSize)
+            {
+                IOV_BASE(iov[count]) = cont;
+                IOV_LEN(iov[count]) = contSize;
+                count++;
+                nSize = 0;
+            }
+
+            if (size > nChunkSize - nSize)
+                size = nChunkSize - nSize;
+
+            IOV_BASE(iov[count]) = (char *)ptr;
+            IOV_LEN(iov[count]) = size;
+            count++;
+
+            ptr += size;
+            left -= size;
+            nSize += size;
+
+            /* keep room for a chunk header and a segment */
+            if (count >= RTMP_MAX_IOV - 1)
+            {
+                if (!WriteV(r, iov, count))
+                    return -1;
+                count = 0;
+            }
+        }
+    }
+
+    if (count && !WriteV(r, iov, count))
+        return -1;
+
+    SaveSentPacket(r, &packet);
+    return tagSize + dataSize;
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/circlebuf.h>
+
+/*
+ * Dynamic bitrate
+ *
+ *   When more than DBR_TRIGGER_USEC of video is waiting to be sent, the video
+ *   bitrate is lowered to a bit under the measured throughput.  Once the
+ *   connection has kept up for a while, it is raised back towards the
+ *   original bitrate in steps.  Frames are still dropped past the drop
+ *   threshold if lowering the bitrate was not enough.
+ *
+ *   Only the decisions are made here, the output applies them and does the
+ *   locking.  Kept apart from rtmp-stream.c so they can be tested against a
+ *   simulated connection.
+ */
+
+#define DBR_WINDOW_NS          1000000000ULL
+#define DBR_TRIGGER_USEC       200000LL
+#define DBR_DRAIN_USEC         3000000LL
+#define DBR_LOWER_INTERVAL_NS  500000000ULL
+#define DBR_INC_TIMEOUT_NS     30000000000ULL
+#define DBR_INC_INTERVAL_NS    10000000000ULL
+#define DBR_INC_STEP_PERCENT   10
+#define DBR_MIN_BITRATE        100
+
+struct dbr_frame {
+	uint64_t send_beg;
+	uint64_t send_end;
+	size_t   size;
+};
+
+/* bitrates are in kbps.  frames holds the packets sent in the last
+ * DBR_WINDOW_NS to measure throughput.  pending_bitrate is a change the
+ * encoder has not applied yet, cur_bitrate only changes once it has */
+struct dbr {
+	struct circlebuf frames;
+	size_t           data_size;
+	long             est_bitrate;
+	long             audio_bitrate;
+	long             orig_bitrate;
+	long             cur_bitrate;
+	long             pending_bitrate;
+	uint64_t         last_change;
+	uint64_t         inc_timeout;
+};
+
+static inline void dbr_reset(struct dbr *dbr, long bitrate, long audio_bitrate)
+{
+	circlebuf_free(&dbr->frames);
+	dbr->data_size       = 0;
+	dbr->est_bitrate     = 0;
+	dbr->audio_bitrate   = audio_bitrate;
+	dbr->orig_bitrate    = bitrate;
+	dbr->cur_bitrate     = bitrate;
+	dbr->pending_bitrate = 0;
+	dbr->last_change     = 0;
+	dbr->inc_timeout     = 0;
+}
+
+static inline void dbr_free(struct dbr *dbr)
+{
+	circlebuf_free(&dbr->frames);
+}
+
+/* measures throughput over the packets sent in the last DBR_WINDOW_NS */
+static inline void dbr_add_frame(struct dbr *dbr,
+		const struct dbr_frame *back)
+{
+	struct dbr_frame front;
+	uint64_t dur;
+
+	circlebuf_push_back(&dbr->frames, back, sizeof(*back));
+	dbr->data_size += back->size;
+
+	for (;;) {
+		circlebuf_peek_front(&dbr->frames, &front, sizeof(front));
+
+		dur = back->send_end - front.send_beg;
+		if (dur <= DBR_WINDOW_NS || dbr->frames.size == sizeof(front))
+			break;
+
+		circlebuf_pop_front(&dbr->frames, NULL, sizeof(front));
+		dbr->data_size -= front.size;
+	}
+
+	/* too little data to go by at the start of a stream */
+	dbr->est_bitrate = (dur >= DBR_WINDOW_NS / 2) ?
+		(long)(dbr->data_size * 8000000ULL / dur) : 0;
+}
+
+/* returns the bitrate to change to, or 0 to keep the current bitrate */
+static inline long dbr_next_bitrate(struct dbr *dbr,
+		int64_t buffer_duration_usec, int64_t drop_threshold_usec,
+		uint64_t now)
+{
+	int64_t trigger_usec = DBR_TRIGGER_USEC;
+	long bitrate = dbr->cur_bitrate;
+	long est_bitrate = dbr->est_bitrate;
+
+	/* the last change has to take effect before it can be judged */
+	if (dbr->pending_bitrate)
+		return 0;
+
+	if (trigger_usec > drop_threshold_usec / 2)
+		trigger_usec = drop_threshold_usec / 2;
+
+	if (buffer_duration_usec >= trigger_usec) {
+		if (now - dbr->last_change < DBR_LOWER_INTERVAL_NS)
+			return 0;
+
+		/* at least 10% lower, and below what actually got through,
+		 * with room to send what is already waiting within
+		 * DBR_DRAIN_USEC */
+		bitrate -= bitrate / 10;
+		est_bitrate -= est_bitrate / 10 + dbr->audio_bitrate +
+			(long)(buffer_duration_usec * (dbr->cur_bitrate +
+					dbr->audio_bitrate) / DBR_DRAIN_USEC);
+		if (dbr->est_bitrate > 0 && est_bitrate < bitrate)
+			bitrate = est_bitrate;
+		if (bitrate < DBR_MIN_BITRATE)
+			bitrate = DBR_MIN_BITRATE;
+		if (bitrate >= dbr->cur_bitrate)
+			return 0;
+
+		dbr->inc_timeout = now + DBR_INC_TIMEOUT_NS;
+
+	} else if (buffer_duration_usec < trigger_usec / 4 &&
+	           bitrate < dbr->orig_bitrate &&
+	           now >= dbr->inc_timeout) {
+		bitrate += dbr->orig_bitrate * DBR_INC_STEP_PERCENT / 100;
+		if (bitrate > dbr->orig_bitrate)
+			bitrate = dbr->orig_bitrate;
+
+		dbr->inc_timeout = now + DBR_INC_INTERVAL_NS;
+
+	} else {
+		return 0;
+	}
+
+	dbr->last_change = now;
+	dbr->pending_bitrate = bitrate;
+	return bitrate;
+}
+
+/* the encoder applied (or refused) pending_bitrate.  returns the bitrate
+ * that was pending, or 0 if none was */
+static inline long dbr_bitrate_applied(struct dbr *dbr, bool success)
+{
+	long bitrate = dbr->pending_bitrate;
+
+	dbr->pending_bitrate = 0;
+	if (bitrate && success)
+		dbr->cur_bitrate = bitrate;
+	return bitrate;
+}
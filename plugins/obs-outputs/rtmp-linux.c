@@ -0,0 +1,345 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+static void update_tcp_info(struct rtmp_stream *stream)
+{
+	struct tcp_info info;
+	socklen_t size = sizeof(info);
+
+	if (getsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP, TCP_INFO,
+				&info, &size) != 0)
+		return;
+
+	os_atomic_set_long(&stream->tcp_rtt_us, (long)info.tcpi_rtt);
+	os_atomic_set_long(&stream->tcp_cwnd, (long)info.tcpi_snd_cwnd);
+	os_atomic_set_long(&stream->tcp_retransmits,
+			(long)info.tcpi_total_retrans);
+}
+
+/* only allow a small amount of data that has not been sent yet to sit in the
+ * kernel: the socket stops being writable past it, so a slow connection
+ * backs up in to our own buffers where frame dropping can see it */
+#define MIN_NOTSENT_LOWAT 16384
+
+static void set_notsent_lowat(struct rtmp_stream *stream)
+{
+#ifdef TCP_NOTSENT_LOWAT
+	int lowat = (int)(stream->write_buf_size / 8);
+
+	if (lowat < MIN_NOTSENT_LOWAT)
+		lowat = MIN_NOTSENT_LOWAT;
+
+	if (setsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP,
+				TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) == 0)
+		blog(LOG_INFO, "socket_thread_linux: Unsent data limited "
+				"to %d bytes", lowat);
+	else
+		blog(LOG_WARNING, "socket_thread_linux: Failed to set "
+				"TCP_NOTSENT_LOWAT, %d", errno);
+#else
+	UNUSED_PARAMETER(stream);
+#endif
+}
+
+static bool socket_event(struct rtmp_stream *stream, uint32_t events,
+		bool *can_write, uint64_t last_send_time)
+{
+	if (events & EPOLLOUT)
+		*can_write = true;
+
+	if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+		int err_code = 0;
+		socklen_t size = sizeof(err_code);
+
+		getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR,
+				&err_code, &size);
+
+		if (last_send_time) {
+			uint32_t diff =
+				(os_gettime_ns() / 1000000) - last_send_time;
+
+			blog(LOG_ERROR, "socket_thread_linux: Socket closed, "
+					"%u ms since last send "
+					"(buffer: %d / %d)",
+					diff,
+					(int)stream->write_buf_len,
+					(int)stream->write_buf_size);
+		}
+
+		if (os_event_try(stream->stop_event) != EAGAIN)
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to socket close during shutdown, "
+					"%d bytes lost, error %d",
+					(int)stream->write_buf_len,
+					err_code);
+		else
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to socket close, error %d",
+					err_code);
+
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+
+	if (events & EPOLLIN) {
+		char discard[16384];
+		int err_code;
+		bool fatal = false;
+
+		for (;;) {
+			ssize_t ret = recv(stream->rtmp.m_sb.sb_socket,
+					discard, sizeof(discard), 0);
+			if (ret == -1) {
+				err_code = errno;
+				if (err_code == EAGAIN ||
+				    err_code == EWOULDBLOCK)
+					break;
+				if (err_code == EINTR)
+					continue;
+
+				fatal = true;
+			} else if (ret == 0) {
+				err_code = 0;
+				fatal = true;
+			}
+
+			if (fatal) {
+				blog(LOG_ERROR, "socket_thread_linux: "
+						"Socket error, recv() returned "
+						"%d, errno %d",
+						(int)ret, err_code);
+				stream->rtmp.last_error_code = err_code;
+				fatal_sock_shutdown(stream);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+enum data_ret {
+	RET_BREAK,
+	RET_FATAL,
+	RET_CONTINUE
+};
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+		uint64_t *last_send_time, size_t latency_packet_size,
+		int delay_time)
+{
+	bool exit_loop = false;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	size_t send_len = stream->write_buf_len;
+	if (stream->low_latency_mode && send_len > latency_packet_size)
+		send_len = latency_packet_size;
+
+	int ret = RTMPSockBuf_Send(&stream->rtmp.m_sb,
+			(const char *)stream->write_buf, (int)send_len);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf,
+					stream->write_buf + ret,
+					stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+	} else {
+		/* with RTMPS, mbedtls reports a full socket with its own
+		 * error code but leaves errno as it was set by send() */
+		int err_code = ret < 0 ? errno : 0;
+
+		if (ret < 0 && err_code == EINTR) {
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_CONTINUE;
+		}
+
+		if (ret < 0 && (err_code == EAGAIN ||
+		                err_code == EWOULDBLOCK)) {
+			*can_write = false;
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_BREAK;
+		}
+
+		/* connection closed, or connection was aborted /
+		 * socket closed / etc, that's a fatal error. */
+		blog(LOG_ERROR, "socket_thread_linux: "
+				"Socket error, send() returned %d, "
+				"errno %d",
+				ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+#define LATENCY_FACTOR 20
+#define TCP_INFO_INTERVAL_MS 1000
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream)
+{
+	bool can_write = false;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+	uint64_t next_tcp_info_time = 0;
+
+	int sock = stream->rtmp.m_sb.sb_socket;
+	struct epoll_event ev = {0};
+	struct epoll_event events[2];
+	eventfd_t wake_count;
+	int epoll_fd;
+
+	os_set_thread_name("rtmp-stream: socket_thread_linux");
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to "
+				"epoll_create1 failure, %d", errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	/* edge triggered: can_write stays set until send() would block, like
+	 * FD_WRITE on windows */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = sock;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream->socket_wake_fd, &ev);
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size = stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	if (!stream->disable_send_window_optimization) {
+		set_notsent_lowat(stream);
+	} else {
+		blog(LOG_INFO, "socket_thread_linux: Send window "
+				"optimization disabled by user.");
+	}
+
+	for (;;) {
+		uint64_t now = os_gettime_ns() / 1000000;
+		if (now >= next_tcp_info_time) {
+			update_tcp_info(stream);
+			next_tcp_info_time = now + TCP_INFO_INTERVAL_MS;
+		}
+
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		int count = epoll_wait(epoll_fd, events, 2,
+				TCP_INFO_INTERVAL_MS);
+		if (count == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to epoll_wait failure, %d", errno);
+			fatal_sock_shutdown(stream);
+			goto exit;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				eventfd_read(stream->socket_wake_fd,
+						&wake_count);
+
+			} else if (!socket_event(stream, events[i].events,
+						&can_write, last_send_time)) {
+				goto exit;
+			}
+		}
+
+		if (can_write) {
+			for (;;) {
+				enum data_ret ret = write_data(
+						stream,
+						&can_write,
+						&last_send_time,
+						latency_packet_size,
+						delay_time);
+
+				switch (ret) {
+				case RET_BREAK:
+					goto exit_write_loop;
+				case RET_FATAL:
+					goto exit;
+				case RET_CONTINUE:;
+				}
+			}
+		}
+		exit_write_loop:;
+	}
+
+	update_tcp_info(stream);
+
+	blog(LOG_INFO, "socket_thread_linux: Normal exit (rtt: %ld ms, "
+			"cwnd: %ld, retransmits: %ld)",
+			os_atomic_load_long(&stream->tcp_rtt_us) / 1000,
+			os_atomic_load_long(&stream->tcp_cwnd),
+			os_atomic_load_long(&stream->tcp_retransmits));
+
+exit:
+	close(epoll_fd);
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+	socket_thread_linux_internal(stream);
+	return NULL;
+}
+#endif
@@ -32,6 +32,7 @@ static void log_rtmp(int level, const char *format, va_list args)
 }
 
 static inline size_t num_buffered_packets(struct rtmp_stream *stream);
+static void dbr_disconnect(struct rtmp_stream *stream);
 
 static inline void free_packets(struct rtmp_stream *stream)
 {
@@ -104,6 +105,9 @@ static void rtmp_stream_destroy(void *data)
 	os_sem_destroy(stream->send_sem);
 	pthread_mutex_destroy(&stream->packets_mutex);
 	circlebuf_free(&stream->packets);
+	dbr_disconnect(stream);
+	pthread_mutex_destroy(&stream->dbr_mutex);
+	dbr_free(&stream->dbr);
 #ifdef TEST_FRAMEDROPS
 	circlebuf_free(&stream->droptest_info);
 #endif
@@ -113,17 +117,39 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+#ifdef __linux__
+	if (stream->socket_wake_fd != -1)
+		close(stream->socket_wake_fd);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
 	bfree(stream);
 }
 
+#ifdef __linux__
+static void get_socket_stats(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+
+	calldata_set_int(cd, "rtt_us",
+			os_atomic_load_long(&stream->tcp_rtt_us));
+	calldata_set_int(cd, "cwnd",
+			os_atomic_load_long(&stream->tcp_cwnd));
+	calldata_set_int(cd, "retransmits",
+			os_atomic_load_long(&stream->tcp_retransmits));
+}
+#endif
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	pthread_mutex_init_value(&stream->dbr_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
 
 	RTMP_Init(&stream->rtmp);
 	RTMP_LogSetCallback(log_rtmp);
@@ -131,6 +157,8 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 
 	if (pthread_mutex_init(&stream->packets_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&stream->dbr_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 
@@ -159,6 +187,22 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		warn("Failed to initialize socket exit event");
 		goto fail;
 	}
+#ifdef __linux__
+	stream->socket_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (stream->socket_wake_fd == -1) {
+		warn("Failed to initialize socket wake eventfd");
+		goto fail;
+	}
+
+	proc_handler_add(obs_output_get_proc_handler(output),
+			"void get_socket_stats(out int rtt_us, out int cwnd, "
+			"out int retransmits)",
+			get_socket_stats, stream);
+#endif
+
+	signal_handler_add(obs_output_get_signal_handler(output),
+			"void bitrate_changed(ptr output, int bitrate, "
+			"int prev_bitrate)");
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -294,6 +338,14 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	eventfd_write(stream->socket_wake_fd, 1);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len, void *arg)
 {
 	UNUSED_PARAMETER(sb);
@@ -323,20 +375,29 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal (stream->buffer_has_data_event);
+	signal_socket_thread(stream);
 
 	return len;
 }
 
+/* the server rarely sends anything after connecting (acknowledgements and
+ * pings), so unread data only needs to be checked for now and then rather
+ * than with a syscall for every packet */
+#define RECV_CHECK_INTERVAL_NS 100000000ULL
+
 static int send_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
+	struct dbr_frame dbr_frame;
+	uint8_t tag[FLV_TAG_HEADER_MAX_SIZE];
+	size_t  tag_size;
 	size_t  size;
+	uint64_t now = os_gettime_ns();
 	int     recv_size = 0;
 	int     ret = 0;
 
-	if (!stream->new_socket_loop) {
+	if (!stream->new_socket_loop && now >= stream->next_recv_check_ts) {
+		stream->next_recv_check_ts = now + RECV_CHECK_INTERVAL_NS;
 #ifdef _WIN32
 		ret = ioctlsocket(stream->rtmp.m_sb.sb_socket, FIONREAD,
 				(u_long*)&recv_size);
@@ -350,15 +411,30 @@ static int send_packet(struct rtmp_stream *stream,
 		}
 	}
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			&data, &size, is_header);
+	/* only the tag header is built here, the packet data is sent straight
+	 * from the encoder packet */
+	tag_size = flv_packet_mux_header(packet,
+			is_header ? 0 : stream->start_dts_offset, tag, is_header);
+	size = tag_size ? tag_size + packet->size + 4 : 0;
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size, (int)idx);
-	bfree(data);
+	dbr_frame.send_beg = os_gettime_ns();
+
+	ret = tag_size ? RTMP_WriteTag(&stream->rtmp, (char*)tag,
+			(int)tag_size, (char*)packet->data, (int)packet->size,
+			(int)idx) : 0;
+
+	if (stream->dbr_enabled && !is_header) {
+		dbr_frame.send_end = os_gettime_ns();
+		dbr_frame.size     = size;
+
+		pthread_mutex_lock(&stream->dbr_mutex);
+		dbr_add_frame(&stream->dbr, &dbr_frame);
+		pthread_mutex_unlock(&stream->dbr_mutex);
+	}
 
 	if (is_header)
 		bfree(packet->data);
@@ -451,6 +527,84 @@ static void set_output_error(struct rtmp_stream *stream)
 	obs_output_set_last_error(stream->output, msg);
 }
 
+/* an active encoder applies new settings before its next frame, on its own
+ * thread, and signals "update" once it has.  the new bitrate only counts
+ * from then on */
+static void dbr_set_bitrate(obs_encoder_t *vencoder, long bitrate)
+{
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "bitrate", bitrate);
+	obs_encoder_update(vencoder, settings);
+	obs_data_release(settings);
+}
+
+static void dbr_encoder_update(void *data, calldata_t *params)
+{
+	struct rtmp_stream *stream = data;
+	obs_encoder_t *vencoder = calldata_ptr(params, "encoder");
+	bool success = calldata_bool(params, "success");
+	long prev_bitrate;
+	long bitrate;
+	struct calldata cd;
+	uint8_t stack[128];
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	prev_bitrate = stream->dbr.cur_bitrate;
+	bitrate = dbr_bitrate_applied(&stream->dbr, success);
+	if (bitrate && !success)
+		stream->dbr_enabled = false;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	/* not a change made by this output */
+	if (!bitrate)
+		return;
+
+	if (!success) {
+		warn("Dynamic bitrate disabled: the video encoder did not "
+				"accept a bitrate of %ld kbps", bitrate);
+		dbr_set_bitrate(vencoder, prev_bitrate);
+		return;
+	}
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	calldata_set_ptr(&cd, "output", stream->output);
+	calldata_set_int(&cd, "bitrate", bitrate);
+	calldata_set_int(&cd, "prev_bitrate", prev_bitrate);
+	signal_handler_signal(obs_output_get_signal_handler(stream->output),
+			"bitrate_changed", &cd);
+}
+
+static void dbr_disconnect(struct rtmp_stream *stream)
+{
+	if (!stream->dbr_encoder)
+		return;
+
+	signal_handler_disconnect(
+			obs_encoder_get_signal_handler(stream->dbr_encoder),
+			"update", dbr_encoder_update, stream);
+	stream->dbr_encoder = NULL;
+}
+
+static void dbr_restore_bitrate(struct rtmp_stream *stream)
+{
+	long orig_bitrate;
+	bool changed;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	orig_bitrate = stream->dbr.orig_bitrate;
+	changed = stream->dbr.cur_bitrate != orig_bitrate ||
+		stream->dbr.pending_bitrate;
+	if (changed)
+		stream->dbr.pending_bitrate = orig_bitrate;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (changed) {
+		info("Restoring bitrate to %ld kbps", orig_bitrate);
+		dbr_set_bitrate(stream->dbr_encoder, orig_bitrate);
+	}
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -499,7 +653,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_socket_thread(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -517,6 +671,11 @@ static void *send_thread(void *data)
 		obs_output_end_data_capture(stream->output);
 	}
 
+	if (stream->dbr_encoder) {
+		dbr_restore_bitrate(stream);
+		dbr_disconnect(stream);
+	}
+
 	free_packets(stream);
 	os_event_reset(stream->stop_event);
 	os_atomic_set_bool(&stream->active, false);
@@ -714,6 +873,13 @@ static int init_send(struct rtmp_stream *stream)
 #ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				socket_thread_windows, stream);
+#elif defined(__linux__)
+		os_atomic_set_long(&stream->tcp_rtt_us, 0);
+		os_atomic_set_long(&stream->tcp_cwnd, 0);
+		os_atomic_set_long(&stream->tcp_retransmits, 0);
+
+		ret = pthread_create(&stream->socket_thread, NULL,
+				socket_thread_linux, stream);
 #else
 		warn("New socket loop not supported on this platform");
 		return OBS_OUTPUT_ERROR;
@@ -873,6 +1039,63 @@ static int try_connect(struct rtmp_stream *stream)
 	return init_send(stream);
 }
 
+static long get_encoder_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	long bitrate = (long)obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	return bitrate;
+}
+
+static bool dbr_init(struct rtmp_stream *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_encoder_t *aencoder;
+	obs_data_t *vsettings;
+	const char *rc;
+	long bitrate;
+	long audio_bitrate = 0;
+	bool bitrate_based;
+
+	if (!(obs_encoder_get_caps(vencoder) & OBS_ENCODER_CAP_DYN_BITRATE)) {
+		info("Dynamic bitrate disabled: the video encoder cannot "
+				"change its bitrate while active");
+		return false;
+	}
+
+	vsettings = obs_encoder_get_settings(vencoder);
+	bitrate = (long)obs_data_get_int(vsettings, "bitrate");
+	rc = obs_data_get_string(vsettings, "rate_control");
+	bitrate_based = !*rc || astrcmpi(rc, "CBR") == 0 ||
+		astrcmpi(rc, "VBR") == 0 || astrcmpi(rc, "ABR") == 0;
+	obs_data_release(vsettings);
+
+	if (bitrate <= 0 || !bitrate_based) {
+		info("Dynamic bitrate disabled: the video encoder does not "
+				"use a target bitrate");
+		return false;
+	}
+
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		aencoder = obs_output_get_audio_encoder(stream->output, i);
+		if (!aencoder)
+			break;
+		audio_bitrate += get_encoder_bitrate(aencoder);
+	}
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	dbr_reset(&stream->dbr, bitrate, audio_bitrate);
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	dbr_disconnect(stream);
+	stream->dbr_encoder = vencoder;
+	signal_handler_connect(obs_encoder_get_signal_handler(vencoder),
+			"update", dbr_encoder_update, stream);
+
+	info("Dynamic bitrate enabled, video bitrate: %ld kbps", bitrate);
+	return true;
+}
+
 static bool init_connect(struct rtmp_stream *stream)
 {
 	obs_service_t *service;
@@ -894,6 +1117,7 @@ static bool init_connect(struct rtmp_stream *stream)
 	os_atomic_set_bool(&stream->disconnected, false);
 	os_atomic_set_bool(&stream->encode_error, false);
 	stream->total_bytes_sent = 0;
+	stream->next_recv_check_ts = 0;
 	stream->dropped_frames   = 0;
 	stream->min_priority     = 0;
 	stream->got_first_video  = false;
@@ -923,8 +1147,12 @@ static bool init_connect(struct rtmp_stream *stream)
 			OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode = obs_data_get_bool(settings,
 			OPT_LOWLATENCY_ENABLED);
+	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
 	obs_data_release(settings);
+
+	if (stream->dbr_enabled)
+		stream->dbr_enabled = dbr_init(stream);
 	return true;
 }
 
@@ -943,6 +1171,7 @@ static void *connect_thread(void *data)
 	ret = try_connect(stream);
 
 	if (ret != OBS_OUTPUT_SUCCESS) {
+		dbr_disconnect(stream);
 		obs_output_signal_stop(stream->output, ret);
 		info("Connection to %s failed: %d", stream->path.array, ret);
 	}
@@ -1082,6 +1311,43 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	}
 }
 
+static int64_t get_buffer_duration_usec(struct rtmp_stream *stream)
+{
+	struct encoder_packet first;
+
+	if (!find_first_video_packet(stream, &first))
+		return 0;
+
+	return stream->last_dts_usec - first.dts_usec;
+}
+
+/* returns the bitrate to change to, or 0 to keep the current bitrate */
+static long dbr_check_bitrate(struct rtmp_stream *stream)
+{
+	int64_t buffer_duration_usec = get_buffer_duration_usec(stream);
+	long cur_bitrate;
+	long est_bitrate;
+	long bitrate;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	cur_bitrate = stream->dbr.cur_bitrate;
+	est_bitrate = stream->dbr.est_bitrate;
+	bitrate = dbr_next_bitrate(&stream->dbr, buffer_duration_usec,
+			stream->drop_threshold_usec, os_gettime_ns());
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (bitrate && bitrate < cur_bitrate)
+		info("Congestion: %"PRId64" ms buffered, estimated throughput "
+				"%ld kbps, lowering video bitrate from %ld to "
+				"%ld kbps", buffer_duration_usec / 1000,
+				est_bitrate, cur_bitrate, bitrate);
+	else if (bitrate)
+		info("Raising video bitrate from %ld to %ld kbps",
+				cur_bitrate, bitrate);
+
+	return bitrate;
+}
+
 static bool add_video_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet)
 {
@@ -1106,6 +1372,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 	struct rtmp_stream    *stream = data;
 	struct encoder_packet new_packet;
 	bool                  added_packet = false;
+	long                  new_bitrate = 0;
 
 	if (disconnected(stream) || !active(stream))
 		return;
@@ -1135,10 +1402,19 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 		added_packet = (packet->type == OBS_ENCODER_VIDEO) ?
 			add_video_packet(stream, &new_packet) :
 			add_packet(stream, &new_packet);
+
+		if (stream->dbr_enabled && packet->type == OBS_ENCODER_VIDEO)
+			new_bitrate = dbr_check_bitrate(stream);
 	}
 
 	pthread_mutex_unlock(&stream->packets_mutex);
 
+	/* this can be the audio encoder's thread, the video encoder applies
+	 * the change itself before its next frame */
+	if (new_bitrate)
+		dbr_set_bitrate(obs_output_get_video_encoder(stream->output),
+				new_bitrate);
+
 	if (added_packet)
 		os_sem_post(stream->send_sem);
 	else
@@ -1153,6 +1429,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
+	obs_data_set_default_bool(defaults, OPT_DYN_BITRATE, false);
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -1184,6 +1461,8 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 			obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED,
 			obs_module_text("RTMPStream.LowLatencyMode"));
+	obs_properties_add_bool(props, OPT_DYN_BITRATE,
+			obs_module_text("RTMPStream.DynamicBitrate"));
 
 	return props;
 }
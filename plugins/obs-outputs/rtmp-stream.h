@@ -9,6 +9,7 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "rtmp-dbr.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -16,6 +17,10 @@
 #include <sys/ioctl.h>
 #endif
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 #define do_log(level, format, ...) \
 	blog(level, "[rtmp stream: '%s'] " format, \
 			obs_output_get_name(stream->output), ##__VA_ARGS__)
@@ -30,6 +35,7 @@
 #define OPT_BIND_IP "bind_ip"
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
+#define OPT_DYN_BITRATE "dyn_bitrate"
 
 //#define TEST_FRAMEDROPS
 
@@ -84,6 +90,14 @@ struct rtmp_stream {
 
 	uint64_t         total_bytes_sent;
 	int              dropped_frames;
+	uint64_t         next_recv_check_ts;
+
+	/* dynamic bitrate, dbr_encoder is the video encoder whose "update"
+	 * signal is connected while streaming */
+	bool             dbr_enabled;
+	pthread_mutex_t  dbr_mutex;
+	struct dbr       dbr;
+	obs_encoder_t    *dbr_encoder;
 
 #ifdef TEST_FRAMEDROPS
 	struct circlebuf droptest_info;
@@ -105,8 +119,22 @@ struct rtmp_stream {
 	os_event_t       *buffer_has_data_event;
 	os_event_t       *socket_available_event;
 	os_event_t       *send_thread_signaled_exit;
+
+#ifdef __linux__
+	/* wakes the socket thread's epoll loop */
+	int              socket_wake_fd;
+
+	/* from TCP_INFO, updated by the socket thread */
+	volatile long    tcp_rtt_us;
+	volatile long    tcp_cwnd;
+	volatile long    tcp_retransmits;
+#endif
 };
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
 #endif
+
+#ifdef __linux__
+void *socket_thread_linux(void *data);
+#endif
@@ -2059,7 +2059,8 @@ struct obs_source_info game_capture_info = {
 	.id = "game_capture",
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-	                OBS_SOURCE_DO_NOT_DUPLICATE,
+	                OBS_SOURCE_DO_NOT_DUPLICATE |
+	                OBS_SOURCE_TICK_WHEN_HIDDEN,
 	.get_name = game_capture_name,
 	.create = game_capture_create,
 	.destroy = game_capture_destroy,
@@ -0,0 +1,398 @@
+/*
+ * Times the compressor's audio path before and after the envelope follower
+ * moved to audio-dynamics.c and sidechain audio moved to a shared bus.
+ *
+ * "before" is the compressor code as it was: a scalar envelope follower per
+ * channel, log/pow for every sample, and a circlebuf copy of the key
+ * source's audio per compressor, taken under that compressor's mutex.
+ * "after" uses dynamics_peak_envelope, dynamics_compression_gain and
+ * audio_scale_buf, and one sidechain bus written once and read by every
+ * compressor.  The two compressors have to give the same output.
+ *
+ * Everything runs on one thread, so the locks are never contended here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <media-io/audio-math.h>
+#include <util/circlebuf.h>
+#include <util/platform.h>
+
+#include "audio-dynamics.h"
+
+/* bus_capture is static, and the bus is created here without a source */
+#include "sidechain-bus.c"
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define CHANNELS      2
+#define FRAMES        1024
+#define SAMPLE_RATE   48000
+#define BLOCKS        2000
+#define RUNS          5
+
+struct compressor {
+	float *envelope_buf;
+	float envelope;
+	float attack_gain;
+	float release_gain;
+	float threshold;
+	float slope;
+	float output_gain;
+};
+
+static void compressor_init(struct compressor *comp)
+{
+	comp->envelope_buf = bzalloc(FRAMES * sizeof(float));
+	comp->envelope     = 0.0f;
+	comp->attack_gain  = (float)exp(-1.0f / (SAMPLE_RATE * 0.006f));
+	comp->release_gain = (float)exp(-1.0f / (SAMPLE_RATE * 0.060f));
+	comp->threshold    = -18.0f;
+	comp->slope        = 1.0f - (1.0f / 10.0f);
+	comp->output_gain  = db_to_mul(0.0f);
+}
+
+/* ------------------------------------------------------------------------- */
+/* before */
+
+static void old_analyze_envelope(struct compressor *comp, float **samples,
+		const uint32_t num_samples)
+{
+	const float attack_gain = comp->attack_gain;
+	const float release_gain = comp->release_gain;
+
+	memset(comp->envelope_buf, 0, num_samples * sizeof(float));
+	for (size_t chan = 0; chan < CHANNELS; ++chan) {
+		if (!samples[chan])
+			continue;
+
+		float *envelope_buf = comp->envelope_buf;
+		float env = comp->envelope;
+		for (uint32_t i = 0; i < num_samples; ++i) {
+			const float env_in = fabsf(samples[chan][i]);
+			if (env < env_in) {
+				env = env_in + attack_gain * (env - env_in);
+			} else {
+				env = env_in + release_gain * (env - env_in);
+			}
+			envelope_buf[i] = fmaxf(envelope_buf[i], env);
+		}
+	}
+	comp->envelope = comp->envelope_buf[num_samples - 1];
+}
+
+static void old_process_compression(const struct compressor *comp,
+		float **samples, uint32_t num_samples)
+{
+	for (size_t i = 0; i < num_samples; ++i) {
+		const float env_db = mul_to_db(comp->envelope_buf[i]);
+		float gain = comp->slope * (comp->threshold - env_db);
+		gain = db_to_mul(fminf(0, gain));
+
+		for (size_t c = 0; c < CHANNELS; ++c) {
+			if (samples[c]) {
+				samples[c][i] *= gain * comp->output_gain;
+			}
+		}
+	}
+}
+
+/* the per-compressor copy of the key source's audio */
+struct old_sidechain {
+	pthread_mutex_t mutex;
+	struct circlebuf data[CHANNELS];
+	float *buf[CHANNELS];
+	size_t max_frames;
+};
+
+static void old_sidechain_capture(struct old_sidechain *sc,
+		const struct audio_data *audio_data)
+{
+	pthread_mutex_lock(&sc->mutex);
+
+	if (sc->max_frames < audio_data->frames)
+		sc->max_frames = audio_data->frames;
+
+	size_t expected_size = sc->max_frames * sizeof(float);
+
+	if (sc->data[0].size > expected_size * 2) {
+		for (size_t i = 0; i < CHANNELS; i++)
+			circlebuf_pop_front(&sc->data[i], NULL,
+					expected_size);
+	}
+
+	for (size_t i = 0; i < CHANNELS; i++)
+		circlebuf_push_back(&sc->data[i], audio_data->data[i],
+				audio_data->frames * sizeof(float));
+
+	pthread_mutex_unlock(&sc->mutex);
+}
+
+static void old_sidechain_read(struct old_sidechain *sc, uint32_t num_samples)
+{
+	size_t data_size = num_samples * sizeof(float);
+
+	pthread_mutex_lock(&sc->mutex);
+	if (sc->max_frames < num_samples)
+		sc->max_frames = num_samples;
+
+	if (sc->data[0].size < data_size) {
+		pthread_mutex_unlock(&sc->mutex);
+		for (size_t i = 0; i < CHANNELS; i++)
+			memset(sc->buf[i], 0, data_size);
+		return;
+	}
+
+	for (size_t i = 0; i < CHANNELS; i++)
+		circlebuf_pop_front(&sc->data[i], sc->buf[i], data_size);
+
+	pthread_mutex_unlock(&sc->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* after */
+
+static void new_analyze_envelope(struct compressor *comp, float **samples,
+		const uint32_t num_samples)
+{
+	dynamics_peak_envelope(comp->envelope_buf, samples, CHANNELS,
+			num_samples, comp->attack_gain, comp->release_gain,
+			&comp->envelope);
+}
+
+static void new_process_compression(const struct compressor *comp,
+		float **samples, uint32_t num_samples)
+{
+	dynamics_compression_gain(comp->envelope_buf, num_samples,
+			comp->threshold, comp->slope, comp->output_gain);
+
+	for (size_t c = 0; c < CHANNELS; ++c) {
+		if (samples[c])
+			audio_scale_buf(samples[c], comp->envelope_buf,
+					num_samples);
+	}
+}
+
+static struct sidechain_bus *bench_bus_create(void)
+{
+	struct sidechain_bus *bus = bzalloc(sizeof(struct sidechain_bus));
+
+	bus->channels = CHANNELS;
+	bus->frames   = SAMPLE_RATE * BUS_RING_MS / 1000;
+	bus->pos_wrap = bus->frames * BUS_POS_WRAP_RINGS;
+
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		bus->ring[ch] = bzalloc(bus->frames * sizeof(float));
+	return bus;
+}
+
+static void bench_bus_destroy(struct sidechain_bus *bus)
+{
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		bfree(bus->ring[ch]);
+	bfree(bus);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct signal {
+	float *data[CHANNELS];
+	float *work[CHANNELS];
+};
+
+/* a tone with a level that swells above and falls below the threshold */
+static void signal_init(struct signal *signal)
+{
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		signal->data[ch] = bmalloc(FRAMES * BLOCKS * sizeof(float));
+		signal->work[ch] = bmalloc(FRAMES * sizeof(float));
+
+		for (size_t i = 0; i < (size_t)FRAMES * BLOCKS; i++) {
+			double t = (double)i / SAMPLE_RATE;
+			double freq = 440.0 + ch * 110.0;
+			double tone = sin(t * 2.0 * M_PI * freq);
+			double level = 0.5 + 0.45 * sin(t * 2.0 * M_PI * 0.7);
+
+			signal->data[ch][i] = (float)(tone * level);
+		}
+	}
+}
+
+static void signal_free(struct signal *signal)
+{
+	for (size_t ch = 0; ch < CHANNELS; ch++) {
+		bfree(signal->data[ch]);
+		bfree(signal->work[ch]);
+	}
+}
+
+static void load_block(struct signal *signal, size_t block)
+{
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		memcpy(signal->work[ch], signal->data[ch] + block * FRAMES,
+				FRAMES * sizeof(float));
+}
+
+/* compresses the whole signal, returns the time spent compressing in ns and
+ * a checksum of the output */
+static uint64_t run_compressor(struct signal *signal, bool after,
+		double *checksum)
+{
+	struct compressor comp;
+	uint64_t total = 0;
+
+	compressor_init(&comp);
+	*checksum = 0.0;
+
+	for (size_t block = 0; block < BLOCKS; block++) {
+		uint64_t start;
+
+		load_block(signal, block);
+
+		start = os_gettime_ns();
+		if (after) {
+			new_analyze_envelope(&comp, signal->work, FRAMES);
+			new_process_compression(&comp, signal->work, FRAMES);
+		} else {
+			old_analyze_envelope(&comp, signal->work, FRAMES);
+			old_process_compression(&comp, signal->work, FRAMES);
+		}
+		total += os_gettime_ns() - start;
+
+		for (size_t ch = 0; ch < CHANNELS; ch++)
+			for (size_t i = 0; i < FRAMES; i++)
+				*checksum += (double)signal->work[ch][i] *
+					(double)(i + 1);
+	}
+
+	bfree(comp.envelope_buf);
+	return total;
+}
+
+/* the key source captures one block and every compressor keyed off of it
+ * reads it, returns the time in ns */
+static uint64_t run_sidechain(struct signal *signal, size_t compressors,
+		bool after)
+{
+	struct old_sidechain *old = bzalloc(compressors * sizeof(*old));
+	struct sidechain_reader *readers = bzalloc(compressors *
+			sizeof(*readers));
+	struct sidechain_bus *bus = bench_bus_create();
+	float *buf[CHANNELS];
+	uint64_t start;
+	uint64_t end;
+
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		buf[ch] = bmalloc(FRAMES * sizeof(float));
+
+	for (size_t i = 0; i < compressors; i++) {
+		pthread_mutex_init(&old[i].mutex, NULL);
+		for (size_t ch = 0; ch < CHANNELS; ch++)
+			old[i].buf[ch] = bmalloc(FRAMES * sizeof(float));
+		sidechain_reader_init(&readers[i], bus);
+	}
+
+	start = os_gettime_ns();
+
+	for (size_t block = 0; block < BLOCKS; block++) {
+		struct audio_data audio = {0};
+
+		for (size_t ch = 0; ch < CHANNELS; ch++)
+			audio.data[ch] = (uint8_t*)(signal->data[ch] +
+					block * FRAMES);
+		audio.frames = FRAMES;
+
+		if (after) {
+			bus_capture(bus, NULL, &audio, false);
+			for (size_t i = 0; i < compressors; i++)
+				sidechain_reader_read(&readers[i], buf,
+						CHANNELS, FRAMES);
+		} else {
+			for (size_t i = 0; i < compressors; i++)
+				old_sidechain_capture(&old[i], &audio);
+			for (size_t i = 0; i < compressors; i++)
+				old_sidechain_read(&old[i], FRAMES);
+		}
+	}
+
+	end = os_gettime_ns();
+
+	for (size_t i = 0; i < compressors; i++) {
+		pthread_mutex_destroy(&old[i].mutex);
+		for (size_t ch = 0; ch < CHANNELS; ch++) {
+			circlebuf_free(&old[i].data[ch]);
+			bfree(old[i].buf[ch]);
+		}
+	}
+	for (size_t ch = 0; ch < CHANNELS; ch++)
+		bfree(buf[ch]);
+
+	bench_bus_destroy(bus);
+	bfree(readers);
+	bfree(old);
+	return end - start;
+}
+
+static double best_compressor_us(struct signal *signal, bool after,
+		double *checksum)
+{
+	uint64_t best = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t time = run_compressor(signal, after, checksum);
+		if (!best || time < best)
+			best = time;
+	}
+
+	return (double)best / 1000.0 / BLOCKS;
+}
+
+static double best_sidechain_us(struct signal *signal, size_t compressors,
+		bool after)
+{
+	uint64_t best = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t time = run_sidechain(signal, compressors, after);
+		if (!best || time < best)
+			best = time;
+	}
+
+	return (double)best / 1000.0 / BLOCKS;
+}
+
+int main(void)
+{
+	static const size_t compressors[] = {1, 4, 16};
+	struct signal signal;
+	char name[32];
+	double before_sum;
+	double after_sum;
+	double before;
+	double after;
+
+	signal_init(&signal);
+
+	snprintf(name, sizeof(name), "per %d frame stereo block", FRAMES);
+	printf("%-28s %10s %10s\n", name, "before", "after");
+
+	before = best_compressor_us(&signal, false, &before_sum);
+	after = best_compressor_us(&signal, true, &after_sum);
+	printf("%-28s %7.2f us %7.2f us%s\n", "compressor", before, after,
+			before_sum == after_sum ? "" : "  (output differs)");
+
+	for (size_t i = 0; i < sizeof(compressors) / sizeof(compressors[0]);
+	     i++) {
+		before = best_sidechain_us(&signal, compressors[i], false);
+		after = best_sidechain_us(&signal, compressors[i], true);
+		snprintf(name, sizeof(name), "sidechain, %d readers",
+				(int)compressors[i]);
+		printf("%-28s %7.2f us %7.2f us\n", name, before, after);
+	}
+
+	signal_free(&signal);
+	return before_sum == after_sum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,279 @@
+/*
+ * Runs every implementation of the audio-math.c kernels the CPU supports
+ * (C, SSE, AVX when cpuid reports it, NEON on ARM) against a plain scalar
+ * reference written out here, and fails unless they all give the same
+ * results bit for bit.
+ *
+ * audio-math.c is compiled into the test because the per-ISA functions are
+ * static and normally only reached through its runtime dispatch.  Counts
+ * around each vector size and misaligned buffers check the scalar tails and
+ * that no alignment is needed, and a guard after every buffer checks that
+ * nothing is written past the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media-io/audio-math.c>
+#include <util/bmem.h>
+
+#define MAX_COUNT    1100
+#define GUARD        16
+#define MAX_CHANNELS 8
+
+struct math_impl {
+	const char                    *name;
+	const struct audio_math_funcs *funcs;
+};
+
+static size_t get_math_impls(struct math_impl *impls)
+{
+	size_t count = 0;
+
+	impls[count++] = (struct math_impl){"C", &funcs_c};
+#ifdef AUDIO_MATH_SSE
+	impls[count++] = (struct math_impl){"SSE", &funcs_sse};
+#endif
+#ifdef AUDIO_MATH_AVX
+	if (cpu_has_avx())
+		impls[count++] = (struct math_impl){"AVX", &funcs_avx};
+#endif
+#ifdef AUDIO_MATH_NEON
+	impls[count++] = (struct math_impl){"NEON", &funcs_neon};
+#endif
+
+	return count;
+}
+
+/* ------------------------------------------------------------------------- */
+/* reference */
+
+enum kernel {
+	KERNEL_MIX,
+	KERNEL_MIX_GAIN,
+	KERNEL_MIX_BUF,
+	KERNEL_SCALE,
+	KERNEL_SCALE_BUF,
+	KERNEL_CLAMP,
+	KERNEL_DOWNMIX,
+	KERNEL_DOWNMIX_IN_PLACE,
+	KERNEL_COUNT
+};
+
+static const char *kernel_names[] = {
+	"mix", "mix_gain", "mix_buf", "scale", "scale_buf", "clamp",
+	"downmix", "downmix in place"
+};
+
+struct buffers {
+	float *dst;
+	float *src[MAX_CHANNELS];
+	float *gains;
+	float gain;
+	size_t channels;
+};
+
+static void run_reference(enum kernel kernel, struct buffers *b, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float sum;
+
+		switch (kernel) {
+		case KERNEL_MIX:
+			b->dst[i] = b->dst[i] + b->src[0][i];
+			break;
+		case KERNEL_MIX_GAIN:
+			b->dst[i] = b->dst[i] + b->src[0][i] * b->gain;
+			break;
+		case KERNEL_MIX_BUF:
+			b->dst[i] = b->dst[i] + b->src[0][i] * b->gains[i];
+			break;
+		case KERNEL_SCALE:
+			b->dst[i] = b->dst[i] * b->gain;
+			break;
+		case KERNEL_SCALE_BUF:
+			b->dst[i] = b->dst[i] * b->gains[i];
+			break;
+		case KERNEL_CLAMP:
+			if (b->dst[i] > 1.0f)
+				b->dst[i] = 1.0f;
+			else if (b->dst[i] < -1.0f)
+				b->dst[i] = -1.0f;
+			break;
+		case KERNEL_DOWNMIX:
+		case KERNEL_DOWNMIX_IN_PLACE:
+			sum = b->src[0][i];
+			for (size_t ch = 1; ch < b->channels; ch++)
+				sum = sum + b->src[ch][i];
+			b->dst[i] = sum * (1.0f / (float)b->channels);
+			break;
+		case KERNEL_COUNT:
+			break;
+		}
+	}
+}
+
+static void run_impl(const struct audio_math_funcs *funcs,
+		enum kernel kernel, struct buffers *b, size_t count)
+{
+	switch (kernel) {
+	case KERNEL_MIX:
+		funcs->mix(b->dst, b->src[0], count);
+		break;
+	case KERNEL_MIX_GAIN:
+		funcs->mix_gain(b->dst, b->src[0], b->gain, count);
+		break;
+	case KERNEL_MIX_BUF:
+		funcs->mix_buf(b->dst, b->src[0], b->gains, count);
+		break;
+	case KERNEL_SCALE:
+		funcs->scale(b->dst, b->gain, count);
+		break;
+	case KERNEL_SCALE_BUF:
+		funcs->scale_buf(b->dst, b->gains, count);
+		break;
+	case KERNEL_CLAMP:
+		funcs->clamp(b->dst, count);
+		break;
+	case KERNEL_DOWNMIX:
+	case KERNEL_DOWNMIX_IN_PLACE:
+		funcs->downmix(b->dst, (const float *const *)b->src,
+				b->channels, 0, count);
+		break;
+	case KERNEL_COUNT:
+		break;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t rand_state = 1;
+
+static uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+/* mostly ordinary samples, with some edge values mixed in */
+static float rand_sample(bool special)
+{
+	static const float specials[] = {0.0f, -0.0f, 1.0f, -1.0f,
+		1.0e-40f, -1.0e-40f, 3.0e38f, INFINITY, -INFINITY, NAN};
+	uint32_t r = next_rand();
+
+	if (r % 16 == 0) {
+		size_t num = special ? sizeof(specials) / sizeof(specials[0]) :
+			6;
+		return specials[(r / 16) % num];
+	}
+
+	return ((float)(r & 0xFFFF) / 32768.0f - 1.0f) * 2.0f;
+}
+
+static void fill(float *data, size_t count, bool special)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = rand_sample(special);
+}
+
+/* misaligns each buffer by offset floats */
+static void buffers_init(struct buffers *b, float *storage[], size_t offset,
+		size_t count, size_t channels, bool special)
+{
+	b->dst = storage[0] + offset;
+	b->gains = storage[1] + offset;
+	for (size_t ch = 0; ch < MAX_CHANNELS; ch++)
+		b->src[ch] = storage[2 + ch] + offset;
+
+	fill(b->dst, count + GUARD, special);
+	fill(b->gains, count, special);
+	for (size_t ch = 0; ch < MAX_CHANNELS; ch++)
+		fill(b->src[ch], count, special);
+
+	b->gain = rand_sample(false);
+	b->channels = channels;
+}
+
+static bool test_kernel(const struct math_impl *impls, size_t impl_count,
+		enum kernel kernel, size_t count, size_t offset,
+		size_t channels)
+{
+	float *storage[2][2 + MAX_CHANNELS];
+	struct buffers expected;
+	struct buffers actual;
+	bool special = kernel == KERNEL_CLAMP;
+	bool success = true;
+	uint32_t seed;
+
+	for (size_t i = 0; i < 2; i++)
+		for (size_t j = 0; j < 2 + MAX_CHANNELS; j++)
+			storage[i][j] = bmalloc((MAX_COUNT + GUARD + 4) *
+					sizeof(float));
+
+	seed = rand_state;
+	buffers_init(&expected, storage[0], offset, count, channels, special);
+	if (kernel == KERNEL_DOWNMIX_IN_PLACE)
+		expected.src[0] = expected.dst;
+	run_reference(kernel, &expected, count);
+
+	for (size_t i = 0; i < impl_count; i++) {
+		rand_state = seed;
+		buffers_init(&actual, storage[1], offset, count, channels,
+				special);
+		if (kernel == KERNEL_DOWNMIX_IN_PLACE)
+			actual.src[0] = actual.dst;
+		run_impl(impls[i].funcs, kernel, &actual, count);
+
+		if (memcmp(actual.dst, expected.dst,
+				(count + GUARD) * sizeof(float)) != 0) {
+			fprintf(stderr, "%s %s, %d samples, offset %d, "
+					"%d channels: differs from the "
+					"reference\n", impls[i].name,
+					kernel_names[kernel], (int)count,
+					(int)offset, (int)channels);
+			success = false;
+		}
+	}
+
+	for (size_t i = 0; i < 2; i++)
+		for (size_t j = 0; j < 2 + MAX_CHANNELS; j++)
+			bfree(storage[i][j]);
+	return success;
+}
+
+int main(void)
+{
+	struct math_impl impls[4];
+	size_t impl_count = get_math_impls(impls);
+	bool success = true;
+
+	for (int k = 0; k < KERNEL_COUNT; k++) {
+		bool downmix = k == KERNEL_DOWNMIX ||
+			k == KERNEL_DOWNMIX_IN_PLACE;
+		size_t max_channels = downmix ? MAX_CHANNELS : 1;
+
+		for (size_t channels = 1; channels <= max_channels;
+		     channels++) {
+			/* every count around the vector sizes, and a full
+			 * audio block with a tail */
+			for (size_t count = 0; count <= 40; count++)
+				for (size_t offset = 0; offset < 4; offset++)
+					success &= test_kernel(impls,
+							impl_count, k, count,
+							offset, channels);
+
+			success &= test_kernel(impls, impl_count, k, 1024, 0,
+					channels);
+			success &= test_kernel(impls, impl_count, k,
+					MAX_COUNT - 3, 3, channels);
+		}
+	}
+
+	for (size_t i = 1; i < impl_count; i++)
+		printf("%s ", impls[i].name);
+	printf("%s\n", success ? "audio math matches the reference" :
+			"audio math differs from the reference");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
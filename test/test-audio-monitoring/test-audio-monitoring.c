@@ -0,0 +1,363 @@
+/*
+ * Monitors a tone source through PulseAudio in low latency mode, into a null
+ * sink the test loads itself, and fails unless the monitoring statistics show
+ * the latency held near the target with no underruns and the rate correction
+ * within its limit once playback has settled.
+ *
+ * Needs a running PulseAudio server.  Without one the test exits with
+ * SKIP_CODE, which CTest reports as skipped, so it can stay enabled on
+ * machines without audio; CI has to start "pulseaudio --daemonize" (no sound
+ * card is needed) for it to actually run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <pulse/pulseaudio.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define SKIP_CODE         77
+#define SINK_NAME         "obs_test_monitoring"
+#define SAMPLE_RATE       48000
+#define CHUNK_FRAMES      480
+#define TARGET_MS         40
+#define LATENCY_SLACK_MS  20
+#define SETTLE_MS         2000
+#define MEASURE_MS        5000
+#define POLL_MS           100
+
+/* ------------------------------------------------------------------------- */
+/* null sink */
+
+struct pulse {
+	pa_threaded_mainloop *mainloop;
+	pa_context *context;
+	uint32_t module;
+};
+
+static void context_state(pa_context *c, void *param)
+{
+	struct pulse *pulse = param;
+
+	UNUSED_PARAMETER(c);
+	pa_threaded_mainloop_signal(pulse->mainloop, 0);
+}
+
+static void module_loaded(pa_context *c, uint32_t idx, void *param)
+{
+	struct pulse *pulse = param;
+
+	UNUSED_PARAMETER(c);
+	pulse->module = idx;
+	pa_threaded_mainloop_signal(pulse->mainloop, 0);
+}
+
+static void module_unloaded(pa_context *c, int success, void *param)
+{
+	struct pulse *pulse = param;
+
+	UNUSED_PARAMETER(c);
+	UNUSED_PARAMETER(success);
+	pa_threaded_mainloop_signal(pulse->mainloop, 0);
+}
+
+static void wait_operation(struct pulse *pulse, pa_operation *op)
+{
+	if (!op)
+		return;
+
+	while (pa_operation_get_state(op) == PA_OPERATION_RUNNING)
+		pa_threaded_mainloop_wait(pulse->mainloop);
+	pa_operation_unref(op);
+}
+
+static void pulse_disconnect(struct pulse *pulse)
+{
+	if (pulse->context) {
+		pa_threaded_mainloop_lock(pulse->mainloop);
+		pa_context_disconnect(pulse->context);
+		pa_context_unref(pulse->context);
+		pa_threaded_mainloop_unlock(pulse->mainloop);
+	}
+
+	pa_threaded_mainloop_stop(pulse->mainloop);
+	pa_threaded_mainloop_free(pulse->mainloop);
+}
+
+/* returns false if there is no server to connect to */
+static bool pulse_connect(struct pulse *pulse)
+{
+	pa_context_state_t state;
+
+	pulse->mainloop = pa_threaded_mainloop_new();
+	pulse->module = PA_INVALID_INDEX;
+	pa_threaded_mainloop_start(pulse->mainloop);
+
+	pa_threaded_mainloop_lock(pulse->mainloop);
+	pulse->context = pa_context_new(
+			pa_threaded_mainloop_get_api(pulse->mainloop),
+			"test-audio-monitoring");
+	pa_context_set_state_callback(pulse->context, context_state, pulse);
+	pa_context_connect(pulse->context, NULL, PA_CONTEXT_NOAUTOSPAWN, NULL);
+
+	for (;;) {
+		state = pa_context_get_state(pulse->context);
+		if (state == PA_CONTEXT_READY || !PA_CONTEXT_IS_GOOD(state))
+			break;
+		pa_threaded_mainloop_wait(pulse->mainloop);
+	}
+	pa_threaded_mainloop_unlock(pulse->mainloop);
+
+	if (state != PA_CONTEXT_READY) {
+		pulse_disconnect(pulse);
+		return false;
+	}
+
+	return true;
+}
+
+static bool load_null_sink(struct pulse *pulse)
+{
+	pa_threaded_mainloop_lock(pulse->mainloop);
+	wait_operation(pulse, pa_context_load_module(pulse->context,
+			"module-null-sink", "sink_name=" SINK_NAME
+			" rate=48000 channels=2", module_loaded, pulse));
+	pa_threaded_mainloop_unlock(pulse->mainloop);
+
+	return pulse->module != PA_INVALID_INDEX;
+}
+
+static void unload_null_sink(struct pulse *pulse)
+{
+	if (pulse->module == PA_INVALID_INDEX)
+		return;
+
+	pa_threaded_mainloop_lock(pulse->mainloop);
+	wait_operation(pulse, pa_context_unload_module(pulse->context,
+			pulse->module, module_unloaded, pulse));
+	pa_threaded_mainloop_unlock(pulse->mainloop);
+}
+
+/* ------------------------------------------------------------------------- */
+/* a source that outputs a tone in real time */
+
+struct tone {
+	obs_source_t *source;
+	pthread_t thread;
+	os_event_t *stop;
+	float *data[2];
+};
+
+static const char *tone_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Tone";
+}
+
+static void *tone_thread(void *param)
+{
+	struct tone *tone = param;
+	uint64_t start = os_gettime_ns();
+	uint64_t frames = 0;
+
+	while (os_event_try(tone->stop) == EAGAIN) {
+		struct obs_source_audio audio = {0};
+
+		for (size_t i = 0; i < CHUNK_FRAMES; i++) {
+			double t = (double)(frames + i) / SAMPLE_RATE;
+			float v = (float)(0.25 * sin(t * 2.0 * M_PI * 440.0));
+			tone->data[0][i] = tone->data[1][i] = v;
+		}
+
+		audio.data[0]         = (uint8_t*)tone->data[0];
+		audio.data[1]         = (uint8_t*)tone->data[1];
+		audio.frames          = CHUNK_FRAMES;
+		audio.speakers        = SPEAKERS_STEREO;
+		audio.format          = AUDIO_FORMAT_FLOAT_PLANAR;
+		audio.samples_per_sec = SAMPLE_RATE;
+		audio.timestamp       = start +
+			frames * 1000000000ULL / SAMPLE_RATE;
+		obs_source_output_audio(tone->source, &audio);
+
+		frames += CHUNK_FRAMES;
+		os_sleepto_ns(start + frames * 1000000000ULL / SAMPLE_RATE);
+	}
+
+	return NULL;
+}
+
+static void *tone_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct tone *tone = bzalloc(sizeof(struct tone));
+	tone->source = source;
+	tone->data[0] = bmalloc(CHUNK_FRAMES * sizeof(float));
+	tone->data[1] = bmalloc(CHUNK_FRAMES * sizeof(float));
+
+	os_event_init(&tone->stop, OS_EVENT_TYPE_MANUAL);
+	pthread_create(&tone->thread, NULL, tone_thread, tone);
+
+	UNUSED_PARAMETER(settings);
+	return tone;
+}
+
+static void tone_destroy(void *data)
+{
+	struct tone *tone = data;
+
+	os_event_signal(tone->stop);
+	pthread_join(tone->thread, NULL);
+	os_event_destroy(tone->stop);
+
+	bfree(tone->data[0]);
+	bfree(tone->data[1]);
+	bfree(tone);
+}
+
+static struct obs_source_info tone_info = {
+	.id           = "test_tone",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name     = tone_name,
+	.create       = tone_create,
+	.destroy      = tone_destroy,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static bool get_stats(obs_source_t *source,
+		struct obs_audio_monitoring_stats *stats)
+{
+	if (!obs_source_get_audio_monitoring_stats(source, stats)) {
+		fprintf(stderr, "no monitoring statistics\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool check_monitoring(obs_source_t *source)
+{
+	struct obs_audio_monitoring_stats stats;
+	const uint64_t target = TARGET_MS * 1000000ULL;
+	const uint64_t max_latency = target + LATENCY_SLACK_MS * 1000000ULL;
+	uint64_t latency_total = 0;
+	uint64_t latency_max = 0;
+	uint32_t underruns;
+	int samples = 0;
+
+	os_sleep_ms(SETTLE_MS);
+
+	if (!get_stats(source, &stats))
+		return false;
+	if (stats.target_latency_ns != target) {
+		fprintf(stderr, "target latency is %d ms, expected %d ms\n",
+				(int)(stats.target_latency_ns / 1000000),
+				TARGET_MS);
+		return false;
+	}
+
+	underruns = stats.underruns;
+
+	for (int ms = 0; ms < MEASURE_MS; ms += POLL_MS) {
+		os_sleep_ms(POLL_MS);
+		if (!get_stats(source, &stats))
+			return false;
+
+		if (stats.rate_adjust_ppm > 1000 ||
+		    stats.rate_adjust_ppm < -1000) {
+			fprintf(stderr, "rate correction of %d ppm\n",
+					(int)stats.rate_adjust_ppm);
+			return false;
+		}
+
+		latency_total += stats.latency_ns;
+		if (stats.latency_ns > latency_max)
+			latency_max = stats.latency_ns;
+		samples++;
+	}
+
+	printf("latency %.1f ms average, %.1f ms max, %d ppm correction\n",
+			(double)latency_total / samples / 1000000.0,
+			(double)latency_max / 1000000.0,
+			(int)stats.rate_adjust_ppm);
+
+	if (stats.underruns != underruns) {
+		fprintf(stderr, "%d underruns while playing\n",
+				(int)(stats.underruns - underruns));
+		return false;
+	}
+	if (!latency_total || latency_max > max_latency) {
+		fprintf(stderr, "latency was not kept under %d ms\n",
+				TARGET_MS + LATENCY_SLACK_MS);
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_monitoring(void)
+{
+	struct obs_audio_info oai = {SAMPLE_RATE, SPEAKERS_STEREO};
+	obs_source_t *source;
+	bool success;
+
+	if (!obs_reset_audio(&oai)) {
+		fprintf(stderr, "obs_reset_audio failed\n");
+		return false;
+	}
+
+	obs_set_audio_monitoring_device("Test null sink",
+			SINK_NAME ".monitor");
+	obs_set_audio_monitoring_latency(TARGET_MS);
+	obs_register_source(&tone_info);
+
+	source = obs_source_create("test_tone", "tone", NULL, NULL);
+	obs_set_output_source(0, source);
+	obs_source_set_monitoring_type(source,
+			OBS_MONITORING_TYPE_MONITOR_ONLY);
+
+	success = check_monitoring(source);
+
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+	return success;
+}
+
+int main(void)
+{
+	struct pulse pulse = {0};
+	bool success = false;
+
+	if (!pulse_connect(&pulse)) {
+		printf("no PulseAudio server, skipped\n");
+		return SKIP_CODE;
+	}
+
+	if (!load_null_sink(&pulse)) {
+		fprintf(stderr, "could not load module-null-sink\n");
+		pulse_disconnect(&pulse);
+		return EXIT_FAILURE;
+	}
+
+	if (obs_startup("en-US", NULL, NULL)) {
+		success = run_monitoring();
+		obs_shutdown();
+	} else {
+		fprintf(stderr, "obs_startup failed\n");
+	}
+
+	unload_null_sink(&pulse);
+	pulse_disconnect(&pulse);
+
+	printf("%s\n", success ? "monitoring held the target latency" :
+			"monitoring missed the target latency");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
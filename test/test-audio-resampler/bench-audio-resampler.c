@@ -0,0 +1,196 @@
+/*
+ * Times the built-in polyphase resampler (through audio_resampler_create)
+ * against swresample with its default settings, on twenty seconds of
+ * stereo planar float noise fed in chunks of CHUNK_FRAMES.  Prints the best
+ * of RUNS runs as nanoseconds per output frame and how many times faster
+ * than real time that is.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+
+#include <media-io/audio-resampler.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define CHUNK_FRAMES 1024
+#define SECONDS      20
+#define RUNS         5
+
+struct bench_input {
+	float    *planes[2];
+	uint32_t rate;
+	size_t   frames;
+};
+
+static void make_input(struct bench_input *input, uint32_t rate)
+{
+	uint32_t seed = 1;
+
+	input->rate = rate;
+	input->frames = (size_t)rate * SECONDS;
+
+	for (size_t ch = 0; ch < 2; ch++) {
+		input->planes[ch] = bmalloc(input->frames * sizeof(float));
+
+		for (size_t i = 0; i < input->frames; i++) {
+			seed = seed * 1103515245 + 12345;
+			input->planes[ch][i] = (float)((seed >> 16) & 0x7FFF) /
+				32768.0f - 0.5f;
+		}
+	}
+}
+
+static void free_input(struct bench_input *input)
+{
+	bfree(input->planes[0]);
+	bfree(input->planes[1]);
+}
+
+static inline uint32_t chunk_frames(const struct bench_input *input,
+		size_t pos)
+{
+	return (uint32_t)(input->frames - pos < CHUNK_FRAMES ?
+			input->frames - pos : CHUNK_FRAMES);
+}
+
+/* returns the time taken in ns, and the number of frames output */
+static uint64_t run_obs(const struct bench_input *input, uint32_t out_rate,
+		size_t *out_total)
+{
+	struct resample_info src = {input->rate, AUDIO_FORMAT_FLOAT_PLANAR,
+		SPEAKERS_STEREO};
+	struct resample_info dst = {out_rate, AUDIO_FORMAT_FLOAT_PLANAR,
+		SPEAKERS_STEREO};
+	audio_resampler_t *rs = audio_resampler_create(&dst, &src);
+	uint64_t start;
+	uint64_t end;
+
+	if (!rs)
+		return 0;
+
+	*out_total = 0;
+	start = os_gettime_ns();
+
+	for (size_t pos = 0; pos < input->frames; pos += CHUNK_FRAMES) {
+		const uint8_t *in[MAX_AV_PLANES] = {
+			(const uint8_t*)(input->planes[0] + pos),
+			(const uint8_t*)(input->planes[1] + pos)
+		};
+		uint8_t *out[MAX_AV_PLANES];
+		uint32_t out_frames;
+		uint64_t ts_offset;
+
+		audio_resampler_resample(rs, out, &out_frames, &ts_offset,
+				in, chunk_frames(input, pos));
+		*out_total += out_frames;
+	}
+
+	end = os_gettime_ns();
+	audio_resampler_destroy(rs);
+	return end - start;
+}
+
+static uint64_t run_swr(const struct bench_input *input, uint32_t out_rate,
+		size_t *out_total)
+{
+	struct SwrContext *swr;
+	uint8_t *out[2];
+	int max_out;
+	uint64_t start;
+	uint64_t end;
+
+	swr = swr_alloc_set_opts(NULL,
+			AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, out_rate,
+			AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, input->rate,
+			0, NULL);
+	if (!swr)
+		return 0;
+	if (swr_init(swr) < 0) {
+		swr_free(&swr);
+		return 0;
+	}
+
+	max_out = (int)((uint64_t)CHUNK_FRAMES * out_rate / input->rate) +
+		256;
+	out[0] = bmalloc(max_out * sizeof(float));
+	out[1] = bmalloc(max_out * sizeof(float));
+
+	*out_total = 0;
+	start = os_gettime_ns();
+
+	for (size_t pos = 0; pos < input->frames; pos += CHUNK_FRAMES) {
+		const uint8_t *in[2] = {
+			(const uint8_t*)(input->planes[0] + pos),
+			(const uint8_t*)(input->planes[1] + pos)
+		};
+		int ret = swr_convert(swr, out, max_out, in,
+				(int)chunk_frames(input, pos));
+
+		if (ret > 0)
+			*out_total += (size_t)ret;
+	}
+
+	end = os_gettime_ns();
+
+	bfree(out[0]);
+	bfree(out[1]);
+	swr_free(&swr);
+	return end - start;
+}
+
+typedef uint64_t (*run_func)(const struct bench_input *input,
+		uint32_t out_rate, size_t *out_total);
+
+static void bench(const char *name, run_func run,
+		const struct bench_input *input, uint32_t out_rate)
+{
+	uint64_t best = 0;
+	size_t frames = 0;
+
+	for (int i = 0; i < RUNS; i++) {
+		uint64_t time = run(input, out_rate, &frames);
+
+		if (!time) {
+			printf("%-10s %6u -> %6u Hz: could not create "
+					"resampler\n", name, input->rate,
+					out_rate);
+			return;
+		}
+		if (!best || time < best)
+			best = time;
+	}
+
+	printf("%-10s %6u -> %6u Hz: %7.2f ns/frame, %6.0fx real time\n",
+			name, input->rate, out_rate,
+			(double)best / (double)(frames ? frames : 1),
+			(double)SECONDS * 1000000000.0 / (double)best);
+}
+
+int main(void)
+{
+	static const struct {
+		uint32_t in_rate;
+		uint32_t out_rate;
+	} conversions[] = {
+		{44100, 48000},
+		{48000, 44100},
+		{32000, 48000},
+	};
+
+	for (size_t i = 0; i < sizeof(conversions) / sizeof(conversions[0]);
+	     i++) {
+		struct bench_input input;
+
+		make_input(&input, conversions[i].in_rate);
+		bench("polyphase", run_obs, &input, conversions[i].out_rate);
+		bench("swresample", run_swr, &input, conversions[i].out_rate);
+		free_input(&input);
+	}
+
+	return 0;
+}
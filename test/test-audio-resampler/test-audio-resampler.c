@@ -0,0 +1,279 @@
+/*
+ * Resamples sine waves and measures the signal to noise ratio of the output
+ * against the ideal sine at the output rate, and how much of a tone above the
+ * output's Nyquist frequency aliases back into it.
+ *
+ * The conversions here all use the built-in polyphase resampler, whose
+ * output frame 0 is at the time of input frame 0, so the ideal output needs
+ * no delay.  It replaced swresample for these conversions and uses the same
+ * cutoff and Kaiser window as swresample's defaults, so everything up to
+ * 20 kHz has to come through cleanly and aliasing has to stay below -90 dB.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media-io/audio-resampler.h>
+#include <util/bmem.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define CHUNK_FRAMES 480
+#define SECONDS      2
+
+/* passband tones are reproduced with at least this SNR */
+#define MIN_SNR_DB   88.0
+/* tones above the output Nyquist frequency are at least this much lower */
+#define MIN_ALIAS_DB 90.0
+/* 16 bit input is limited by its own quantization noise */
+#define MIN_S16_SNR_DB 85.0
+
+struct result {
+	float  *data;
+	size_t frames;
+};
+
+/* resamples a stereo sine of freq hz, in chunks of chunk frames (all at
+ * once if 0) */
+static bool resample_sine(struct result *result, uint32_t in_rate,
+		uint32_t out_rate, enum audio_format in_format, double freq,
+		size_t chunk)
+{
+	struct resample_info src = {in_rate, in_format, SPEAKERS_STEREO};
+	struct resample_info dst = {out_rate, AUDIO_FORMAT_FLOAT_PLANAR,
+		SPEAKERS_STEREO};
+	audio_resampler_t *rs = audio_resampler_create(&dst, &src);
+	size_t in_frames = (size_t)in_rate * SECONDS;
+	size_t max_out = (size_t)out_rate * SECONDS + 1024;
+	float *in_f = bmalloc(in_frames * 2 * sizeof(float));
+	int16_t *in_s16 = bmalloc(in_frames * 2 * sizeof(int16_t));
+
+	if (!rs) {
+		fprintf(stderr, "could not create %u -> %u Hz resampler\n",
+				in_rate, out_rate);
+		bfree(in_f);
+		bfree(in_s16);
+		return false;
+	}
+
+	for (size_t i = 0; i < in_frames; i++) {
+		double val = 0.5 * sin(2.0 * M_PI * freq * (double)i /
+				(double)in_rate);
+
+		in_f[i] = in_f[in_frames + i] = (float)val;
+		in_s16[i * 2] = in_s16[i * 2 + 1] =
+			(int16_t)lrint(val * 32767.0);
+	}
+
+	result->data = bmalloc(max_out * sizeof(float));
+	result->frames = 0;
+
+	if (!chunk)
+		chunk = in_frames;
+
+	for (size_t pos = 0; pos < in_frames; pos += chunk) {
+		uint32_t frames = (uint32_t)(in_frames - pos < chunk ?
+				in_frames - pos : chunk);
+		const uint8_t *input[MAX_AV_PLANES] = {0};
+		uint8_t *output[MAX_AV_PLANES] = {0};
+		uint32_t out_frames = 0;
+		uint64_t ts_offset;
+
+		if (in_format == AUDIO_FORMAT_16BIT) {
+			input[0] = (const uint8_t*)(in_s16 + pos * 2);
+		} else {
+			input[0] = (const uint8_t*)(in_f + pos);
+			input[1] = (const uint8_t*)(in_f + in_frames + pos);
+		}
+
+		audio_resampler_resample(rs, output, &out_frames, &ts_offset,
+				input, frames);
+
+		if (result->frames + out_frames > max_out)
+			out_frames = (uint32_t)(max_out - result->frames);
+
+		memcpy(result->data + result->frames, output[1],
+				out_frames * sizeof(float));
+		result->frames += out_frames;
+	}
+
+	audio_resampler_destroy(rs);
+	bfree(in_f);
+	bfree(in_s16);
+	return true;
+}
+
+/* the start of the output rings from the sine starting abruptly */
+static inline size_t skip_frames(uint32_t out_rate)
+{
+	return out_rate / 20;
+}
+
+static double snr_db(const struct result *result, uint32_t out_rate,
+		double freq)
+{
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (size_t i = skip_frames(out_rate); i < result->frames; i++) {
+		double ideal = 0.5 * sin(2.0 * M_PI * freq * (double)i /
+				(double)out_rate);
+		double diff = (double)result->data[i] - ideal;
+
+		signal += ideal * ideal;
+		noise += diff * diff;
+	}
+
+	return noise > 0.0 ? 10.0 * log10(signal / noise) : 999.0;
+}
+
+/* level of the output relative to the input sine */
+static double level_db(const struct result *result, uint32_t out_rate)
+{
+	double power = 0.0;
+	size_t count = 0;
+
+	for (size_t i = skip_frames(out_rate); i < result->frames; i++) {
+		power += (double)result->data[i] * (double)result->data[i];
+		count++;
+	}
+
+	power /= count ? (double)count : 1.0;
+	return power > 0.0 ? 10.0 * log10(power / 0.125) : -999.0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool test_passband(uint32_t in_rate, uint32_t out_rate,
+		enum audio_format format, double freq, double min_snr)
+{
+	struct result result;
+	double snr;
+
+	if (!resample_sine(&result, in_rate, out_rate, format, freq,
+				CHUNK_FRAMES))
+		return false;
+
+	snr = snr_db(&result, out_rate, freq);
+	bfree(result.data);
+
+	if (result.frames < (size_t)out_rate * SECONDS - 1024) {
+		fprintf(stderr, "%u -> %u Hz: only %d frames of output\n",
+				in_rate, out_rate, (int)result.frames);
+		return false;
+	}
+	if (snr < min_snr) {
+		const char *bits = format == AUDIO_FORMAT_16BIT ?
+			" (16 bit)" : "";
+
+		fprintf(stderr, "%u -> %u Hz, %.0f Hz%s: SNR %.1f dB, "
+				"expected at least %.0f dB\n",
+				in_rate, out_rate, freq, bits, snr, min_snr);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_alias(uint32_t in_rate, uint32_t out_rate, double freq)
+{
+	struct result result;
+	double level;
+
+	if (!resample_sine(&result, in_rate, out_rate,
+				AUDIO_FORMAT_FLOAT_PLANAR, freq, CHUNK_FRAMES))
+		return false;
+
+	level = level_db(&result, out_rate);
+	bfree(result.data);
+
+	if (level > -MIN_ALIAS_DB) {
+		fprintf(stderr, "%u -> %u Hz, %.0f Hz: aliases at %.1f dB, "
+				"expected below %.0f dB\n", in_rate, out_rate,
+				freq, level, -MIN_ALIAS_DB);
+		return false;
+	}
+
+	return true;
+}
+
+/* the output doesn't depend on how the input is split up */
+static bool test_chunks(uint32_t in_rate, uint32_t out_rate)
+{
+	static const size_t chunks[] = {1, 7, CHUNK_FRAMES, 1031};
+	struct result whole;
+	bool success = true;
+
+	if (!resample_sine(&whole, in_rate, out_rate,
+				AUDIO_FORMAT_FLOAT_PLANAR, 1000.0, 0))
+		return false;
+
+	for (size_t c = 0; success && c < sizeof(chunks) / sizeof(chunks[0]);
+	     c++) {
+		struct result split;
+		size_t frames;
+
+		if (!resample_sine(&split, in_rate, out_rate,
+					AUDIO_FORMAT_FLOAT_PLANAR, 1000.0,
+					chunks[c])) {
+			success = false;
+			break;
+		}
+
+		frames = split.frames < whole.frames ?
+			split.frames : whole.frames;
+		if (memcmp(split.data, whole.data, frames * sizeof(float))) {
+			fprintf(stderr, "%u -> %u Hz: output differs in "
+					"chunks of %d frames\n", in_rate,
+					out_rate, (int)chunks[c]);
+			success = false;
+		}
+
+		bfree(split.data);
+	}
+
+	bfree(whole.data);
+	return success;
+}
+
+int main(void)
+{
+	static const double tones[] = {100.0, 1000.0, 10000.0, 20000.0};
+	bool success = true;
+
+	for (size_t i = 0; i < sizeof(tones) / sizeof(tones[0]); i++) {
+		success &= test_passband(44100, 48000,
+				AUDIO_FORMAT_FLOAT_PLANAR, tones[i],
+				MIN_SNR_DB);
+		success &= test_passband(48000, 44100,
+				AUDIO_FORMAT_FLOAT_PLANAR, tones[i],
+				MIN_SNR_DB);
+		success &= test_passband(32000, 48000,
+				AUDIO_FORMAT_FLOAT_PLANAR,
+				tones[i] * 0.7, MIN_SNR_DB);
+		success &= test_passband(96000, 48000,
+				AUDIO_FORMAT_FLOAT_PLANAR, tones[i],
+				MIN_SNR_DB);
+		success &= test_passband(44100, 48000, AUDIO_FORMAT_16BIT,
+				tones[i], MIN_S16_SNR_DB);
+	}
+
+	success &= test_passband(48000, 16000, AUDIO_FORMAT_FLOAT_PLANAR,
+			7000.0, MIN_SNR_DB);
+
+	success &= test_alias(48000, 44100, 23000.0);
+	success &= test_alias(96000, 48000, 26000.0);
+	success &= test_alias(96000, 48000, 40000.0);
+	success &= test_alias(48000, 16000, 9000.0);
+
+	success &= test_chunks(44100, 48000);
+	success &= test_chunks(48000, 44100);
+
+	printf("%s\n", success ? "resampler quality ok" :
+			"resampler quality too low");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
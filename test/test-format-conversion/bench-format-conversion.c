@@ -0,0 +1,73 @@
+/*
+ * Times every implementation of the UYVX -> I420/NV12/I444 conversions the
+ * CPU supports on a 1920x1080 frame, and prints the best of RUNS runs as
+ * megabytes of packed input converted per second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/platform.h>
+
+#include "format-conversion-impls.h"
+
+#define WIDTH      1920
+#define HEIGHT     1080
+#define FRAMES     100
+#define RUNS       5
+
+static double bench(uyvx_convert_t func, const uint8_t *input,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint64_t best = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t start = os_gettime_ns();
+		uint64_t time;
+
+		for (int i = 0; i < FRAMES; i++)
+			func(input, WIDTH * 4, 0, HEIGHT, output,
+					out_linesize);
+
+		time = os_gettime_ns() - start;
+		if (!best || time < best)
+			best = time;
+	}
+
+	return (double)WIDTH * 4.0 * HEIGHT * FRAMES * 1000.0 /
+		(double)(best ? best : 1);
+}
+
+int main(void)
+{
+	struct conversion_impl impls[MAX_CONVERSION_IMPLS];
+	size_t impl_count = get_conversion_impls(impls);
+	uint8_t *input = bmalloc(WIDTH * 4 * HEIGHT);
+	uint8_t *output[3];
+	/* big enough for I444, the 420 formats use part of it */
+	uint32_t i420_linesize[3] = {WIDTH, WIDTH / 2, WIDTH / 2};
+	uint32_t nv12_linesize[2] = {WIDTH, WIDTH};
+	uint32_t i444_linesize[3] = {WIDTH, WIDTH, WIDTH};
+
+	for (size_t i = 0; i < WIDTH * 4 * HEIGHT; i++)
+		input[i] = (uint8_t)(i * 2654435761U >> 24);
+	for (size_t i = 0; i < 3; i++)
+		output[i] = bmalloc(WIDTH * HEIGHT);
+
+	printf("%-6s %11s %11s %11s\n", "", "I420", "NV12", "I444");
+
+	for (size_t i = 0; i < impl_count; i++) {
+		printf("%-6s", impls[i].name);
+		printf(" %6.0f MB/s", bench(impls[i].i420, input, output,
+					i420_linesize));
+		printf(" %6.0f MB/s", bench(impls[i].nv12, input, output,
+					nv12_linesize));
+		printf(" %6.0f MB/s\n", bench(impls[i].i444, input, output,
+					i444_linesize));
+	}
+
+	for (size_t i = 0; i < 3; i++)
+		bfree(output[i]);
+	bfree(input);
+	return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Every implementation of the packed 444 conversions this CPU can run, for
+ * the test and the benchmark.  format-conversion.c is compiled in directly
+ * because the per-ISA functions are static and normally only reached through
+ * its runtime dispatch.  The plain C versions come first, they are the
+ * reference the others have to match.
+ */
+
+#pragma once
+
+#include <media-io/format-conversion.c>
+#include <util/bmem.h>
+
+struct conversion_impl {
+	const char     *name;
+	uyvx_convert_t i420;
+	uyvx_convert_t nv12;
+	uyvx_convert_t i444;
+};
+
+static size_t get_conversion_impls(struct conversion_impl *impls)
+{
+	size_t count = 0;
+
+	impls[count++] = (struct conversion_impl){"C",
+		compress_uyvx_to_i420_c, compress_uyvx_to_nv12_c,
+		convert_uyvx_to_i444_c};
+#ifdef CONVERT_SSE2
+	impls[count++] = (struct conversion_impl){"SSE2",
+		compress_uyvx_to_i420_sse2, compress_uyvx_to_nv12_sse2,
+		convert_uyvx_to_i444_sse2};
+#endif
+#ifdef CONVERT_AVX2
+	if (cpu_has_avx2())
+		impls[count++] = (struct conversion_impl){"AVX2",
+			compress_uyvx_to_i420_avx2, compress_uyvx_to_nv12_avx2,
+			convert_uyvx_to_i444_avx2};
+#endif
+#ifdef CONVERT_NEON
+	impls[count++] = (struct conversion_impl){"NEON",
+		compress_uyvx_to_i420_neon, compress_uyvx_to_nv12_neon,
+		convert_uyvx_to_i444_neon};
+#endif
+
+	return count;
+}
+
+#define MAX_CONVERSION_IMPLS 4
@@ -0,0 +1,177 @@
+/*
+ * Converts random packed 444 frames with every implementation of the
+ * UYVX -> I420/NV12/I444 conversions the CPU supports, and fails unless the
+ * SIMD versions write exactly the same bytes as the plain C versions.
+ *
+ * Widths around each vector size check the scalar tails, padded chroma
+ * lines and a guard area after every plane check that nothing is written
+ * outside the pixels being converted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "format-conversion-impls.h"
+
+#define HEIGHT  8
+#define GUARD   64
+#define UNSET   0xCD
+
+enum conversion {
+	CONVERT_I420,
+	CONVERT_NV12,
+	CONVERT_I444
+};
+
+static const char *conversion_names[] = {"I420", "NV12", "I444"};
+
+struct frame {
+	uint8_t  *planes[3];
+	uint32_t linesize[3];
+	size_t   sizes[3];
+};
+
+static void frame_init(struct frame *frame, enum conversion conversion,
+		uint32_t width)
+{
+	memset(frame, 0, sizeof(*frame));
+
+	frame->linesize[0] = width;
+	frame->sizes[0] = width * HEIGHT;
+
+	switch (conversion) {
+	case CONVERT_I420:
+		frame->linesize[1] = frame->linesize[2] = width / 2 + 5;
+		frame->sizes[1] = frame->sizes[2] =
+			frame->linesize[1] * HEIGHT / 2;
+		break;
+	case CONVERT_NV12:
+		frame->linesize[1] = width + 6;
+		frame->sizes[1] = frame->linesize[1] * HEIGHT / 2;
+		break;
+	case CONVERT_I444:
+		/* all three planes use the luma linesize */
+		frame->sizes[1] = frame->sizes[2] = frame->sizes[0];
+		break;
+	}
+
+	for (size_t i = 0; i < 3; i++) {
+		if (!frame->sizes[i])
+			continue;
+		frame->planes[i] = bmalloc(frame->sizes[i] + GUARD);
+		memset(frame->planes[i], UNSET, frame->sizes[i] + GUARD);
+	}
+}
+
+static void frame_free(struct frame *frame)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(frame->planes[i]);
+}
+
+static void convert(const struct conversion_impl *impl,
+		enum conversion conversion, const uint8_t *input,
+		uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+		struct frame *frame)
+{
+	uyvx_convert_t func = conversion == CONVERT_I420 ? impl->i420 :
+	                      conversion == CONVERT_NV12 ? impl->nv12 :
+	                      impl->i444;
+
+	func(input, in_linesize, start_y, end_y, frame->planes,
+			frame->linesize);
+}
+
+static uint32_t rand_state = 1;
+
+static uint8_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (uint8_t)(rand_state >> 16);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool test_conversion(const struct conversion_impl *impls,
+		size_t impl_count, enum conversion conversion, uint32_t width,
+		uint32_t start_y, uint32_t end_y)
+{
+	/* input lines are padded so the width comes from the output, and
+	 * aligned like mapped frames are for the SSE2 loads */
+	uint32_t in_linesize = ((width * 4 + 15) & ~15U) + 16;
+	uint8_t *input = bmalloc(in_linesize * HEIGHT);
+	struct frame expected;
+	bool success = true;
+
+	for (size_t i = 0; i < in_linesize * HEIGHT; i++)
+		input[i] = next_rand();
+
+	frame_init(&expected, conversion, width);
+	convert(&impls[0], conversion, input, in_linesize, start_y, end_y,
+			&expected);
+
+	for (size_t i = 1; i < impl_count; i++) {
+		struct frame frame;
+
+		frame_init(&frame, conversion, width);
+		convert(&impls[i], conversion, input, in_linesize, start_y,
+				end_y, &frame);
+
+		for (size_t p = 0; p < 3; p++) {
+			if (!frame.planes[p] ||
+			    memcmp(frame.planes[p], expected.planes[p],
+				    frame.sizes[p] + GUARD) == 0)
+				continue;
+
+			fprintf(stderr, "%s %s, width %u, rows %u-%u: plane "
+					"%d differs from C\n",
+					impls[i].name,
+					conversion_names[conversion], width,
+					start_y, end_y, (int)p);
+			success = false;
+		}
+
+		frame_free(&frame);
+	}
+
+	frame_free(&expected);
+	bfree(input);
+	return success;
+}
+
+int main(void)
+{
+	/* around the SSE2 (4 and 8 pixels), AVX2 (8 and 16) and NEON (16)
+	 * vector sizes, and a full HD line */
+	static const uint32_t widths[] = {2, 4, 6, 8, 10, 14, 16, 18, 24, 30,
+		32, 34, 46, 48, 50, 62, 64, 66, 130, 1282, 1920};
+	static const uint32_t odd_widths[] = {1, 3, 7, 9, 15, 17, 31, 33, 65};
+	struct conversion_impl impls[MAX_CONVERSION_IMPLS];
+	size_t impl_count = get_conversion_impls(impls);
+	bool success = true;
+
+	for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		for (int c = CONVERT_I420; c <= CONVERT_I444; c++) {
+			success &= test_conversion(impls, impl_count, c,
+					widths[i], 0, HEIGHT);
+			success &= test_conversion(impls, impl_count, c,
+					widths[i], 2, HEIGHT - 2);
+		}
+	}
+
+	/* the 420 conversions work on pairs of pixels and rows */
+	for (size_t i = 0; i < sizeof(odd_widths) / sizeof(odd_widths[0]);
+	     i++) {
+		success &= test_conversion(impls, impl_count, CONVERT_I444,
+				odd_widths[i], 0, HEIGHT);
+		success &= test_conversion(impls, impl_count, CONVERT_I444,
+				odd_widths[i], 1, HEIGHT);
+	}
+
+	for (size_t i = 1; i < impl_count; i++)
+		printf("%s ", impls[i].name);
+	printf("%s\n", success ? "conversions match C" :
+			"conversions differ from C");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,223 @@
+/*
+ * Replays encoder packet traces through the per-track interleave queues and
+ * through the single insertion-sorted array that outputs used before them,
+ * and fails if the two ever send packets in a different order.
+ *
+ * The packet's pts is used as its id.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs-interleave.h>
+
+struct trace {
+	struct interleave_queue queues[INTERLEAVE_QUEUES];
+	uint64_t seq;
+
+	DARRAY(struct encoder_packet) sorted;
+};
+
+/* the original obs-output.c insertion, kept as the reference order */
+static void sorted_insert(struct trace *trace, struct encoder_packet *out)
+{
+	size_t idx;
+	for (idx = 0; idx < trace->sorted.num; idx++) {
+		struct encoder_packet *cur_packet;
+		cur_packet = trace->sorted.array + idx;
+
+		if (out->dts_usec == cur_packet->dts_usec &&
+		    out->type == OBS_ENCODER_VIDEO) {
+			break;
+		} else if (out->dts_usec < cur_packet->dts_usec) {
+			break;
+		}
+	}
+
+	da_insert(trace->sorted, idx, out);
+}
+
+static void trace_insert(struct trace *trace, struct encoder_packet *packet)
+{
+	sorted_insert(trace, packet);
+	interleave_insert(trace->queues, &trace->seq, packet);
+}
+
+static bool trace_pop(struct trace *trace, const char *name, int step)
+{
+	struct interleave_queue *queue;
+	struct interleaved_packet *first = interleave_first(trace->queues,
+			&queue);
+
+	if (!first || first->packet.pts != trace->sorted.array[0].pts) {
+		fprintf(stderr, "%s, step %d: sent packet %lld, expected "
+				"%lld\n", name, step,
+				first ? (long long)first->packet.pts : -1LL,
+				(long long)trace->sorted.array[0].pts);
+		return false;
+	}
+
+	interleave_queue_pop(queue);
+	da_erase(trace->sorted, 0);
+	return true;
+}
+
+static struct interleaved_packet *find_packet(struct trace *trace,
+		int64_t id)
+{
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *queue = &trace->queues[i];
+
+		for (size_t j = queue->head; j < queue->packets.num; j++)
+			if (queue->packets.array[j].packet.pts == id)
+				return &queue->packets.array[j];
+	}
+
+	return NULL;
+}
+
+/* same as discard_interleaved_packets in obs-output.c, against the old
+ * erasing of everything before the stop index */
+static void trace_discard(struct trace *trace, size_t stop_idx)
+{
+	struct interleaved_packet stop =
+		*find_packet(trace, trace->sorted.array[stop_idx].pts);
+	struct interleave_queue *queue;
+	struct interleaved_packet *packet;
+
+	while ((packet = interleave_first(trace->queues, &queue)) != NULL) {
+		if (!interleave_packet_before(packet, &stop))
+			break;
+		interleave_queue_pop(queue);
+	}
+
+	da_erase_range(trace->sorted, 0, stop_idx);
+}
+
+static bool trace_finish(struct trace *trace, const char *name,
+		bool success)
+{
+	for (int step = 0; success && trace->sorted.num; step++)
+		success = trace_pop(trace, name, step);
+
+	if (success && interleave_first(trace->queues, NULL)) {
+		fprintf(stderr, "%s: packets left over\n", name);
+		success = false;
+	}
+
+	for (size_t i = 0; i < INTERLEAVE_QUEUES; i++)
+		da_free(trace->queues[i].packets);
+	da_free(trace->sorted);
+	return success;
+}
+
+static struct encoder_packet make_packet(enum obs_encoder_type type,
+		size_t track_idx, int64_t dts_usec, int64_t id)
+{
+	struct encoder_packet packet = {0};
+	packet.type = type;
+	packet.track_idx = track_idx;
+	packet.dts_usec = dts_usec;
+	packet.dts = dts_usec;
+	packet.pts = id;
+	return packet;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* equal timestamps: video goes before audio, audio of any track in the order
+ * it was received, and video with the same dts newest first */
+static bool test_ties(void)
+{
+	static const struct {
+		enum obs_encoder_type type;
+		size_t track_idx;
+		int64_t dts_usec;
+	} packets[] = {
+		{OBS_ENCODER_AUDIO, 0, 0},
+		{OBS_ENCODER_AUDIO, 1, 0},
+		{OBS_ENCODER_VIDEO, 0, 0},
+		{OBS_ENCODER_AUDIO, 0, 1000},
+		{OBS_ENCODER_VIDEO, 0, 1000},
+		{OBS_ENCODER_VIDEO, 0, 1000},
+		{OBS_ENCODER_AUDIO, 1, 1000},
+		{OBS_ENCODER_AUDIO, 1, 1000},
+		{OBS_ENCODER_AUDIO, 2, 500},
+		{OBS_ENCODER_VIDEO, 0, 2000},
+		{OBS_ENCODER_AUDIO, 2, 2000},
+	};
+	struct trace trace = {0};
+
+	for (size_t i = 0; i < sizeof(packets) / sizeof(packets[0]); i++) {
+		struct encoder_packet packet = make_packet(packets[i].type,
+				packets[i].track_idx, packets[i].dts_usec,
+				(int64_t)i);
+		trace_insert(&trace, &packet);
+	}
+
+	return trace_finish(&trace, "ties", true);
+}
+
+static uint32_t rand_state = 1;
+
+static uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (rand_state >> 16) & 0x7FFF;
+}
+
+/* multi-track streams arriving interleaved in random order, with some equal
+ * timestamps within and across tracks, sending and mid-stream discards */
+static bool test_random_trace(int iter)
+{
+	struct trace trace = {0};
+	int64_t next_dts[INTERLEAVE_QUEUES] = {0};
+	int64_t step[INTERLEAVE_QUEUES];
+	size_t tracks = 1 + next_rand() % MAX_AUDIO_MIXES;
+	char name[32];
+	bool success = true;
+
+	snprintf(name, sizeof(name), "random trace %d", iter);
+
+	step[0] = 16667 + (next_rand() % 3) * 1000;
+	for (size_t t = 1; t <= tracks; t++) {
+		step[t] = 21333 - (next_rand() % 2) * 5000;
+		next_dts[t] = (next_rand() % 3) * 1000;
+	}
+
+	for (int k = 0; success && k < 400; k++) {
+		size_t t = next_rand() % (tracks + 1);
+		struct encoder_packet packet = make_packet(
+				t ? OBS_ENCODER_AUDIO : OBS_ENCODER_VIDEO,
+				t ? t - 1 : 0, next_dts[t], k);
+
+		/* round some timestamps so they tie with other tracks */
+		if (next_rand() % 4 == 0)
+			packet.dts_usec = packet.dts_usec / 1000 * 1000;
+		if (next_rand() % 10 != 0)
+			next_dts[t] += step[t];
+
+		trace_insert(&trace, &packet);
+
+		if (next_rand() % 3 == 0)
+			success = trace_pop(&trace, name, k);
+
+		if (success && next_rand() % 50 == 0 && trace.sorted.num > 3)
+			trace_discard(&trace, trace.sorted.num / 2);
+	}
+
+	return trace_finish(&trace, name, success);
+}
+
+int main(void)
+{
+	bool success = test_ties();
+
+	for (int i = 0; success && i < 2000; i++)
+		success = test_random_trace(i);
+
+	printf("%s\n", success ? "interleave order matches" :
+			"interleave order differs");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,234 @@
+/*
+ * Starts obs with the libobs-null graphics module, no GPU or display needed,
+ * and renders a scene with a solid red source covering the left half of
+ * the canvas.  Fails unless obs starts, a raw RGBA frame comes out of the
+ * video pipeline within a few seconds, and it is red on the left half and
+ * black on the right half.
+ *
+ * NULL_GRAPHICS_MODULE and LIBOBS_DATA_PATH (for the effect files) come from
+ * the build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <graphics/vec4.h>
+#include <util/threading.h>
+
+#define WIDTH      64
+#define HEIGHT     32
+#define TIMEOUT_MS 5000
+
+/* ------------------------------------------------------------------------- */
+/* a source that fills half of the canvas */
+
+struct half_fill {
+	obs_source_t *source;
+};
+
+static const char *half_fill_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Half fill";
+}
+
+static void *half_fill_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct half_fill *hf = bzalloc(sizeof(struct half_fill));
+	hf->source = source;
+
+	UNUSED_PARAMETER(settings);
+	return hf;
+}
+
+static void half_fill_destroy(void *data)
+{
+	bfree(data);
+}
+
+static uint32_t half_fill_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return WIDTH / 2;
+}
+
+static uint32_t half_fill_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return HEIGHT;
+}
+
+static void half_fill_render(void *data, gs_effect_t *effect)
+{
+	gs_effect_t    *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	gs_eparam_t    *color = gs_effect_get_param_by_name(solid, "color");
+	gs_technique_t *tech  = gs_effect_get_technique(solid, "Solid");
+	struct vec4    red;
+
+	vec4_set(&red, 1.0f, 0.0f, 0.0f, 1.0f);
+	gs_effect_set_vec4(color, &red);
+
+	gs_technique_begin(tech);
+	gs_technique_begin_pass(tech, 0);
+
+	gs_draw_sprite(0, 0, WIDTH / 2, HEIGHT);
+
+	gs_technique_end_pass(tech);
+	gs_technique_end(tech);
+
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info half_fill_info = {
+	.id           = "test_half_fill",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name     = half_fill_name,
+	.create       = half_fill_create,
+	.destroy      = half_fill_destroy,
+	.get_width    = half_fill_width,
+	.get_height   = half_fill_height,
+	.video_render = half_fill_render,
+};
+
+/* ------------------------------------------------------------------------- */
+/* raw output */
+
+struct capture {
+	os_event_t *done;
+	uint8_t    pixels[WIDTH * HEIGHT * 4];
+	bool       captured;
+};
+
+static inline const uint8_t *get_pixel(const struct video_data *frame,
+		uint32_t x, uint32_t y)
+{
+	return frame->data[0] + y * frame->linesize[0] + x * 4;
+}
+
+/* the first frames are empty while the pipeline fills, so this waits for
+ * the first one the source has been drawn to */
+static void receive_video(void *param, struct video_data *frame)
+{
+	struct capture *capture = param;
+
+	if (capture->captured || get_pixel(frame, 0, 0)[0] == 0)
+		return;
+
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		memcpy(capture->pixels + y * WIDTH * 4, get_pixel(frame, 0, y),
+				WIDTH * 4);
+
+	capture->captured = true;
+	os_event_signal(capture->done);
+}
+
+static bool check_frame(const struct capture *capture)
+{
+	for (uint32_t y = 0; y < HEIGHT; y++) {
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			const uint8_t *px = capture->pixels +
+				(y * WIDTH + x) * 4;
+			bool left = x < WIDTH / 2;
+			uint8_t r = left ? 255 : 0;
+
+			if (px[0] != r || px[1] != 0 || px[2] != 0) {
+				fprintf(stderr, "pixel %u,%u is %u,%u,%u, "
+						"expected %u,0,0\n", x, y,
+						px[0], px[1], px[2], r);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool reset_video(void)
+{
+	struct obs_video_info ovi = {0};
+	int ret;
+
+	ovi.graphics_module = NULL_GRAPHICS_MODULE;
+	ovi.fps_num         = 30;
+	ovi.fps_den         = 1;
+	ovi.base_width      = WIDTH;
+	ovi.base_height     = HEIGHT;
+	ovi.output_width    = WIDTH;
+	ovi.output_height   = HEIGHT;
+	ovi.output_format   = VIDEO_FORMAT_RGBA;
+	ovi.colorspace      = VIDEO_CS_709;
+	ovi.range           = VIDEO_RANGE_FULL;
+	ovi.scale_type      = OBS_SCALE_BILINEAR;
+
+	ret = obs_reset_video(&ovi);
+	if (ret != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "obs_reset_video failed: %d\n", ret);
+		return false;
+	}
+
+	return true;
+}
+
+static bool render_frame(void)
+{
+	struct capture capture = {0};
+	obs_scene_t *scene;
+	obs_source_t *source;
+	bool success = true;
+
+	if (os_event_init(&capture.done, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+
+	obs_register_source(&half_fill_info);
+
+	scene = obs_scene_create("test scene");
+	source = obs_source_create("test_half_fill", "half fill", NULL, NULL);
+	obs_scene_add(scene, source);
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	video_output_connect(obs_get_video(), NULL, receive_video, &capture);
+
+	if (os_event_timedwait(capture.done, TIMEOUT_MS) != 0) {
+		fprintf(stderr, "no frame was rendered within %d ms\n",
+				TIMEOUT_MS);
+		success = false;
+	}
+
+	video_output_disconnect(obs_get_video(), receive_video, &capture);
+
+	if (success)
+		success = check_frame(&capture);
+
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+	obs_scene_release(scene);
+	os_event_destroy(capture.done);
+	return success;
+}
+
+int main(void)
+{
+	bool success = false;
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "obs_startup failed\n");
+		return EXIT_FAILURE;
+	}
+
+	obs_add_data_path(LIBOBS_DATA_PATH);
+
+	if (reset_video())
+		success = render_frame();
+
+	obs_shutdown();
+
+	printf("%s\n", success ? "null renderer drew the scene" :
+			"null renderer failed");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
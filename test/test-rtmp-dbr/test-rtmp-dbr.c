@@ -0,0 +1,251 @@
+/*
+ * Streams simulated packets through a connection throttled to a set
+ * throughput, the way rtmp-stream.c drives the dynamic bitrate controller:
+ * packets are queued as they are encoded and sent one at a time at the
+ * connection's rate, and a new bitrate only takes effect when the encoder
+ * gets to its next frame.
+ *
+ * Fails if lowering the bitrate does not keep moderate congestion under the
+ * frame drop threshold, if the stream does not settle at a bitrate the
+ * connection can take, or if the original bitrate does not come back once
+ * the connection recovers.  A sudden drop to a fraction of the bitrate is
+ * allowed to drop frames first, that is what they are the last resort for.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/darray.h>
+#include <rtmp-dbr.h>
+
+#define FPS                  30
+#define FRAME_NS             (1000000000ULL / FPS)
+#define SEC_NS               1000000000ULL
+#define VIDEO_KBPS           5000
+#define AUDIO_KBPS           160
+#define DROP_THRESHOLD_USEC  700000LL
+
+struct sim_packet {
+	uint64_t dts_ns;
+	size_t   size;
+	bool     video;
+};
+
+struct sim {
+	struct dbr dbr;
+	DARRAY(struct sim_packet) queue;
+	size_t   head;
+	uint64_t send_free_ns;
+	long     capacity_kbps;
+	uint64_t frame;
+};
+
+/* sends everything the connection gets through before now */
+static void sim_send(struct sim *sim, uint64_t now)
+{
+	while (sim->head < sim->queue.num) {
+		struct sim_packet *packet = sim->queue.array + sim->head;
+		struct dbr_frame frame;
+		uint64_t beg = sim->send_free_ns > packet->dts_ns ?
+			sim->send_free_ns : packet->dts_ns;
+
+		if (beg >= now)
+			break;
+
+		frame.send_beg = beg;
+		frame.send_end = beg + (uint64_t)packet->size * 8000000ULL /
+			(uint64_t)sim->capacity_kbps;
+		frame.size = packet->size;
+		dbr_add_frame(&sim->dbr, &frame);
+
+		sim->send_free_ns = frame.send_end;
+		sim->head++;
+	}
+
+	if (sim->head == sim->queue.num) {
+		da_resize(sim->queue, 0);
+		sim->head = 0;
+	}
+}
+
+/* same as get_buffer_duration_usec in rtmp-stream.c */
+static int64_t sim_buffer_duration_usec(struct sim *sim, uint64_t now)
+{
+	for (size_t i = sim->head; i < sim->queue.num; i++) {
+		if (sim->queue.array[i].video)
+			return (int64_t)(now - sim->queue.array[i].dts_ns) /
+				1000;
+	}
+
+	return 0;
+}
+
+static void sim_push(struct sim *sim, uint64_t now, long kbps, bool video)
+{
+	struct sim_packet packet = {now, (size_t)kbps * 1000 / 8 / FPS, video};
+	da_push_back(sim->queue, &packet);
+}
+
+/* runs the stream for duration_ns, returns the largest amount of video that
+ * was waiting to be sent */
+static int64_t sim_run(struct sim *sim, long capacity_kbps,
+		uint64_t duration_ns)
+{
+	uint64_t end = (sim->frame * FRAME_NS) + duration_ns;
+	int64_t max_buffer_usec = 0;
+
+	sim->capacity_kbps = capacity_kbps;
+
+	for (uint64_t now = sim->frame * FRAME_NS; now < end;
+	     now = ++sim->frame * FRAME_NS) {
+		int64_t buffer_usec;
+
+		sim_send(sim, now);
+
+		/* the encoder picks the new bitrate up before its frame */
+		dbr_bitrate_applied(&sim->dbr, true);
+
+		sim_push(sim, now, sim->dbr.cur_bitrate, true);
+		sim_push(sim, now, AUDIO_KBPS, false);
+
+		buffer_usec = sim_buffer_duration_usec(sim, now);
+		if (buffer_usec > max_buffer_usec)
+			max_buffer_usec = buffer_usec;
+
+		dbr_next_bitrate(&sim->dbr, buffer_usec, DROP_THRESHOLD_USEC,
+				now);
+
+		if (sim->dbr.cur_bitrate < DBR_MIN_BITRATE ||
+		    sim->dbr.cur_bitrate > VIDEO_KBPS) {
+			fprintf(stderr, "bitrate %ld kbps out of range\n",
+					sim->dbr.cur_bitrate);
+			return DROP_THRESHOLD_USEC * 10;
+		}
+	}
+
+	return max_buffer_usec;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool test_throttled_sink(long throttled_kbps, bool no_drops)
+{
+	struct sim sim = {0};
+	int64_t buffer_usec;
+	bool success = true;
+
+	dbr_reset(&sim.dbr, VIDEO_KBPS, AUDIO_KBPS);
+
+	/* enough room: nothing changes */
+	sim_run(&sim, 8000, 20 * SEC_NS);
+	if (sim.dbr.cur_bitrate != VIDEO_KBPS) {
+		fprintf(stderr, "%ld kbps: bitrate changed to %ld kbps without "
+				"congestion\n", throttled_kbps,
+				sim.dbr.cur_bitrate);
+		success = false;
+	}
+
+	/* throttled: lowered before anything would have to be dropped */
+	buffer_usec = sim_run(&sim, throttled_kbps, 10 * SEC_NS);
+	if (no_drops && buffer_usec >= DROP_THRESHOLD_USEC) {
+		fprintf(stderr, "%ld kbps: %lld ms buffered, frames would "
+				"have been dropped\n", throttled_kbps,
+				(long long)buffer_usec / 1000);
+		success = false;
+	}
+	if (sim.dbr.cur_bitrate + AUDIO_KBPS > throttled_kbps) {
+		fprintf(stderr, "%ld kbps: bitrate still %ld kbps after 10 "
+				"seconds\n", throttled_kbps,
+				sim.dbr.cur_bitrate);
+		success = false;
+	}
+
+	/* and settles, trying higher bitrates now and then but backing off
+	 * before anything has to be dropped */
+	buffer_usec = sim_run(&sim, throttled_kbps, 60 * SEC_NS);
+	if (buffer_usec >= DROP_THRESHOLD_USEC) {
+		fprintf(stderr, "%ld kbps: %lld ms buffered after the bitrate "
+				"settled\n", throttled_kbps,
+				(long long)buffer_usec / 1000);
+		success = false;
+	}
+	if (sim.dbr.cur_bitrate * 2 < throttled_kbps) {
+		fprintf(stderr, "%ld kbps: settled at only %ld kbps\n",
+				throttled_kbps, sim.dbr.cur_bitrate);
+		success = false;
+	}
+
+	/* recovered: back to the original bitrate */
+	sim_run(&sim, 8000, 150 * SEC_NS);
+	if (sim.dbr.cur_bitrate != VIDEO_KBPS) {
+		fprintf(stderr, "%ld kbps: bitrate only back to %ld kbps\n",
+				throttled_kbps, sim.dbr.cur_bitrate);
+		success = false;
+	}
+
+	dbr_free(&sim.dbr);
+	da_free(sim.queue);
+	return success;
+}
+
+/* a change has to take effect before the next one is made, and a change the
+ * encoder refuses leaves the bitrate as it was */
+static bool test_pending_change(void)
+{
+	struct dbr dbr = {0};
+	uint64_t now = 10 * SEC_NS;
+	bool success = true;
+	long bitrate;
+
+	dbr_reset(&dbr, VIDEO_KBPS, AUDIO_KBPS);
+
+	bitrate = dbr_next_bitrate(&dbr, DROP_THRESHOLD_USEC,
+			DROP_THRESHOLD_USEC, now);
+	if (!bitrate || bitrate >= VIDEO_KBPS ||
+	    dbr.cur_bitrate != VIDEO_KBPS) {
+		fprintf(stderr, "pending: lowered to %ld, current %ld kbps\n",
+				bitrate, dbr.cur_bitrate);
+		success = false;
+	}
+
+	now += DBR_LOWER_INTERVAL_NS * 2;
+	if (dbr_next_bitrate(&dbr, DROP_THRESHOLD_USEC,
+				DROP_THRESHOLD_USEC, now) != 0) {
+		fprintf(stderr, "pending: changed again before the first "
+				"change took effect\n");
+		success = false;
+	}
+
+	if (dbr_bitrate_applied(&dbr, false) != bitrate ||
+	    dbr.cur_bitrate != VIDEO_KBPS) {
+		fprintf(stderr, "pending: refused change counted as %ld kbps\n",
+				dbr.cur_bitrate);
+		success = false;
+	}
+
+	if (dbr_bitrate_applied(&dbr, true) != 0 ||
+	    dbr.cur_bitrate != VIDEO_KBPS) {
+		fprintf(stderr, "pending: unrelated update changed the "
+				"bitrate\n");
+		success = false;
+	}
+
+	dbr_free(&dbr);
+	return success;
+}
+
+int main(void)
+{
+	bool success = test_pending_change();
+
+	if (!test_throttled_sink(4000, true))
+		success = false;
+	if (!test_throttled_sink(2500, true))
+		success = false;
+	if (!test_throttled_sink(1200, false))
+		success = false;
+
+	printf("%s\n", success ? "dynamic bitrate kept up" :
+			"dynamic bitrate failed");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,365 @@
+/*
+ * Runs the epoll socket thread from rtmp-linux.c over a loopback TCP
+ * connection, queueing data the way socket_queue_data in rtmp-stream.c does.
+ *
+ * Fails unless every queued byte arrives in order, in both the normal and
+ * the low latency mode, while the server also sends data that the thread
+ * has to drain.  Also fails unless data queued while the thread is idle is
+ * sent right away, instead of when epoll_wait next times out, and unless the
+ * thread exits promptly when told to.  Both of those depend on
+ * socket_wake_fd waking the thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "rtmp-stream.h"
+
+#define WRITE_BUF_SIZE     (128 * 1024)
+#define CHUNKS             3000
+/* low latency mode sends a little at a time with pauses in between */
+#define LOW_LATENCY_CHUNKS 100
+#define MAX_CHUNK_SIZE     7000
+#define WAKE_ROUNDS        10
+#define IDLE_MS            100
+/* well under the one second epoll_wait timeout of the socket thread */
+#define MAX_WAKE_MS        250
+
+struct server {
+	int      listen_fd;
+	int      fd;
+	uint64_t expected;
+	bool     slow;
+	pthread_t thread;
+
+	pthread_mutex_t mutex;
+	uint64_t received;
+	uint64_t wait_for;
+	os_event_t *reached;
+	bool     out_of_order;
+};
+
+/* ------------------------------------------------------------------------- */
+/* receiving end */
+
+static void *server_thread(void *data)
+{
+	struct server *server = data;
+	uint8_t ack[1024] = {0};
+	uint8_t next = 0;
+	uint8_t buf[65536];
+	ssize_t ret;
+
+	server->fd = accept(server->listen_fd, NULL, NULL);
+	if (server->fd == -1)
+		return NULL;
+
+	/* something like the acknowledgements a server sends, which the
+	 * socket thread discards */
+	send(server->fd, ack, sizeof(ack), 0);
+
+	while ((ret = recv(server->fd, buf, sizeof(buf), 0)) > 0) {
+		bool in_order = true;
+
+		for (ssize_t i = 0; i < ret; i++)
+			in_order &= buf[i] == next++;
+
+		pthread_mutex_lock(&server->mutex);
+		server->received += (uint64_t)ret;
+		if (!in_order)
+			server->out_of_order = true;
+		if (server->wait_for && server->received >= server->wait_for) {
+			server->wait_for = 0;
+			os_event_signal(server->reached);
+		}
+		pthread_mutex_unlock(&server->mutex);
+
+		if (server->slow)
+			os_sleep_ms(2);
+	}
+
+	close(server->fd);
+	return NULL;
+}
+
+static bool server_start(struct server *server, struct sockaddr_in *addr)
+{
+	socklen_t addr_len = sizeof(*addr);
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (server->listen_fd == -1 ||
+	    bind(server->listen_fd, (struct sockaddr*)addr, addr_len) != 0 ||
+	    listen(server->listen_fd, 1) != 0 ||
+	    getsockname(server->listen_fd, (struct sockaddr*)addr,
+		    &addr_len) != 0) {
+		perror("loopback server");
+		return false;
+	}
+
+	pthread_mutex_init(&server->mutex, NULL);
+	os_event_init(&server->reached, OS_EVENT_TYPE_AUTO);
+	pthread_create(&server->thread, NULL, server_thread, server);
+	return true;
+}
+
+static void server_stop(struct server *server)
+{
+	pthread_join(server->thread, NULL);
+	close(server->listen_fd);
+	os_event_destroy(server->reached);
+	pthread_mutex_destroy(&server->mutex);
+}
+
+/* waits until the server has received total bytes, returns the time it took
+ * in ms, or -1 if it did not happen within timeout_ms */
+static int server_wait(struct server *server, uint64_t total, int timeout_ms)
+{
+	uint64_t start = os_gettime_ns();
+
+	pthread_mutex_lock(&server->mutex);
+	if (server->received >= total) {
+		pthread_mutex_unlock(&server->mutex);
+		return 0;
+	}
+	server->wait_for = total;
+	pthread_mutex_unlock(&server->mutex);
+
+	if (os_event_timedwait(server->reached, timeout_ms) != 0)
+		return -1;
+
+	return (int)((os_gettime_ns() - start) / 1000000);
+}
+
+/* ------------------------------------------------------------------------- */
+/* sending end */
+
+static struct rtmp_stream *stream_create(int fd, bool low_latency)
+{
+	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
+	int one = 1;
+
+	ioctl(fd, FIONBIO, &one);
+
+	RTMP_Init(&stream->rtmp);
+	stream->rtmp.m_sb.sb_socket = fd;
+
+	pthread_mutex_init(&stream->write_buf_mutex, NULL);
+	os_event_init(&stream->buffer_space_available_event,
+			OS_EVENT_TYPE_AUTO);
+	os_event_init(&stream->buffer_has_data_event, OS_EVENT_TYPE_AUTO);
+	os_event_init(&stream->send_thread_signaled_exit,
+			OS_EVENT_TYPE_MANUAL);
+	os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL);
+	stream->socket_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	stream->write_buf_size = WRITE_BUF_SIZE;
+	stream->write_buf = bmalloc(WRITE_BUF_SIZE);
+	stream->low_latency_mode = low_latency;
+	return stream;
+}
+
+static void stream_destroy(struct rtmp_stream *stream)
+{
+	if (stream->rtmp.m_sb.sb_socket != -1)
+		close(stream->rtmp.m_sb.sb_socket);
+
+	close(stream->socket_wake_fd);
+	os_event_destroy(stream->buffer_space_available_event);
+	os_event_destroy(stream->buffer_has_data_event);
+	os_event_destroy(stream->send_thread_signaled_exit);
+	os_event_destroy(stream->stop_event);
+	pthread_mutex_destroy(&stream->write_buf_mutex);
+	bfree(stream->write_buf);
+	bfree(stream);
+}
+
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+	eventfd_write(stream->socket_wake_fd, 1);
+}
+
+/* the same as socket_queue_data in rtmp-stream.c */
+static bool queue_data(struct rtmp_stream *stream, const uint8_t *data,
+		size_t len)
+{
+	for (;;) {
+		if (stream->rtmp.m_sb.sb_socket == -1)
+			return false;
+
+		pthread_mutex_lock(&stream->write_buf_mutex);
+		if (stream->write_buf_len + len <= stream->write_buf_size)
+			break;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+
+		os_event_wait(stream->buffer_space_available_event);
+	}
+
+	memcpy(stream->write_buf + stream->write_buf_len, data, len);
+	stream->write_buf_len += len;
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	signal_socket_thread(stream);
+	return true;
+}
+
+static size_t fill_chunk(uint8_t *buf, size_t size, uint8_t *next)
+{
+	for (size_t i = 0; i < size; i++)
+		buf[i] = (*next)++;
+	return size;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool send_all(struct rtmp_stream *stream, struct server *server,
+		size_t chunks)
+{
+	uint8_t *buf = bmalloc(MAX_CHUNK_SIZE);
+	uint64_t total = 0;
+	uint8_t next = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < chunks && success; i++) {
+		size_t size = 1 + (i * 7919) % MAX_CHUNK_SIZE;
+
+		fill_chunk(buf, size, &next);
+		success = queue_data(stream, buf, size);
+		total += size;
+	}
+
+	if (!success)
+		fprintf(stderr, "socket closed while sending\n");
+	else if (server_wait(server, total, 10000) < 0) {
+		fprintf(stderr, "only %d of %d bytes arrived\n",
+				(int)server->received, (int)total);
+		success = false;
+	}
+
+	bfree(buf);
+	return success;
+}
+
+/* queues a little data at a time while the socket thread is idle, and checks
+ * that it arrives without waiting for epoll_wait to time out */
+static bool wake_idle(struct rtmp_stream *stream, struct server *server)
+{
+	uint8_t buf[256];
+	uint8_t next;
+	uint64_t total;
+	bool success = true;
+
+	pthread_mutex_lock(&server->mutex);
+	total = server->received;
+	pthread_mutex_unlock(&server->mutex);
+
+	/* continue the byte sequence the server expects */
+	next = (uint8_t)total;
+
+	for (int round = 0; round < WAKE_ROUNDS && success; round++) {
+		int ms;
+
+		os_sleep_ms(IDLE_MS);
+
+		total += fill_chunk(buf, sizeof(buf), &next);
+		if (!queue_data(stream, buf, sizeof(buf))) {
+			fprintf(stderr, "socket closed while idle\n");
+			return false;
+		}
+
+		ms = server_wait(server, total, 2000);
+		if (ms < 0 || ms > MAX_WAKE_MS) {
+			fprintf(stderr, "data queued while idle took %d ms "
+					"to arrive\n", ms);
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+static bool stop_thread(struct rtmp_stream *stream, pthread_t thread)
+{
+	uint64_t start = os_gettime_ns();
+	int ms;
+
+	os_event_signal(stream->send_thread_signaled_exit);
+	signal_socket_thread(stream);
+	pthread_join(thread, NULL);
+
+	ms = (int)((os_gettime_ns() - start) / 1000000);
+	if (ms > MAX_WAKE_MS) {
+		fprintf(stderr, "socket thread took %d ms to exit\n", ms);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_socket_loop(bool low_latency)
+{
+	struct server server = {0};
+	struct sockaddr_in addr;
+	struct rtmp_stream *stream;
+	pthread_t thread;
+	bool success;
+	int fd;
+
+	server.slow = low_latency;
+	if (!server_start(&server, &addr))
+		return false;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		perror("connect");
+		close(fd);
+		close(server.listen_fd);
+		return false;
+	}
+
+	stream = stream_create(fd, low_latency);
+	pthread_create(&thread, NULL, socket_thread_linux, stream);
+
+	success = send_all(stream, &server,
+			low_latency ? LOW_LATENCY_CHUNKS : CHUNKS);
+	if (success)
+		success = wake_idle(stream, &server);
+	success &= stop_thread(stream, thread);
+
+	if (stream->rtmp.m_sb.sb_socket == -1) {
+		fprintf(stderr, "socket thread closed the connection\n");
+		success = false;
+	}
+	if (server.out_of_order) {
+		fprintf(stderr, "bytes arrived out of order\n");
+		success = false;
+	}
+
+	stream_destroy(stream);
+	server_stop(&server);
+
+	if (!success)
+		fprintf(stderr, "failed in %s mode\n",
+				low_latency ? "low latency" : "normal");
+	return success;
+}
+
+int main(void)
+{
+	bool success = true;
+
+	success &= test_socket_loop(false);
+	success &= test_socket_loop(true);
+
+	printf("%s\n", success ? "socket loop sent everything" :
+			"socket loop failed");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
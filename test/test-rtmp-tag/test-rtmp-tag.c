@@ -0,0 +1,246 @@
+/*
+ * Sends the same encoder packets over two connections, one the way
+ * rtmp-stream.c used to (the whole tag built by flv_packet_mux and copied in
+ * to an RTMP packet by RTMP_Write), the other the way it does now (only the
+ * tag header built by flv_packet_mux_header, then the packet data sent from
+ * where it is by RTMP_WriteTag), and fails unless the bytes on the wire are
+ * the same.
+ *
+ * The connections are socket pairs, so RTMP_WriteTag takes its plain socket
+ * path with gather writes.  Packets cover audio and video, sequence headers,
+ * sizes around the chunk size, 128 and 4096 byte chunks, and timestamps
+ * past the 24 bit limit that need the extended timestamp field.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <util/bmem.h>
+#include "flv-mux.h"
+#include "librtmp/rtmp.h"
+
+#define SOCKET_BUF_SIZE (4 * 1024 * 1024)
+#define MAX_PACKET_SIZE 100000
+#define PACKETS         60
+
+struct connection {
+	RTMP rtmp;
+	int  recv_socket;
+	uint8_t *received;
+	size_t  received_size;
+};
+
+static bool connection_init(struct connection *conn, int chunk_size)
+{
+	int buf_size = SOCKET_BUF_SIZE;
+	int sockets[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+		perror("socketpair");
+		return false;
+	}
+
+	setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &buf_size,
+			sizeof(buf_size));
+	setsockopt(sockets[1], SOL_SOCKET, SO_RCVBUF, &buf_size,
+			sizeof(buf_size));
+
+	RTMP_Init(&conn->rtmp);
+	conn->rtmp.m_sb.sb_socket = sockets[0];
+	conn->rtmp.m_outChunkSize = chunk_size;
+	conn->rtmp.Link.streams[0].id = 1;
+
+	conn->recv_socket = sockets[1];
+	conn->received = bmalloc(SOCKET_BUF_SIZE);
+	conn->received_size = 0;
+	return true;
+}
+
+static void connection_free(struct connection *conn)
+{
+	close(conn->rtmp.m_sb.sb_socket);
+	close(conn->recv_socket);
+	bfree(conn->received);
+}
+
+/* everything sent so far is already in the receive buffer */
+static void connection_receive(struct connection *conn)
+{
+	ssize_t ret;
+
+	while ((ret = recv(conn->recv_socket,
+					conn->received + conn->received_size,
+					SOCKET_BUF_SIZE - conn->received_size,
+					MSG_DONTWAIT)) > 0)
+		conn->received_size += (size_t)ret;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool send_old(struct connection *conn, struct encoder_packet *packet,
+		int32_t dts_offset, bool is_header)
+{
+	uint8_t *data;
+	size_t size;
+	int ret;
+
+	flv_packet_mux(packet, dts_offset, &data, &size, is_header);
+	ret = RTMP_Write(&conn->rtmp, (char*)data, (int)size, 0);
+	bfree(data);
+
+	connection_receive(conn);
+	return ret > 0;
+}
+
+static bool send_new(struct connection *conn, struct encoder_packet *packet,
+		int32_t dts_offset, bool is_header)
+{
+	uint8_t tag[FLV_TAG_HEADER_MAX_SIZE];
+	size_t tag_size;
+	int ret;
+
+	tag_size = flv_packet_mux_header(packet, dts_offset, tag, is_header);
+	ret = RTMP_WriteTag(&conn->rtmp, (char*)tag, (int)tag_size,
+			(char*)packet->data, (int)packet->size, 0);
+
+	connection_receive(conn);
+	return ret > 0;
+}
+
+/* the tag header has to be the start of the whole tag */
+static bool check_tag_header(struct encoder_packet *packet,
+		int32_t dts_offset, bool is_header)
+{
+	uint8_t tag[FLV_TAG_HEADER_MAX_SIZE];
+	uint8_t *data;
+	size_t tag_size;
+	size_t size;
+	bool success;
+
+	tag_size = flv_packet_mux_header(packet, dts_offset, tag, is_header);
+	flv_packet_mux(packet, dts_offset, &data, &size, is_header);
+
+	success = size == tag_size + packet->size + 4 &&
+		memcmp(data, tag, tag_size) == 0 &&
+		memcmp(data + tag_size, packet->data, packet->size) == 0;
+	bfree(data);
+
+	if (!success)
+		fprintf(stderr, "%s packet of %d bytes: tag header differs "
+				"from flv_packet_mux\n",
+				packet->type == OBS_ENCODER_VIDEO ?
+				"video" : "audio", (int)packet->size);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t rand_state = 1;
+
+static uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static void packet_init(struct encoder_packet *packet, uint8_t *data,
+		size_t size, bool video, int64_t time_ms)
+{
+	memset(packet, 0, sizeof(*packet));
+
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)next_rand();
+
+	packet->data = data;
+	packet->size = size;
+	packet->type = video ? OBS_ENCODER_VIDEO : OBS_ENCODER_AUDIO;
+	packet->keyframe = video && next_rand() % 4 == 0;
+	packet->timebase_num = 1;
+	packet->timebase_den = 1000;
+	packet->dts = time_ms;
+	packet->pts = video ? time_ms + (int64_t)(next_rand() % 3) * 33 :
+		time_ms;
+}
+
+/* sends a sequence header for each track, then a mix of audio and video
+ * packets, over both connections */
+static bool test_stream(int chunk_size, int64_t start_ms, int32_t dts_offset)
+{
+	static const size_t fixed_sizes[] = {1, 2, 11, 127, 128, 129, 4095,
+		4096, 4097, 8192, 65536};
+	struct connection old_conn;
+	struct connection new_conn;
+	uint8_t *data = bmalloc(MAX_PACKET_SIZE);
+	bool success = true;
+	size_t count = 0;
+
+	if (!connection_init(&old_conn, chunk_size))
+		return false;
+	if (!connection_init(&new_conn, chunk_size)) {
+		connection_free(&old_conn);
+		return false;
+	}
+
+	for (size_t i = 0; i < 2 + PACKETS; i++) {
+		struct encoder_packet packet;
+		bool is_header = i < 2;
+		bool video = is_header ? i == 0 : next_rand() % 3 != 0;
+		int64_t time_ms = is_header ? 0 : start_ms + (int64_t)i * 21;
+		size_t size;
+
+		if (i < sizeof(fixed_sizes) / sizeof(fixed_sizes[0]))
+			size = fixed_sizes[i];
+		else
+			size = 1 + next_rand() %
+				(video ? MAX_PACKET_SIZE : 800);
+
+		packet_init(&packet, data, size, video, time_ms);
+
+		success &= check_tag_header(&packet,
+				is_header ? 0 : dts_offset, is_header);
+		success &= send_old(&old_conn, &packet,
+				is_header ? 0 : dts_offset, is_header);
+		success &= send_new(&new_conn, &packet,
+				is_header ? 0 : dts_offset, is_header);
+		count++;
+	}
+
+	if (old_conn.received_size != new_conn.received_size ||
+	    memcmp(old_conn.received, new_conn.received,
+		    old_conn.received_size) != 0) {
+		fprintf(stderr, "chunk size %d, start %lld ms: %d packets "
+				"sent as %d bytes with RTMP_Write, %d bytes "
+				"with RTMP_WriteTag, or the bytes differ\n",
+				chunk_size, (long long)start_ms, (int)count,
+				(int)old_conn.received_size,
+				(int)new_conn.received_size);
+		success = false;
+	}
+
+	connection_free(&old_conn);
+	connection_free(&new_conn);
+	bfree(data);
+	return success;
+}
+
+int main(void)
+{
+	static const int chunk_sizes[] = {128, 4096};
+	bool success = true;
+
+	for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]);
+	     i++) {
+		success &= test_stream(chunk_sizes[i], 0, 0);
+		success &= test_stream(chunk_sizes[i], 5000, 5000);
+		/* past 0xFFFFFF ms, the extended timestamp is used */
+		success &= test_stream(chunk_sizes[i], 0xFFFFF0, 0);
+	}
+
+	printf("%s\n", success ? "RTMP_WriteTag sends the same bytes" :
+			"RTMP_WriteTag sends different bytes");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
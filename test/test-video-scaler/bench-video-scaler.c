@@ -0,0 +1,135 @@
+/*
+ * Times video_scaler_scale on typical output conversions with one slice and
+ * with the frame split across threads, and prints the best of RUNS runs as
+ * frames per second.  "auto" is the thread count video-io picks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <media-io/video-scaler.h>
+#include <media-io/video-frame.h>
+#include <util/platform.h>
+
+#define FRAMES 60
+#define RUNS   3
+
+struct conversion {
+	const char            *name;
+	enum video_format     src_format;
+	uint32_t              src_width;
+	uint32_t              src_height;
+	enum video_format     dst_format;
+	uint32_t              dst_width;
+	uint32_t              dst_height;
+	enum video_scale_type type;
+};
+
+static const struct conversion conversions[] = {
+	{"1080p NV12 -> I420",
+		VIDEO_FORMAT_NV12, 1920, 1080,
+		VIDEO_FORMAT_I420, 1920, 1080, VIDEO_SCALE_DEFAULT},
+	{"1080p BGRA -> 720p I420",
+		VIDEO_FORMAT_BGRA, 1920, 1080,
+		VIDEO_FORMAT_I420, 1280, 720, VIDEO_SCALE_BICUBIC},
+	{"2160p BGRA -> 1080p NV12",
+		VIDEO_FORMAT_BGRA, 3840, 2160,
+		VIDEO_FORMAT_NV12, 1920, 1080, VIDEO_SCALE_BILINEAR},
+	{"720p I420 -> 1080p I444",
+		VIDEO_FORMAT_I420, 1280, 720,
+		VIDEO_FORMAT_I444, 1920, 1080, VIDEO_SCALE_BICUBIC},
+};
+
+static void fill_frame(struct video_frame *frame, enum video_format format,
+		uint32_t height)
+{
+	uint32_t seed = 1;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++) {
+		uint32_t rows = height;
+
+		if (i > 0 && (format == VIDEO_FORMAT_I420 ||
+		              format == VIDEO_FORMAT_NV12))
+			rows /= 2;
+
+		for (size_t j = 0; j < (size_t)frame->linesize[i] * rows; j++) {
+			seed = seed * 1103515245 + 12345;
+			frame->data[i][j] = (uint8_t)(seed >> 16);
+		}
+	}
+}
+
+/* returns frames per second, or 0 if the scaler could not be created */
+static double bench(const struct conversion *conv, int threads)
+{
+	struct video_scale_info src = {conv->src_format, conv->src_width,
+		conv->src_height, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_scale_info dst = {conv->dst_format, conv->dst_width,
+		conv->dst_height, VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+	struct video_frame in;
+	struct video_frame out;
+	video_scaler_t *scaler;
+	uint64_t best = 0;
+
+	if (video_scaler_create2(&scaler, &dst, &src, conv->type, threads) !=
+			VIDEO_SCALER_SUCCESS)
+		return 0.0;
+
+	video_frame_init(&in, conv->src_format, conv->src_width,
+			conv->src_height);
+	video_frame_init(&out, conv->dst_format, conv->dst_width,
+			conv->dst_height);
+	fill_frame(&in, conv->src_format, conv->src_height);
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t start = os_gettime_ns();
+		uint64_t time;
+
+		for (int i = 0; i < FRAMES; i++)
+			video_scaler_scale(scaler, out.data, out.linesize,
+					(const uint8_t *const *)in.data,
+					in.linesize);
+
+		time = os_gettime_ns() - start;
+		if (!best || time < best)
+			best = time;
+	}
+
+	video_frame_free(&in);
+	video_frame_free(&out);
+	video_scaler_destroy(scaler);
+
+	return (double)FRAMES * 1000000000.0 / (double)(best ? best : 1);
+}
+
+int main(void)
+{
+	static const int thread_counts[] = {1, 2, 4, 0};
+
+	printf("%-26s", "");
+	for (size_t t = 0; t < sizeof(thread_counts) / sizeof(int); t++) {
+		if (thread_counts[t])
+			printf(" %5d thr", thread_counts[t]);
+		else
+			printf(" %9s", "auto");
+	}
+	printf("\n");
+
+	for (size_t i = 0; i < sizeof(conversions) / sizeof(conversions[0]);
+	     i++) {
+		printf("%-26s", conversions[i].name);
+
+		for (size_t t = 0; t < sizeof(thread_counts) / sizeof(int);
+		     t++) {
+			double fps = bench(&conversions[i], thread_counts[t]);
+
+			if (fps > 0.0)
+				printf(" %5.0f fps", fps);
+			else
+				printf(" %9s", "failed");
+		}
+		printf("\n");
+	}
+
+	return 0;
+}